@@ -4,6 +4,11 @@ cbuffer vs_globals : register(b0)
 	matrix mat_world;
 };
 
+cbuffer vs_instanced_globals : register(b0)
+{
+	matrix mat_view_proj;
+};
+
 cbuffer vs_animated_globals : register(b0)
 {
 	matrix mat_combined_ani;
@@ -18,6 +23,17 @@ struct VS_INPUT
 	float2 tex : TEXCOORD0;
 };
 
+struct VS_INPUT_INSTANCED
+{
+    float3 pos : POSITION;
+	float3 normal : NORMAL;
+	float2 tex : TEXCOORD0;
+	float4 world0 : INSTANCE0;
+	float4 world1 : INSTANCE1;
+	float4 world2 : INSTANCE2;
+	float4 world3 : INSTANCE3;
+};
+
 struct VS_INPUT_ANIMATED
 {
     float3 pos : POSITION;
@@ -43,6 +59,17 @@ VS_OUTPUT vs_mesh(VS_INPUT In)
 	return Out;
 }
 
+VS_OUTPUT vs_mesh_instanced(VS_INPUT_INSTANCED In)
+{
+	VS_OUTPUT Out;
+	float4x4 world = float4x4(In.world0, In.world1, In.world2, In.world3);
+	float4 pos = mul(float4(In.pos,1), world);
+	Out.pos = mul(pos, mat_view_proj);
+	Out.normal = mul(In.normal, (float3x3)world).xyz;
+	Out.tex = In.tex;
+	return Out;
+}
+
 VS_OUTPUT vs_animated(VS_INPUT_ANIMATED In)
 {
 	VS_OUTPUT Out;
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "File.h"
+
+//-----------------------------------------------------------------------------
+// Read only package of files. Names are found by hash index (case insensitive, '/' as separator).
+// Data of each entry starts at page boundary so uncompressed entries are used in place from mapped file.
+// Layout: header, entries table, hash index, names, entries data.
+class Archive
+{
+public:
+	struct Entry
+	{
+		uint offset, size, packed_size, hash, name_offset;
+
+		bool IsCompressed() const { return packed_size != size; }
+	};
+
+	struct Stats
+	{
+		uint files, compressed, size, packed_size;
+	};
+
+	static const uint PAGE_SIZE = 4096;
+
+	Archive();
+	~Archive();
+	// return false when file don't exists, throws on invalid archive
+	bool Open(cstring path);
+	void Close();
+	const Entry* Find(cstring name) const;
+	// return pointer to mapped data or data decompressed to buf, nullptr for corrupted entry
+	const byte* GetData(const Entry& entry, string& buf) const;
+	cstring GetName(const Entry& entry) const { return names + entry.name_offset; }
+	const Entry& GetEntry(uint index) const { assert(index < GetEntriesCount()); return entries[index]; }
+	uint GetEntriesCount() const;
+	bool IsOpen() const { return header != nullptr; }
+
+	// pack files (paths relative to dir) into archive, throws on error
+	static void Create(cstring path, cstring dir, const vector<string>& files, bool compress, Stats* stats = nullptr);
+
+private:
+	struct Header;
+
+	FileReader file;
+	string content; // used when file can't be mapped
+	const Header* header;
+	const Entry* entries;
+	const uint* index; // entry index + 1, 0 for empty slot
+	const char* names;
+};
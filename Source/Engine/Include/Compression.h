@@ -0,0 +1,16 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+// Fast LZ77 block compression (LZ4 block format), used for archive entries.
+// Decompression is cheap enough to do it on load, compression is done offline by packer.
+namespace compression
+{
+	// size of dst buffer required by Compress to not fail when data can't be compressed
+	inline uint GetMaxCompressedSize(uint size) { return size + size / 255 + 16; }
+	// upper bound of uncompressed size, single byte of match length encode at most 255 bytes of output
+	inline uint64 GetMaxDecompressedSize(uint packed_size) { return (uint64)packed_size * 255 + 16; }
+	// return compressed size or 0 when dst is too small
+	uint Compress(const byte* src, uint size, byte* dst, uint dst_size);
+	// dst_size must be exact size of uncompressed data, return false for corrupted data
+	bool Decompress(const byte* src, uint size, byte* dst, uint dst_size);
+}
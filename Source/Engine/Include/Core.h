@@ -59,7 +59,7 @@ typedef unsigned int uint;
 typedef __int64 int64;
 typedef unsigned __int64 uint64;
 typedef const char* cstring;
-#ifdef X64
+#if defined(X64) || defined(_WIN64) || defined(__LP64__)
 typedef __int64 IntPointer;
 typedef unsigned __int64 UIntPointer;
 #else
@@ -86,6 +86,7 @@ const destT &absolute_cast(const srcT &v)
 #include "CoreMath.h"
 #include "Containers.h"
 #include "Text.h"
+#include "NameTable.h"
 #include "File.h"
 #include "Timer.h"
 #include "Logger.h"
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+
 //-----------------------------------------------------------------------------
 // Allocators
 template<typename T>
@@ -131,7 +133,7 @@ using CPtr = Ptr<T, internal::ComAllocator<T>>;
 // Object pool
 //-----------------------------------------------------------------------------
 #ifdef _DEBUG
-// helper to check for object pool leaks
+// helper to check for object pool leaks, thread safe
 struct ObjectPoolLeakManager
 {
 	struct CallStackEntry;
@@ -145,17 +147,25 @@ private:
 };
 #endif
 
+struct ObjectPoolStats
+{
+	uint live, peak, allocated, slabs; // allocated - objects created by pool
+	uint64 gets, frees;
+};
+
 // object pool
-template<typename T>
+// when SlabSize is set objects are allocated in contiguous blocks, they are freed only when all objects are returned
+template<typename T, uint SlabSize = 0>
 struct ObjectPool
 {
-	ObjectPool() : destroyed(false)
+	ObjectPool() : stats(), destroyed(false)
 	{
 	}
 
 	~ObjectPool()
 	{
 		Cleanup();
+		DeleteSlabs();
 		destroyed = true;
 	}
 
@@ -163,18 +173,49 @@ struct ObjectPool
 	{
 		T* t;
 		if(pool.empty())
-			t = new T;
+		{
+			if(SlabSize == 0)
+			{
+				t = new T;
+				++stats.allocated;
+			}
+			else
+			{
+				AddSlab();
+				t = pool.back();
+				pool.pop_back();
+			}
+		}
 		else
 		{
 			t = pool.back();
 			pool.pop_back();
 		}
+		++stats.gets;
+		++stats.live;
+		if(stats.live > stats.peak)
+			stats.peak = stats.live;
 #ifdef _DEBUG
 		ObjectPoolLeakManager::instance.Register(t);
 #endif
 		return t;
 	}
 
+	// preallocate objects so count objects can be used without allocation (expected high-water mark)
+	void Reserve(uint count)
+	{
+		while(stats.live + pool.size() < count)
+		{
+			if(SlabSize == 0)
+			{
+				pool.push_back(new T);
+				++stats.allocated;
+			}
+			else
+				AddSlab();
+		}
+	}
+
 	void VerifyElement(T* t)
 	{
 		for(T* e : pool)
@@ -201,6 +242,8 @@ struct ObjectPool
 		ObjectPoolLeakManager::instance.Unregister(e);
 #endif
 		pool.push_back(e);
+		++stats.frees;
+		--stats.live;
 	}
 
 	void Free(vector<T*>& elems)
@@ -219,6 +262,8 @@ struct ObjectPool
 #endif
 
 		pool.insert(pool.end(), elems.begin(), elems.end());
+		stats.frees += elems.size();
+		stats.live -= elems.size();
 		elems.clear();
 	}
 
@@ -232,7 +277,9 @@ struct ObjectPool
 #ifdef _DEBUG
 			ObjectPoolLeakManager::instance.Unregister(e);
 #endif
-			delete e;
+			// objects from slabs are already deleted
+			if(SlabSize == 0)
+				delete e;
 		}
 	}
 
@@ -252,6 +299,8 @@ struct ObjectPool
 					ObjectPoolLeakManager::instance.Unregister(e);
 #endif
 					pool.push_back(e);
+					++stats.frees;
+					--stats.live;
 				}
 			}
 		}
@@ -264,7 +313,8 @@ struct ObjectPool
 #ifdef _DEBUG
 					ObjectPoolLeakManager::instance.Unregister(e);
 #endif
-					delete e;
+					if(SlabSize == 0)
+						delete e;
 				}
 			}
 		}
@@ -273,15 +323,44 @@ struct ObjectPool
 
 	void Cleanup()
 	{
-		DeleteElements(pool);
+		if(SlabSize == 0)
+			DeleteElements(pool);
+		else if(stats.live == 0)
+		{
+			pool.clear();
+			DeleteSlabs();
+		}
 	}
 
+	const ObjectPoolStats& GetStats() const { return stats; }
+
 private:
+	void AddSlab()
+	{
+		T* slab = new T[SlabSize];
+		slabs.push_back(slab);
+		// in reverse so objects are taken in order of addresses
+		for(uint i = SlabSize; i > 0; --i)
+			pool.push_back(slab + i - 1);
+		stats.allocated += SlabSize;
+		++stats.slabs;
+	}
+
+	void DeleteSlabs()
+	{
+		for(T* slab : slabs)
+			delete[] slab;
+		slabs.clear();
+		stats.slabs = 0;
+	}
+
 	vector<T*> pool;
+	vector<T*> slabs;
+	ObjectPoolStats stats;
 	bool destroyed;
 };
 
-template<typename T>
+template<typename T, uint SlabSize = 0>
 class ObjectPoolProxy
 {
 public:
@@ -290,10 +369,12 @@ public:
 	static void Free(vector<T*>& ts) { GetPool().Free(ts); }
 	static void SafeFree(vector <T*>& ts) { GetPool().SafeFree(ts); }
 	static void Cleanup() { GetPool().Cleanup(); }
+	static void Reserve(uint count) { GetPool().Reserve(count); }
+	static const ObjectPoolStats& GetPoolStats() { return GetPool().GetStats(); }
 	virtual void Free() { Free((T*)this); }
 
 private:
-	static ObjectPool<T>& GetPool() { static ObjectPool<T> pool; return pool; }
+	static ObjectPool<T, SlabSize>& GetPool() { static ObjectPool<T, SlabSize> pool; return pool; }
 };
 
 namespace internal
@@ -316,10 +397,278 @@ namespace internal
 }
 
 //-----------------------------------------------------------------------------
-extern ObjectPool<string> StringPool;
+// Thread safe object pool
+//-----------------------------------------------------------------------------
+namespace internal
+{
+	static const uint MAX_THREAD_SLOTS = 64;
+	static const uint INVALID_THREAD_SLOT = (uint)-1;
+	// index of current thread used by thread safe pools, slot is released when thread ends, INVALID_THREAD_SLOT if all are used
+	uint GetThreadSlot();
+}
+
+// Each thread have own cache of two magazines (arrays of free objects), only full & empty magazines are exchanged with
+// shared lock-free depot, so most Get/Free calls don't touch shared data.
+template<typename T>
+struct ConcurrentObjectPool
+{
+	static const uint MAGAZINE_SIZE = 32;
+
+	struct Stats
+	{
+		uint allocated, depot_gets, depot_puts, retries; // retries - failed atomic operations on depot (contention)
+	};
+
+	ConcurrentObjectPool() : stats(), destroyed(false)
+	{
+		memset(caches, 0, sizeof(caches));
+	}
+
+	~ConcurrentObjectPool()
+	{
+		Cleanup();
+		destroyed = true;
+	}
+
+	T* Get()
+	{
+		const uint slot = internal::GetThreadSlot();
+		if(slot == internal::INVALID_THREAD_SLOT)
+		{
+			++stats.allocated;
+			return Register(new T);
+		}
+
+		Cache& cache = caches[slot];
+		if(!cache.loaded || cache.loaded->count == 0)
+		{
+			if(cache.previous && cache.previous->count != 0)
+				std::swap(cache.loaded, cache.previous);
+			else
+			{
+				Magazine* mag = full.Pop(stats.retries);
+				if(!mag)
+				{
+					++stats.allocated;
+					return Register(new T);
+				}
+				++stats.depot_gets;
+				if(cache.previous)
+					empty.Push(cache.previous, stats.retries);
+				cache.previous = cache.loaded;
+				cache.loaded = mag;
+			}
+		}
+		return Register(cache.loaded->items[--cache.loaded->count]);
+	}
+
+	void Free(T* e)
+	{
+		assert(e);
+#ifdef _DEBUG
+		ObjectPoolLeakManager::instance.Unregister(e);
+#endif
+		const uint slot = internal::GetThreadSlot();
+		if(slot == internal::INVALID_THREAD_SLOT)
+		{
+			delete e;
+			return;
+		}
+
+		Cache& cache = caches[slot];
+		if(!cache.loaded || cache.loaded->count == MAGAZINE_SIZE)
+		{
+			if(cache.previous && cache.previous->count != MAGAZINE_SIZE)
+				std::swap(cache.loaded, cache.previous);
+			else
+			{
+				if(cache.previous)
+				{
+					full.Push(cache.previous, stats.retries);
+					++stats.depot_puts;
+				}
+				cache.previous = cache.loaded;
+				cache.loaded = empty.Pop(stats.retries);
+				if(!cache.loaded)
+				{
+					cache.loaded = new Magazine;
+					cache.loaded->count = 0;
+				}
+			}
+		}
+		cache.loaded->items[cache.loaded->count++] = e;
+	}
+
+	void Free(vector<T*>& elems)
+	{
+		for(T* e : elems)
+			Free(e);
+		elems.clear();
+	}
+
+	void SafeFree(T* e)
+	{
+		if(!destroyed)
+			Free(e);
+		else
+		{
+			assert(e);
+#ifdef _DEBUG
+			ObjectPoolLeakManager::instance.Unregister(e);
+#endif
+			delete e;
+		}
+	}
+
+	void SafeFree(vector<T*>& elems)
+	{
+		for(T* e : elems)
+		{
+			if(e)
+				SafeFree(e);
+		}
+		elems.clear();
+	}
+
+	// delete all free objects, can't be used when other threads use pool
+	void Cleanup()
+	{
+		for(Cache& cache : caches)
+		{
+			DeleteMagazine(cache.loaded);
+			DeleteMagazine(cache.previous);
+		}
+		while(Magazine* mag = full.Pop(stats.retries))
+			DeleteMagazine(mag);
+		while(Magazine* mag = empty.Pop(stats.retries))
+			DeleteMagazine(mag);
+	}
+
+	Stats GetStats() const { return { stats.allocated, stats.depot_gets, stats.depot_puts, stats.retries }; }
+	void ResetStats()
+	{
+		stats.allocated = 0;
+		stats.depot_gets = 0;
+		stats.depot_puts = 0;
+		stats.retries = 0;
+	}
+
+private:
+	struct Magazine
+	{
+		T* items[MAGAZINE_SIZE];
+		uint count;
+		std::atomic<Magazine*> next;
+	};
+
+	// lock-free stack of magazines, pointer is packed with tag that is changed on every operation (against ABA problem),
+	// magazines are never freed while pool is used so reading next of magazine taken by other thread is safe
+	struct Stack
+	{
+		static const uint TAG_SHIFT = sizeof(void*) == 4 ? 32 : 48;
+		static const uint64 PTR_MASK = (1ull << TAG_SHIFT) - 1;
+
+		Stack() : head(0) {}
+
+		void Push(Magazine* mag, std::atomic<uint>& retries)
+		{
+			uint64 old_head = head.load(std::memory_order_relaxed);
+			while(true)
+			{
+				mag->next.store(ToPtr(old_head), std::memory_order_relaxed);
+				if(head.compare_exchange_weak(old_head, Pack(mag, old_head), std::memory_order_release, std::memory_order_relaxed))
+					return;
+				retries.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		Magazine* Pop(std::atomic<uint>& retries)
+		{
+			uint64 old_head = head.load(std::memory_order_acquire);
+			while(true)
+			{
+				Magazine* mag = ToPtr(old_head);
+				if(!mag)
+					return nullptr;
+				Magazine* next = mag->next.load(std::memory_order_relaxed);
+				if(head.compare_exchange_weak(old_head, Pack(next, old_head), std::memory_order_acquire, std::memory_order_acquire))
+					return mag;
+				retries.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		static Magazine* ToPtr(uint64 value) { return (Magazine*)(uintptr_t)(value & PTR_MASK); }
+		static uint64 Pack(Magazine* mag, uint64 old_value) { return (uint64)(uintptr_t)mag | (((old_value >> TAG_SHIFT) + 1) << TAG_SHIFT); }
+
+		std::atomic<uint64> head;
+	};
+
+	// only used by single thread, padded to avoid false sharing
+	struct Cache
+	{
+		Magazine* loaded;
+		Magazine* previous;
+		byte padding[64 - 2 * sizeof(void*)];
+	};
+
+	struct AtomicStats
+	{
+		std::atomic<uint> allocated, depot_gets, depot_puts, retries;
+	};
+
+	static T* Register(T* e)
+	{
+#ifdef _DEBUG
+		ObjectPoolLeakManager::instance.Register(e);
+#endif
+		return e;
+	}
+
+	static void DeleteMagazine(Magazine*& mag)
+	{
+		if(!mag)
+			return;
+		for(uint i = 0; i < mag->count; ++i)
+			delete mag->items[i];
+		delete mag;
+		mag = nullptr;
+	}
+
+	Cache caches[internal::MAX_THREAD_SLOTS];
+	Stack full, empty;
+	AtomicStats stats;
+	bool destroyed;
+};
+
+//-----------------------------------------------------------------------------
+// Heap statistics, gathered by global operator new & delete replaced only in debug or profile (PROFILE define, Profile
+// configuration) build, otherwise all stats are 0
+#if defined(_DEBUG) || defined(PROFILE)
+#	define HEAP_STATS
+#endif
+
+struct HeapStats
+{
+	uint64 allocs, frees;
+	int64 size, peak_size;
+
+	static HeapStats Get();
+	static void ResetPeak();
+	static bool IsEnabled()
+	{
+#ifdef HEAP_STATS
+		return true;
+#else
+		return false;
+#endif
+	}
+};
+
+//-----------------------------------------------------------------------------
+extern ConcurrentObjectPool<string> StringPool;
 
 //-----------------------------------------------------------------------------
-// String using StringPool
+// String using StringPool, can be used from any thread
 struct LocalString
 {
 	LocalString()
@@ -6,6 +6,7 @@ public:
 	Engine();
 	~Engine();
 	void Init(GameHandler* handler);
+	void InitHeadless();
 	void Run();
 	void ShowError(cstring err);
 	void OnChangeResolution(const Int2& wnd_size);
@@ -17,7 +18,11 @@ public:
 	ResourceManager* GetResourceManager() { return res_mgr.get(); }
 	Scene* GetScene() { return scene.get(); }
 	Gui* GetGui() { return gui.get(); }
+	ThreadPool* GetThreadPool() { return thread_pool.get(); }
+	FramePipeline* GetFramePipeline() { return pipeline.get(); }
 	float GetFps() { return fps; }
+	uint GetFrameAllocs() { return frame_allocs; }
+	bool IsHeadless() { return headless; }
 
 private:
 	GameHandler* handler;
@@ -28,7 +33,11 @@ private:
 	unique_ptr<ResourceManager> res_mgr;
 	unique_ptr<Scene> scene;
 	unique_ptr<Gui> gui;
+	unique_ptr<ThreadPool> thread_pool;
+	unique_ptr<FramePipeline> pipeline;
 	Timer timer;
 	uint frames;
 	float frame_time, fps;
+	uint frame_allocs; // heap allocations in last frame, always 0 when HeapStats are disabled
+	bool headless;
 };
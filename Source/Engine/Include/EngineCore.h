@@ -5,13 +5,16 @@
 // engine
 class DebugDrawer;
 class Engine;
+class FramePipeline;
 class GameHandler;
 class Gui;
 class Input;
 class Render;
+class RenderQueue;
 class ResourceManager;
 class Scene;
 class SoundManager;
+class ThreadPool;
 class Window;
 
 // entities
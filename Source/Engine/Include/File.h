@@ -5,20 +5,59 @@ typedef void* FileHandle;
 const FileHandle INVALID_FILE_HANDLE = (FileHandle)(IntPointer)-1;
 
 //-----------------------------------------------------------------------------
+// Reading is done from memory window (whole mapped file or buffer), file is only touched when window is exhausted.
 class FileReader
 {
 public:
-	FileReader() : file(INVALID_FILE_HANDLE), own_handle(false), ok(false) {}
-	explicit FileReader(FileHandle file) : file(file), own_handle(false), ok(false) {}
-	explicit FileReader(cstring filename) { Open(filename); }
+	enum Mode
+	{
+		UNBUFFERED, // read from file on every call
+		BUFFERED,
+		MAPPED // whole file mapped to memory, fallback to buffered if it fails
+	};
+
+	static const uint BUFFER_SIZE = 64 * 1024;
+
+	FileReader() : file(INVALID_FILE_HANDLE), size(0), mode(UNBUFFERED), own_handle(false), ok(false) { ResetWindow(); }
+	explicit FileReader(FileHandle file);
+	explicit FileReader(cstring filename, Mode mode = MAPPED) : file(INVALID_FILE_HANDLE), size(0), own_handle(false), ok(false)
+	{
+		ResetWindow();
+		Open(filename, mode);
+	}
 	~FileReader();
 
-	bool Open(cstring filename);
-	void Read(void* ptr, uint size);
+	bool Open(cstring filename, Mode mode = MAPPED);
+	// read from memory (like mapped file), data must be valid until reader is closed
+	void OpenMemory(const void* data, uint size);
+	void Close();
+	void Read(void* ptr, uint size)
+	{
+		if(size <= uint(end - cur))
+		{
+			memcpy(ptr, cur, size);
+			cur += size;
+		}
+		else
+			ReadFromFile(ptr, size);
+	}
+	// return pointer to data if it is already in memory & skip it, nullptr when it must be read with Read
+	// pointer is valid until Close for mapped file, until next read for buffered file
+	const byte* ReadInPlace(uint size)
+	{
+		if(size > uint(end - cur))
+			return nullptr;
+		const byte* ptr = cur;
+		cur += size;
+		return ptr;
+	}
 	void ReadToString(string& s);
 	void Skip(uint size);
 	uint GetSize() const { return size; }
 	uint GetPos() const;
+	Mode GetMode() const { return mode; }
+	// whole file content when mapped, nullptr otherwise
+	const byte* GetMappedData() const { return mode == MAPPED ? base : nullptr; }
 
 	bool Ensure(uint elements_size) const
 	{
@@ -111,7 +150,6 @@ public:
 	{
 		ReadString<uint>(s);
 	}
-	template<>
 	void Read(string& s)
 	{
 		ReadString1(s);
@@ -172,23 +210,47 @@ public:
 	}
 
 private:
+	void ReadFromFile(void* ptr, uint size);
+	void ResetWindow() { base = cur = end = nullptr; offset = 0; mapping = nullptr; }
+
 	FileHandle file;
 	uint size;
+	Mode mode;
+	const byte* base, *cur, *end; // window, base is at offset in file
+	uint offset;
+	void* mapping;
+	vector<byte> buffer;
 	bool own_handle, ok;
 	static string buf;
 };
 
 //-----------------------------------------------------------------------------
+// Writes are collected in buffer (unless unbuffered), file is written when buffer is full, on Flush and Close.
 class FileWriter
 {
 public:
-	FileWriter() : file(INVALID_FILE_HANDLE), own_handle(true) {}
-	explicit FileWriter(FileHandle file) : file(file), own_handle(false) {}
-	explicit FileWriter(cstring filename) : own_handle(true) { Open(filename); }
+	enum Mode
+	{
+		UNBUFFERED,
+		BUFFERED
+	};
+
+	static const uint BUFFER_SIZE = 64 * 1024;
+
+	FileWriter() : file(INVALID_FILE_HANDLE), mode(BUFFERED), own_handle(true) {}
+	explicit FileWriter(FileHandle file) : file(file), mode(UNBUFFERED), own_handle(false) {}
+	explicit FileWriter(cstring filename, Mode mode = BUFFERED) : file(INVALID_FILE_HANDLE), own_handle(true) { Open(filename, mode); }
 	~FileWriter();
 
-	bool Open(cstring filename);
-	void Write(const void* ptr, uint size);
+	bool Open(cstring filename, Mode mode = BUFFERED);
+	void Close();
+	void Write(const void* ptr, uint size)
+	{
+		if(mode == BUFFERED && buffer.size() + size <= BUFFER_SIZE)
+			buffer.insert(buffer.end(), (const byte*)ptr, (const byte*)ptr + size);
+		else
+			WriteToFile(ptr, size);
+	}
 	void Flush();
 	uint GetSize() const;
 	bool IsOpen() const { return file != INVALID_FILE_HANDLE; }
@@ -254,7 +316,6 @@ public:
 		WriteString<uint>(str);
 	}
 
-	template<>
 	void Write(const string& s)
 	{
 		WriteString1(s);
@@ -299,7 +360,7 @@ public:
 	template<typename T>
 	void WriteVector4(const vector<T>& v)
 	{
-		WriteVector<short>(v);
+		WriteVector<uint>(v);
 	}
 	template<typename T>
 	void Write(const vector<T>& v)
@@ -313,7 +374,12 @@ public:
 	}
 
 private:
+	void WriteToFile(const void* ptr, uint size);
+	void WriteBuffer();
+
 	FileHandle file;
+	Mode mode;
+	vector<byte> buffer;
 	bool own_handle;
 };
 
@@ -366,4 +432,8 @@ namespace io
 	bool FileExists(Cstring path);
 	void DeleteFile(Cstring path);
 	bool LoadFileToString(Cstring path, string& str, uint max_size = (uint)-1);
+	// find files with extension (without dot, empty for all files) in dir & subdirectories, paths are relative to dir
+	void FindFiles(Cstring dir, Cstring ext, vector<string>& files);
+	// number of calls to operating system by file functions (reads, writes, seeks, etc)
+	uint64 GetSyscallsCount();
 }
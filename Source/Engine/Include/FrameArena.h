@@ -0,0 +1,69 @@
+#pragma once
+
+// Linear allocator for transient data, everything is freed at once by Reset (destructors are not called).
+// When current block is full new one is allocated, on Reset blocks are merged so next frame fits in single block.
+// Each thread have own arena (Get) that is reset on first use in new frame, memory is valid until end of frame.
+class FrameArena
+{
+public:
+	struct Stats
+	{
+		uint size, peak_size, capacity, blocks_allocated;
+	};
+
+	static const uint DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+	explicit FrameArena(uint block_size = DEFAULT_BLOCK_SIZE);
+	~FrameArena();
+	void* Alloc(uint size, uint align = 16);
+	template<typename T>
+	T* Alloc(uint count = 1) { return (T*)Alloc(sizeof(T) * count, alignof(T)); }
+	void Reset();
+
+	const Stats& GetStats() const { return stats; }
+
+	// arena of current thread
+	static FrameArena& Get();
+	// called by engine at end of frame, thread arenas are reset when used next time
+	static void NextFrame();
+	// max size used in single frame by any thread arena (updated when arena is reset)
+	static uint GetFramePeakSize();
+
+private:
+	struct Block
+	{
+		byte* data;
+		uint size;
+	};
+
+	void AddBlock(uint size);
+
+	vector<Block> blocks; // last is current
+	uint block_size, pos, frame;
+	Stats stats;
+};
+
+// STL allocator using FrameArena, deallocate does nothing
+template<typename T>
+struct ArenaAllocator
+{
+	typedef T value_type;
+
+	ArenaAllocator() : arena(&FrameArena::Get()) {}
+	ArenaAllocator(FrameArena& arena) : arena(&arena) {}
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& a) : arena(a.arena) {}
+
+	T* allocate(size_t count) { return (T*)arena->Alloc(uint(sizeof(T) * count), alignof(T)); }
+	void deallocate(T*, size_t) {}
+
+	template<typename U>
+	bool operator == (const ArenaAllocator<U>& a) const { return arena == a.arena; }
+	template<typename U>
+	bool operator != (const ArenaAllocator<U>& a) const { return arena != a.arena; }
+
+	FrameArena* arena;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Runs simulation of next frame on separate thread while main thread draws snapshot of previous one.
+// Start/Wait must be called from the same thread, task can't touch data used by main thread until Wait returns.
+class FramePipeline
+{
+public:
+	FramePipeline();
+	~FramePipeline();
+	void Init();
+	void Shutdown();
+	// without thread task is done immediately
+	void Start(delegate<void()> task);
+	// blocks until task is done, rethrows task error
+	void Wait();
+
+	bool IsParallel() const { return thread.joinable(); }
+	bool IsRunning() const { return running; }
+
+private:
+	void ThreadLoop();
+
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable cv_work, cv_done;
+	delegate<void()> task;
+	string error;
+	bool running, has_task, failed, quit;
+};
@@ -4,4 +4,6 @@ class GameHandler
 {
 public:
 	virtual bool OnTick(float dt) = 0;
+	// called after OnTick on separate thread while previous frame is drawn, can't use gui, render or window
+	virtual void OnUpdate(float dt) {}
 };
@@ -13,7 +13,8 @@ struct Mesh final : Resource
 		F_ANIMATED = 1 << 1, // have bones, bone groups, animations
 		F_USE_PARENT_BONES = 1 << 2, // mesh don't have bones, use parent
 		F_PHYSICS = 1 << 3,
-		F_SPLIT = 1 << 4
+		F_SPLIT = 1 << 4,
+		F_INDEX32 = 1 << 5 // 32 bit index buffer, only for meshes created by MeshBuilder
 	};
 
 	enum VertexLayout
@@ -36,9 +37,9 @@ struct Mesh final : Resource
 
 	struct Submesh
 	{
-		word first; // first triangle to render
-		word tris; // how many triangles to render
-		word min_ind; // minimum trangle index
+		uint first; // first triangle to render
+		uint tris; // how many triangles to render
+		uint min_ind; // minimum trangle index
 		string name;
 		Texture* tex, *tex_normal, *tex_specular;
 		Vec3 specular_color;
@@ -64,6 +65,7 @@ struct Mesh final : Resource
 		word parent;
 		Matrix mat;
 		string name;
+		NameId name_id;
 		vector<word> childs;
 
 		static const uint MIN_SIZE = 51;
@@ -84,19 +86,37 @@ struct Mesh final : Resource
 	struct Keyframe
 	{
 		float time;
-		vector<KeyframeBone> bones;
+		uint bones_offset; // index of first bone in Animation::bones (not pointer so animation can be copied or moved)
+	};
+
+	// keyframes of 4 bones in SoA layout, used by vectorized animation
+	struct KeyframeBlock
+	{
+		XMFLOAT4 pos_x, pos_y, pos_z, rot_x, rot_y, rot_z, rot_w, scale;
+	};
+
+	// 4 bone matrices in SoA layout, m[i][j] contains element (i,j) of each matrix
+	struct MatrixBlock
+	{
+		XMFLOAT4 m[4][4];
 	};
 
 	struct Animation
 	{
 		string name;
+		NameId name_id;
 		float length;
 		word n_frames;
 		vector<Keyframe> frames;
+		vector<KeyframeBone> bones; // keyframe bones of all frames in single allocation, n_frames * bones
+		vector<KeyframeBlock> blocks; // n_frames * bone_blocks
+		float frame_step; // time between frames when they are evenly spaced, 0 otherwise
 
 		static const uint MIN_SIZE = 7;
 
-		int GetFrameIndex(float time, bool& hit);
+		const KeyframeBone* GetFrameBones(uint frame) const { return &bones[frames[frame].bones_offset]; }
+		void SetupFrameStep();
+		int GetFrameIndex(float time, bool& hit, word* cursor = nullptr);
 		void GetKeyframeData(uint bone, float time, KeyframeBone& keyframe);
 	};
 
@@ -110,6 +130,7 @@ struct Mesh final : Resource
 		};
 
 		string name;
+		NameId name_id;
 		Matrix mat;
 		Vec3 rot;
 		word bone;
@@ -125,14 +146,21 @@ struct Mesh final : Resource
 	Mesh(cstring name);
 	~Mesh();
 	void SetupBoneMatrices();
-	Animation* GetAnimation(cstring name);
-	Bone* GetBone(cstring name);
-	Point* GetPoint(cstring name);
+	void SetupAnimationBlocks();
+	void GetAnimationMatrices(Animation& anim, float time, Matrix* out, word* cursor = nullptr) const;
+	// names are compared by interned id, missing name is not added to NameTable
+	Animation* GetAnimation(cstring name) { return GetAnimation(NameTable::Find(name)); }
+	Animation* GetAnimation(NameId id);
+	Bone* GetBone(cstring name) { return GetBone(NameTable::Find(name)); }
+	Bone* GetBone(NameId id);
+	Point* GetPoint(cstring name) { return GetPoint(NameTable::Find(name)); }
+	Point* GetPoint(NameId id);
 	Point* FindPoint(cstring start);
 	bool HavePoint(Point* point);
 
 	bool IsAnimated() const { return IS_SET(head.flags, F_ANIMATED); }
 	bool IsUsingParentBones() const { return IS_SET(head.flags, F_USE_PARENT_BONES); }
+	bool IsIndex32() const { return IS_SET(head.flags, F_INDEX32); }
 
 	Header head;
 	VertexLayout layout;
@@ -144,6 +172,9 @@ struct Mesh final : Resource
 	vector<Point> attach_points;
 	vector<BoneGroup> groups;
 	vector<Matrix> model_to_bone;
+	vector<MatrixBlock> bone_mat_blocks;
+	uint bone_blocks;
 	vector<byte> vertex_data;
 	vector<word> index_data;
+	vector<uint> index_data32; // for F_INDEX32
 };
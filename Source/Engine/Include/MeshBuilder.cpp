@@ -1,11 +1,13 @@
 #include "EngineCore.h"
 #include "MeshBuilder.h"
 #include "Mesh.h"
+#include "ResourceManager.h"
+#include "Texture.h"
 
 void MeshBuilder::Append(Mesh* mesh, const Matrix& matrix)
 {
 	assert(mesh && !mesh->vertex_data.empty());
-	assert(mesh->layout == Mesh::VERTEX_NORMAL); // YAGNI
+	assert(mesh->layout == Mesh::VERTEX_NORMAL && !mesh->IsIndex32()); // YAGNI
 
 	const uint vertex_size = sizeof(Vertex);
 
@@ -41,7 +43,7 @@ void MeshBuilder::Append(Mesh* mesh, const Matrix& matrix)
 
 		// copy indices
 		Submesh& sub_info = subs[sub_index];
-		sub_info.indices.reserve(index_offset + sub.tris * 3);
+		sub_info.indices.reserve(sub_info.indices.size() + sub.tris * 3);
 		for(uint i = 0; i < sub.tris * 3u; ++i)
 			sub_info.indices.push_back(mesh->index_data[i + sub.first * 3] + index_offset);
 	}
@@ -89,5 +91,32 @@ void MeshBuilder::JoinIndices()
 
 	indices.resize(total);
 	for(Submesh& sub : subs)
-		memcpy(indices.data() + sub.first * 3, sub.indices.data(), sub.indices.size() * sizeof(word));
+		memcpy(indices.data() + sub.first * 3, sub.indices.data(), sub.indices.size() * sizeof(uint));
+}
+
+// save vertices & submeshes (before JoinIndices)
+void MeshBuilder::Save(FileWriter& f)
+{
+	f.WriteVector4(vertices);
+	f.WriteCasted<byte>(subs.size());
+	for(Submesh& sub : subs)
+	{
+		f << (sub.tex ? sub.tex->name : string());
+		f.WriteVector4(sub.indices);
+	}
+}
+
+void MeshBuilder::Load(FileReader& f, ResourceManager* res_mgr)
+{
+	assert(res_mgr);
+	Clear();
+	f.ReadVector4(vertices);
+	subs.resize(f.Read<byte>());
+	for(Submesh& sub : subs)
+	{
+		const string& tex = f.ReadString1();
+		sub.tex = (tex.empty() ? nullptr : res_mgr->GetTexture(tex));
+		f.ReadVector4(sub.indices);
+	}
+	index_offset = vertices.size();
 }
@@ -7,17 +7,23 @@ struct MeshBuilder
 	struct Submesh
 	{
 		Texture* tex;
-		vector<word> indices;
+		vector<uint> indices;
 		uint tris, first;
 	};
 
+	MeshBuilder() : index_offset(0) {}
 	void Append(Mesh* mesh, const Matrix& matrix);
 	void Clear();
 	void GenerateIndices();
 	void JoinIndices();
+	void Save(FileWriter& f);
+	void Load(FileReader& f, ResourceManager* res_mgr);
+
+	// indices don't fit in 16 bits, mesh will use 32 bit index buffer
+	bool IsIndex32() const { return vertices.size() > 0x10000; }
 
 	vector<Vertex> vertices;
-	vector<word> indices;
+	vector<uint> indices;
 	vector<Submesh> subs;
 	uint index_offset;
 };
@@ -20,6 +20,16 @@ enum PLAY_FLAGS
 	PLAY_MANUAL = 0x800
 };
 
+//-----------------------------------------------------------------------------
+// animation level of detail, used when drawing distant units
+enum ANIM_LOD
+{
+	ANIM_LOD_FULL, // update bones every frame
+	ANIM_LOD_HALF, // update bones every 2nd frame
+	ANIM_LOD_QUARTER, // update bones every 4th frame, use closest keyframe without interpolation
+	ANIM_LOD_MAX
+};
+
 //-----------------------------------------------------------------------------
 struct MeshInstance
 {
@@ -44,7 +54,7 @@ public:
 	{
 		friend struct MeshInstance;
 
-		Group() : anim(nullptr), state(0), speed(1.f), prio(0), blend_max(0.33f), frame_end_info(false)
+		Group() : anim(nullptr), state(0), speed(1.f), prio(0), blend_max(0.33f), frame(0), frame_end_info(false)
 		{
 		}
 
@@ -56,7 +66,7 @@ public:
 		bool IsBlending() const { return IS_SET(state, FLAG_BLENDING); }
 		bool IsPlaying() const { return IS_SET(state, FLAG_PLAYING); }
 
-		int GetFrameIndex(bool& hit) const { return anim->GetFrameIndex(time, hit); }
+		int GetFrameIndex(bool& hit) { return anim->GetFrameIndex(time, hit, &frame); }
 		float GetBlendT() const;
 		float GetProgress() const { return time / anim->length; }
 		Mesh::Animation* GetAnimation() const { return anim; }
@@ -65,6 +75,7 @@ public:
 		Mesh::Animation* anim;
 		float time, speed, blend_time, blend_max;
 		int state, prio, used_group;
+		word frame; // cursor for GetFrameIndex
 		bool frame_end_info;
 	};
 
@@ -76,9 +87,14 @@ public:
 	{
 		Play(mesh->GetAnimation(name), flags, group);
 	}
+	void Play(NameId name, int flags, uint group)
+	{
+		Play(mesh->GetAnimation(name), flags, group);
+	}
 	void Stop(uint group = 0) { GetGroup(group).Stop(); }
 	void Deactivate(uint group = 0, bool in_update = false);
 	void SetupBones();
+	bool SetupBones(ANIM_LOD lod, uint frame);
 	void SetupBlending(uint group, bool first = true, bool in_update = false);
 	void ClearBones();
 	void SetToEnd(cstring anim) { SetToEnd(mesh->GetAnimation(anim)); }
@@ -123,9 +139,12 @@ public:
 	const vector<Matrix>& GetMatrixBones() const { return mat_bones; }
 
 private:
+	void UpdateBones(bool snap);
+
 	Mesh* mesh;
 	vector<Matrix> mat_bones;
 	vector<Mesh::KeyframeBone> blendb;
 	vector<Group> groups;
-	bool need_update;
+	uint lod_offset;
+	bool need_update, have_bones;
 };
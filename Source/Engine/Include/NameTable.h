@@ -0,0 +1,20 @@
+#pragma once
+
+//-----------------------------------------------------------------------------
+typedef uint NameId; // 0 is empty name
+
+//-----------------------------------------------------------------------------
+// Interned names, same names (ignoring case) have same id so comparing names is comparing ids.
+// Names are never removed so ids & name pointers are stable. Thread safe, GetName don't lock.
+class NameTable
+{
+public:
+	// add name if missing
+	static NameId Add(cstring name);
+	// return 0 when name wasn't added
+	static NameId Find(cstring name);
+	static cstring GetName(NameId id);
+	static uint GetCount();
+	// case insensitive FNV-1a
+	static uint Hash(cstring name);
+};
@@ -8,7 +8,7 @@ enum PARTICLE_OP
 };
 
 //-----------------------------------------------------------------------------
-struct ParticleEmitter : ObjectPoolProxy<ParticleEmitter>
+struct ParticleEmitter : ObjectPoolProxy<ParticleEmitter, 64>
 {
 	Texture* tex;
 	float emision_interval, life, particle_life, alpha, size;
@@ -1,5 +1,9 @@
 #pragma once
 
+// Implicit quadtree without pointers, nodes are identified by level & index (or single id).
+// Children boxes are stored in SoA groups of 4 so they can be tested against frustum at once.
+// Nodes at each level are ordered along Z-order curve, so each node contain continuous range of nodes at lower levels.
+// Can be used as loose quadtree (node bounds are twice as big) for moving objects.
 struct QuadTree
 {
 	enum Index
@@ -10,38 +14,46 @@ struct QuadTree
 		RIGHT_BOTTOM
 	};
 
-	struct Factory;
-
-	struct Part
+	// range of nodes at level [start, end)
+	struct Range
 	{
-		void Remove(Factory* factory);
-		bool IsLeaf() const { return size == 0; }
-
-		Box2d box;
-		uint size;
-		Part* childs[4];
+		uint level, start, end;
 	};
 
-	struct Factory
-	{
-		virtual Part* Create() { return new Part; }
-		virtual void Remove(Part* part) { delete part; }
-	};
+	static const uint MAX_SPLITS = 12;
+	static const uint INVALID_NODE = (uint)-1;
+	// nodes don't have height, objects centers should be in this range (loose nodes are extended by half node size)
+	static constexpr float MIN_Y = 0.f;
+	static constexpr float MAX_Y = 25.f;
 
 	QuadTree();
-	~QuadTree();
-	void Init(float size, uint splits, Factory* factory = nullptr);
+	void Init(float size, uint splits);
 	Int2 PosToIndex(const Vec2& pos);
-	void ListVisibleParts(FrustumPlanes& frustum, vector<Part*>& parts);
-	void ForEach(delegate<void(Part*)> callback, bool leaf_only = true);
+	void ListVisibleLeafs(const FrustumPlanes& frustum, vector<Range>& ranges) { ListVisible(frustum, false, ranges); }
+	void ListVisibleLooseNodes(const FrustumPlanes& frustum, vector<Range>& ranges) { ListVisible(frustum, true, ranges); }
+
+	uint GetLeafIndex(const Int2& pt);
+	uint GetLeafIndex(const Vec2& pos);
+	uint GetLeafsCount() const { return leafs; }
+	Box2d GetLeafBox(uint index) const;
+	uint GetLooseNodeId(const Vec2& pos, float radius);
+	uint GetNodesCount() const { return GetNodeId(splits + 1, 0); }
+	uint GetSplits() const { return splits; }
 
-	Part* GetPart(const Int2& pt);
-	Part* GetPart(const Vec2& pos);
-	Part* GetRoot() { return root; }
+	static uint GetNodeId(uint level, uint index) { return (((1u << (2 * level)) - 1) / 3) + index; }
 
 private:
-	Factory* factory;
-	Part* root;
-	vector<Part*> c;
-	float leaf_size;
+	// boxes of 4 childs of node
+	struct Group
+	{
+		XMFLOAT4 min_x, min_z, max_x, max_z;
+	};
+
+	void ListVisible(const FrustumPlanes& frustum, bool loose, vector<Range>& ranges);
+	// group of childs for node at level
+	uint GetGroupIndex(uint level, uint index) const { return 1 + GetNodeId(level, index); }
+
+	vector<Group> groups; // first group contains only root
+	uint splits, leafs;
+	float size, leaf_size;
 };
@@ -0,0 +1,63 @@
+#pragma once
+
+// List of nodes to draw sorted by state (shader mode, texture, mesh). Nodes with same static mesh are packed into instanced batches.
+// Only CPU side, drawing is done by MeshShader. After Build it don't reference nodes (world matrices & bones are copied),
+// so it can be drawn while simulation of next frame is running.
+class RenderQueue
+{
+public:
+	enum Mode
+	{
+		MODE_NONE,
+		MODE_MESH, // instanced
+		MODE_ANIMATED,
+		MODE_ANIMATED_NO_INST
+	};
+
+	struct Batch
+	{
+		Mode mode;
+		Mesh* mesh;
+		Vec4 tint;
+		int subs;
+		uint first, count; // world matrices, count > 1 only for MODE_MESH
+		uint first_bone, bones; // bones matrices for MODE_ANIMATED
+	};
+
+	struct Stats
+	{
+		uint nodes, batches, draw_calls, state_changes;
+		uint unsorted_draw_calls, unsorted_state_changes; // when drawing each node separately in original order
+	};
+
+	static const uint MAX_INSTANCES = 256;
+
+	void Clear();
+	void Add(SceneNode* node);
+	void Build(bool sort = true);
+
+	const vector<Batch>& GetBatches() const { return batches; }
+	const vector<Matrix>& GetMatrices() const { return matrices; }
+	const vector<Matrix>& GetBones() const { return bones; }
+	const Stats& GetStats() const { return stats; }
+
+private:
+	struct Entry
+	{
+		Mode mode;
+		Texture* tex;
+		Mesh* mesh;
+		MeshInstance* mesh_inst;
+		SceneNode* node;
+	};
+
+	static Mode GetMode(SceneNode* node);
+	static Texture* GetFirstTexture(Mesh* mesh, int subs);
+	void CountUnsorted();
+	void CountSorted();
+
+	vector<Entry> entries;
+	vector<Batch> batches;
+	vector<Matrix> matrices, bones;
+	Stats stats;
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+typedef NameId ResourceId; // interned resource name
+
 struct Resource
 {
 	enum class Type
@@ -11,10 +13,21 @@ struct Resource
 		Music
 	};
 
-	Resource() {}
-	Resource(cstring name, Type type) : name(name), type(type) {}
+	// resources requested asynchronously are Loading until finished by ResourceManager::Update
+	enum class State
+	{
+		Loading,
+		Ready,
+		Failed
+	};
+
+	Resource() : id(0), state(State::Ready) {}
+	Resource(cstring name, Type type) : name(name), id(NameTable::Add(name)), type(type), state(State::Ready) {}
 	virtual ~Resource() {}
+	bool IsReady() const { return state == State::Ready; }
 
 	string name;
+	ResourceId id;
 	Type type;
+	std::atomic<State> state;
 };
@@ -1,40 +1,111 @@
 #pragma once
 
 #include "Resource.h"
+#include "ThreadPool.h"
+
+class Archive;
+struct TextureData;
 
 class ResourceManager
 {
 public:
+	enum class Priority
+	{
+		Low,
+		Normal,
+		High
+	};
+
 	ResourceManager();
 	~ResourceManager();
-	void Init(Render* render, SoundManager* sound_mgr);
+	void Init(Render* render, SoundManager* sound_mgr, ThreadPool* thread_pool);
+	// files are searched in archives (last mounted first) before loose files in Data, must be called before loading
+	bool Mount(Cstring path);
 
 	void AddFontFromFile(Cstring name);
 	Font* GetFont(Cstring name, int size);
-	Mesh* GetMesh(Cstring name);
-	Mesh* GetMeshRaw(Cstring name);
-	Music* GetMusic(Cstring name);
-	Sound* GetSound(Cstring name);
-	Texture* GetTexture(Cstring name);
+	Mesh* GetMesh(Cstring name) { return GetMesh(NameTable::Add(name)); }
+	Mesh* GetMesh(ResourceId id);
+	Mesh* GetMeshRaw(Cstring name) { return GetMeshRaw(NameTable::Add(name)); }
+	Mesh* GetMeshRaw(ResourceId id);
+	Music* GetMusic(Cstring name) { return GetMusic(NameTable::Add(name)); }
+	Music* GetMusic(ResourceId id);
+	Sound* GetSound(Cstring name) { return GetSound(NameTable::Add(name)); }
+	Sound* GetSound(ResourceId id);
+	Texture* GetTexture(Cstring name) { return GetTexture(NameTable::Add(name)); }
+	Texture* GetTexture(ResourceId id);
 	Mesh* CreateMesh(MeshBuilder* mesh_builder);
+	// load mesh data without adding it to resources, caller must delete it
+	Mesh* LoadMeshRaw(Cstring name, FileReader::Mode mode = FileReader::MAPPED);
+
+	// return handle immediately, file is read & decoded on worker thread (higher priority first), gpu upload is done in Update
+	Mesh* GetMeshAsync(Cstring name, Priority priority = Priority::Normal) { return GetMeshAsync(NameTable::Add(name), priority); }
+	Mesh* GetMeshAsync(ResourceId id, Priority priority = Priority::Normal);
+	Sound* GetSoundAsync(Cstring name, Priority priority = Priority::Normal) { return GetSoundAsync(NameTable::Add(name), priority); }
+	Sound* GetSoundAsync(ResourceId id, Priority priority = Priority::Normal);
+	Texture* GetTextureAsync(Cstring name, Priority priority = Priority::Normal) { return GetTextureAsync(NameTable::Add(name), priority); }
+	Texture* GetTextureAsync(ResourceId id, Priority priority = Priority::Normal);
+	// callback is called on main thread when resource is ready
+	void OnLoaded(Resource* res, delegate<void(Resource*)> callback);
+	// finish loaded resources, must be called on main thread
+	void Update();
+	void WaitForAll();
+	uint GetPendingCount() const { return pending; }
 
 private:
-	struct ResourceComparer
+	struct FontEntry
+	{
+		NameId family;
+		int size;
+		Font* font;
+	};
+
+	struct Request
+	{
+		Resource* res;
+		Priority priority;
+		uint index; // requests with same priority are loaded in order
+		string data; // file content for texture & sound, decompressed mesh from archive
+		unique_ptr<TextureData> tex_data; // texture decoded on worker thread
+		string error;
+	};
+
+	// ordering of requests heap, highest priority on top
+	struct RequestComparer
 	{
-		bool operator () (const Resource* r1, const Resource* r2) const
+		bool operator () (const Request* r1, const Request* r2) const
 		{
-			return _stricmp(r1->name.c_str(), r2->name.c_str()) > 0;
+			if(r1->priority != r2->priority)
+				return r1->priority < r2->priority;
+			return r1->index > r2->index;
 		}
 	};
-	typedef std::set<Resource*, ResourceComparer> ResourceContainer;
-	typedef ResourceContainer::iterator ResourceIterator;
 
-	Resource* Get(cstring name, Resource::Type type);
+	Resource* Get(ResourceId id, Resource::Type type);
+	Resource* Find(ResourceId id) const;
+	void Insert(Resource* res);
+	Resource* Add(Resource* res);
+	Resource* GetAsync(ResourceId id, Resource::Type type, Priority priority);
+	void LoadWorker();
+	void Load(Request& request);
+	void Finish(Request& request);
+	void Wait(Resource* res);
+	const byte* FindInArchives(cstring name, string& buf, uint& size);
+	void OpenFile(cstring name, FileReader& f, string& buf, FileReader::Mode mode = FileReader::MAPPED);
+	bool ReadFromArchives(cstring name, string& data);
 
 	unique_ptr<TextureLoader> tex_loader;
 	unique_ptr<QmshLoader> qmsh_loader;
 	unique_ptr<FontLoader> font_loader;
 	unique_ptr<SoundLoader> sound_loader;
-	ResourceContainer resources;
-	Resource res_search;
+	vector<Resource*> resources; // indexed by id, nullptr when not loaded
+	vector<FontEntry> fonts;
+	vector<Archive*> archives;
+	ThreadPool* thread_pool;
+	ThreadPool::Counter counter;
+	std::mutex mutex; // guards resources, requests & loaded
+	vector<Request*> requests, loaded, finished;
+	vector<std::pair<Resource*, delegate<void(Resource*)>>> callbacks;
+	std::atomic<uint> pending;
+	uint request_index;
 };
@@ -1,14 +1,28 @@
 #pragma once
 
+#include "QuadTree.h"
+#include "RenderQueue.h"
+
 class Scene
 {
 public:
+	// bones updates of animated nodes in last frame
+	struct AnimationStats
+	{
+		uint updated[3]; // for each ANIM_LOD
+		uint skipped; // throttled or already up to date
+	};
+
 	Scene();
 	~Scene();
 	void Init(Render* render, ResourceManager* res_mgr);
 	void Reset();
 	void InitQuadTree(float size, uint splits);
-	void Draw();
+	void Prepare();
+	void DrawSkybox();
+	void DrawNodes();
+	void DrawParticles();
+	void DrawDebug();
 	void Update(float dt);
 	void Add(SceneNode* node);
 	void Add(ParticleEmitter* pe);
@@ -17,6 +31,7 @@ public:
 	void OnChangeResolution(const Int2& wnd_size);
 
 	void SetAmbientColor(const Vec3& ambient_color) { this->ambient_color = ambient_color; }
+	void SetAnimationLodDistances(float half, float quarter) { anim_lod_dist[0] = half; anim_lod_dist[1] = quarter; }
 	void SetDebugDrawEnabled(bool enabled) { debug_draw_enabled = enabled; }
 	void SetDebugDrawHandler(delegate<void(DebugDrawer*)> handler) { debug_draw_handler = handler; }
 	void SetFogColor(const Vec3& fog_color) { this->fog_color = fog_color; }
@@ -27,6 +42,7 @@ public:
 	void SetSky(Sky* sky) { this->sky = sky; }
 
 	const Vec3& GetAmbientColor() { return ambient_color; }
+	const AnimationStats& GetAnimationStats() { return anim_stats; }
 	Camera* GetCamera() { return camera.get(); }
 	const Vec3& GetFogColor() { return fog_color; }
 	Vec2 GetFogParams() { return fog_params.XY(); }
@@ -36,15 +52,25 @@ public:
 	Sky* GetSky() { return sky; }
 	const Matrix& GetViewProjectionMatrix() { return mat_view_proj; }
 	QuadTree* GetQuadTree() { return quad_tree.get(); }
+	const RenderQueue& GetRenderQueue(bool alpha = false) { return alpha ? alpha_queue : queue; }
+	RenderQueue::Stats GetRenderStats();
+	ScenePart* GetPart(const Int2& pt);
 
 private:
-	void DrawSkybox();
-	void DrawNodes();
-	void DrawNodes(vector<SceneNode*>& nodes, const Matrix* parent_matrix);
-	void DrawParticles();
+	// lighting copied in Prepare, can be changed by simulation while nodes are drawn
+	struct Lighting
+	{
+		Vec3 fog_color, fog_params, light_dir, light_color, ambient_color;
+	};
+
+	uint GetCell(SceneNode* node);
+	void AddToCell(SceneNode* node, uint cell);
+	void RemoveFromCell(SceneNode* node);
+	void SetupBones(MeshInstance* mesh_inst, const Vec3& pos);
 	void UpdateNodes(vector<SceneNode*>& nodes, float dt);
 	void ListVisibleNodes();
 	void ListVisibleNodes(vector<SceneNode*>& nodes);
+	void QueueNodes(vector<SceneNode*>& nodes, RenderQueue& queue);
 
 	Render* render;
 	unique_ptr<MeshShader> mesh_shader;
@@ -56,13 +82,21 @@ private:
 	vector<SceneNode*> nodes, visible_nodes, visible_alpha_nodes;
 	vector<ParticleEmitter*> pes, visible_pes;
 	Matrix mat_view, mat_view_proj;
+	Vec3 cam_pos;
+	Lighting lighting;
 	Vec3 fog_color, fog_params,  light_dir, light_color, ambient_color;
 	FrustumPlanes frustum_planes;
-	unique_ptr<QuadTree> quad_tree;
-	vector<ScenePart*> parts;
+	unique_ptr<QuadTree> quad_tree, dynamic_tree;
+	vector<ScenePart> parts;
+	vector<vector<SceneNode*>> cells; // nodes in dynamic_tree, last one is for nodes outside of it
+	vector<QuadTree::Range> visible_ranges;
+	RenderQueue queue, alpha_queue;
 	vector<MeshInstance*> mesh_inst_pool;
 	Mesh* skybox;
 	Sky* sky;
 	delegate<void(DebugDrawer*)> debug_draw_handler;
+	AnimationStats anim_stats;
+	float anim_lod_dist[2];
+	uint frame;
 	bool debug_draw_enabled;
 };
@@ -17,7 +17,8 @@ struct SceneNode
 	};
 
 	SceneNode() : parent(nullptr), parent_point(nullptr), mesh(nullptr), mesh_inst(nullptr), tint(Vec4::One), subs(0xFFFFFFFF), visible(true),
-		container(nullptr), scale(1.f), alpha(false), use_matrix(false) {}
+		container(nullptr), scale(1.f), alpha(false), use_matrix(false), is_static(false), scene_index(0), cell(0), cell_index(0), version(0),
+		parent_version(0) {}
 	~SceneNode();
 	void Add(SceneNode* node, MeshPoint* point = nullptr);
 
@@ -26,6 +27,7 @@ struct SceneNode
 	MeshInstance* GetMeshInstance();
 	SceneNode* GetParent() { return parent; }
 	MeshPoint* GetParentPoint() { return parent_point; }
+	const Matrix& GetWorldMatrix() const { return mat_world; }
 
 	static MeshPoint* USE_PARENT_BONES;
 
@@ -43,10 +45,19 @@ struct SceneNode
 		Matrix mat;
 	};
 	int subs;
-	bool visible, alpha, use_matrix;
+	bool visible, alpha, use_matrix,
+		is_static; // transform never changes after first frame
 
 private:
+	bool UpdateTransform();
+
 	SceneNode* parent;
 	MeshPoint* parent_point;
 	vector<SceneNode*> childs;
+	uint scene_index, cell, cell_index; // position in Scene nodes & loose quadtree cell
+	// cached world transform, recalculated when pos/rot/scale/mat or parent changes
+	Matrix mat_world, prev_transform;
+	Vec3 sphere_center;
+	float sphere_radius;
+	uint version, parent_version;
 };
@@ -1,12 +1,10 @@
 #pragma once
 
-#include "QuadTree.h"
-
-struct ScenePart : QuadTree::Part
+// static nodes inside single quadtree leaf
+struct ScenePart
 {
 	friend class Scene;
 
-	~ScenePart();
 	void Add(SceneNode* node);
 	void Reset();
 
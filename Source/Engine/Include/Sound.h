@@ -8,6 +8,7 @@ struct Sound : public Resource
 	~Sound();
 
 	FMOD::Sound* snd;
+	string data; // file content when loaded asynchronously or from archive, sound is streamed from it
 };
 
 struct Music : public Resource
@@ -16,4 +17,5 @@ struct Music : public Resource
 	~Music();
 
 	FMOD::Sound* snd;
+	string data; // file content when loaded from archive
 };
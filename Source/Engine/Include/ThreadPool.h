@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Work-stealing job system with fixed worker threads.
+// Each thread have own queue, jobs are taken from back of own queue & stolen from front of other queues.
+// Threads waiting for jobs (Wait, ParallelFor) also execute jobs. All non worker threads share queue 0.
+// Low priority jobs (long background work like io or navmesh) are in separate queue, executed only by idle workers
+// (at most half of them at once) so they never delay frame jobs.
+class ThreadPool
+{
+public:
+	struct Counter;
+
+private:
+	struct Job
+	{
+		delegate<void()> action;
+		delegate<void(uint)> for_action; // called for each index in [start, end)
+		uint start, end;
+		Counter* counter;
+	};
+
+public:
+	// number of unfinished jobs, jobs with dependency are started when it reaches zero
+	struct Counter
+	{
+		friend class ThreadPool;
+
+		Counter() : value(0) {}
+		bool IsDone() const { return value == 0; }
+
+	private:
+		std::atomic<uint> value;
+		std::mutex mutex;
+		vector<Job> waiting;
+	};
+
+	struct Stats
+	{
+		uint64 jobs, stolen;
+	};
+
+	ThreadPool();
+	~ThreadPool();
+	void Init(uint threads_count = 0);
+	void Shutdown();
+	// add job, counter is increased until job is done, job is started after dependency is done
+	void Submit(delegate<void()> action, Counter* counter = nullptr, Counter* dependency = nullptr);
+	// add jobs calling action for each index in [0, count), split into chunks (0 - automatic size)
+	void SubmitFor(uint count, delegate<void(uint)> action, Counter* counter = nullptr, Counter* dependency = nullptr, uint chunk = 0);
+	// add low priority job, counter is increased until job is done
+	void SubmitLowPriority(delegate<void()> action, Counter* counter = nullptr);
+	// add low priority job for each index in [0, count), executed in order
+	void SubmitLowPriorityFor(uint count, delegate<void(uint)> action, Counter* counter = nullptr);
+	// execute jobs until counter reaches zero
+	void Wait(Counter& counter);
+	// call action for each index in [0, count), blocks until all are done, calling thread also does work
+	void ParallelFor(uint count, delegate<void(uint)> action);
+	// counter valid until end of frame
+	Counter* GetFrameCounter();
+	// wait for all frame counters & release them
+	void EndFrame();
+	void ResetStats();
+
+	uint GetThreadsCount() const { return threads.size() + 1; }
+	Stats GetStats() const { return { jobs_count, stolen_count }; }
+	// index of current thread, 0 for main thread, 1..threads for workers
+	static uint GetThreadIndex() { return thread_index; }
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	void ThreadLoop(uint index);
+	void Push(const Job& job);
+	void PushLowPriority(const Job& job);
+	void Notify(bool all);
+	bool TryExecute();
+	bool TryExecuteLowPriority();
+	void Execute(Job& job);
+	void AddJob(const Job& job, Counter* dependency);
+	uint GetChunkSize(uint count) const { return max(1u, count / (GetThreadsCount() * 4)); }
+	uint GetQueueIndex() const { return thread_index < queues_count ? thread_index : 0; }
+
+	vector<std::thread> threads;
+	unique_ptr<Queue[]> queues;
+	Queue low_queue;
+	uint queues_count, max_low_running;
+	std::mutex mutex;
+	std::condition_variable cv_work;
+	std::atomic<uint> queued, low_queued, low_running;
+	std::atomic<uint64> jobs_count, stolen_count;
+	vector<Counter*> frame_counters;
+	uint used_frame_counters;
+	bool quit;
+	static thread_local uint thread_index;
+};
@@ -0,0 +1,244 @@
+#include "EngineCore.h"
+#include "Archive.h"
+#include "Compression.h"
+#include "NameTable.h"
+
+struct Archive::Header
+{
+	static const uint VERSION = 1;
+
+	char sign[4];
+	uint version, entries, index_size, names_size, entries_offset, index_offset, names_offset;
+};
+
+static const char ARCHIVE_SIGN[4] = { 'R', 'S', 'P', 'K' };
+
+static uint AlignToPage(uint offset)
+{
+	return (offset + Archive::PAGE_SIZE - 1) & ~(Archive::PAGE_SIZE - 1);
+}
+
+Archive::Archive() : header(nullptr), entries(nullptr), index(nullptr), names(nullptr)
+{
+}
+
+Archive::~Archive()
+{
+	Close();
+}
+
+bool Archive::Open(cstring path)
+{
+	assert(path);
+	Close();
+	if(!file.Open(path, FileReader::MAPPED))
+		return false;
+
+	const uint size = file.GetSize();
+	const byte* data = file.GetMappedData();
+	if(!data)
+	{
+		// mapping failed, read whole file
+		content.resize(size);
+		if(size)
+			file.Read((char*)content.data(), size);
+		if(!file)
+		{
+			Close();
+			throw Format("Failed to read archive '%s'.", path);
+		}
+		data = (const byte*)content.data();
+	}
+
+	const Header& head = *(const Header*)data;
+	uint entries_end, index_end, names_end;
+	if(size < sizeof(Header)
+		|| memcmp(head.sign, ARCHIVE_SIGN, sizeof(ARCHIVE_SIGN)) != 0
+		|| head.version != Header::VERSION
+		|| head.index_size <= head.entries
+		|| (head.index_size & (head.index_size - 1)) != 0
+		|| head.names_size == 0
+		|| !checked::mad(head.entries, sizeof(Entry), head.entries_offset, entries_end) || entries_end > size
+		|| !checked::mad(head.index_size, sizeof(uint), head.index_offset, index_end) || index_end > size
+		|| !checked::add(head.names_offset, head.names_size, names_end) || names_end > size
+		|| head.entries_offset % 4 != 0 || head.index_offset % 4 != 0)
+	{
+		Close();
+		throw Format("Invalid archive '%s'.", path);
+	}
+
+	entries = (const Entry*)(data + head.entries_offset);
+	index = (const uint*)(data + head.index_offset);
+	names = (cstring)(data + head.names_offset);
+	bool ok = (names[head.names_size - 1] == 0);
+	for(uint i = 0; i < head.entries && ok; ++i)
+	{
+		const Entry& entry = entries[i];
+		uint entry_end;
+		ok = entry.name_offset < head.names_size && checked::add(entry.offset, entry.packed_size, entry_end) && entry_end <= size
+			&& (!entry.IsCompressed() || (entry.packed_size < entry.size && entry.size <= compression::GetMaxDecompressedSize(entry.packed_size)));
+	}
+	// search in Find ends on empty slot
+	uint empty_slots = 0;
+	for(uint i = 0; i < head.index_size && ok; ++i)
+	{
+		ok = index[i] <= head.entries;
+		if(index[i] == 0)
+			++empty_slots;
+	}
+	if(!ok || empty_slots == 0)
+	{
+		Close();
+		throw Format("Corrupted archive '%s'.", path);
+	}
+
+	header = &head;
+	return true;
+}
+
+void Archive::Close()
+{
+	file.Close();
+	content.clear();
+	content.shrink_to_fit();
+	header = nullptr;
+	entries = nullptr;
+	index = nullptr;
+	names = nullptr;
+}
+
+// index always have empty slot (checked in Open) so search ends, probe is also limited to index size
+const Archive::Entry* Archive::Find(cstring name) const
+{
+	assert(name);
+	if(!header)
+		return nullptr;
+
+	const uint hash = NameTable::Hash(name);
+	const uint mask = header->index_size - 1;
+	for(uint i = hash & mask, probe = 0; probe < header->index_size; i = (i + 1) & mask, ++probe)
+	{
+		const uint slot = index[i];
+		if(slot == 0)
+			return nullptr;
+		const Entry& entry = entries[slot - 1];
+		if(entry.hash == hash && _stricmp(names + entry.name_offset, name) == 0)
+			return &entry;
+	}
+	return nullptr;
+}
+
+const byte* Archive::GetData(const Entry& entry, string& buf) const
+{
+	assert(header);
+	const byte* data = (const byte*)header + entry.offset;
+	if(!entry.IsCompressed())
+		return data;
+
+	buf.resize(entry.size);
+	if(!compression::Decompress(data, entry.packed_size, (byte*)buf.data(), entry.size))
+		return nullptr;
+	return (const byte*)buf.data();
+}
+
+uint Archive::GetEntriesCount() const
+{
+	return header ? header->entries : 0;
+}
+
+// entries are compressed only when it saves space, all data is kept in memory until header is written
+void Archive::Create(cstring path, cstring dir, const vector<string>& files, bool compress, Stats* stats)
+{
+	assert(path && dir);
+
+	Header head;
+	memcpy(head.sign, ARCHIVE_SIGN, sizeof(ARCHIVE_SIGN));
+	head.version = Header::VERSION;
+	head.entries = files.size();
+	head.index_size = 16;
+	while(head.index_size < head.entries * 2)
+		head.index_size *= 2;
+
+	vector<Entry> entries_table(files.size());
+	vector<uint> index_table(head.index_size, 0u);
+	string names_blob;
+	vector<string> datas(files.size());
+	string content;
+	Stats s = {};
+
+	for(uint i = 0; i < files.size(); ++i)
+	{
+		const string& name = files[i];
+		Entry& entry = entries_table[i];
+		entry.hash = NameTable::Hash(name.c_str());
+		entry.name_offset = names_blob.size();
+		names_blob += name;
+		names_blob += '\0';
+
+		const uint mask = head.index_size - 1;
+		uint slot = entry.hash & mask;
+		while(index_table[slot] != 0)
+		{
+			if(_stricmp(files[index_table[slot] - 1].c_str(), name.c_str()) == 0)
+				throw Format("Duplicate archive entry '%s'.", name.c_str());
+			slot = (slot + 1) & mask;
+		}
+		index_table[slot] = i + 1;
+
+		if(!io::LoadFileToString(Format("%s/%s", dir, name.c_str()), content))
+			throw Format("Failed to read file '%s/%s'.", dir, name.c_str());
+		entry.size = content.size();
+		entry.packed_size = entry.size;
+		string& data = datas[i];
+		if(compress && !content.empty())
+		{
+			data.resize(compression::GetMaxCompressedSize(entry.size));
+			uint packed_size = compression::Compress((const byte*)content.data(), entry.size, (byte*)data.data(), data.size());
+			if(packed_size != 0 && packed_size < entry.size)
+			{
+				data.resize(packed_size);
+				entry.packed_size = packed_size;
+				++s.compressed;
+			}
+		}
+		if(!entry.IsCompressed())
+			data.swap(content);
+		s.size += entry.size;
+		s.packed_size += entry.packed_size;
+	}
+	s.files = files.size();
+	if(names_blob.empty())
+		names_blob += '\0';
+
+	head.names_size = names_blob.size();
+	head.entries_offset = sizeof(Header);
+	head.index_offset = head.entries_offset + sizeof(Entry) * head.entries;
+	head.names_offset = head.index_offset + sizeof(uint) * head.index_size;
+	uint offset = AlignToPage(head.names_offset + head.names_size);
+	for(uint i = 0; i < files.size(); ++i)
+	{
+		Entry& entry = entries_table[i];
+		entry.offset = offset;
+		offset = AlignToPage(offset + entry.packed_size);
+	}
+
+	FileWriter f(path);
+	if(!f)
+		throw Format("Failed to create archive '%s'.", path);
+	static const byte padding[PAGE_SIZE] = {};
+	f << head;
+	f.Write(entries_table.data(), sizeof(Entry) * entries_table.size());
+	f.Write(index_table.data(), sizeof(uint) * index_table.size());
+	f.Write(names_blob.data(), names_blob.size());
+	uint pos = head.names_offset + head.names_size;
+	for(uint i = 0; i < files.size(); ++i)
+	{
+		f.Write(padding, entries_table[i].offset - pos);
+		f.Write(datas[i].data(), datas[i].size());
+		pos = entries_table[i].offset + entries_table[i].packed_size;
+	}
+	f.Close();
+
+	if(stats)
+		*stats = s;
+}
@@ -0,0 +1,157 @@
+#include "EngineCore.h"
+#include "Compression.h"
+
+namespace compression
+{
+	static const uint MIN_MATCH = 4;
+	static const uint MAX_OFFSET = 0xFFFF;
+	static const uint HASH_BITS = 14;
+	// last bytes are always stored as literals, match can't end closer than this to end of block
+	static const uint END_LITERALS = 5;
+	static const uint MATCH_LIMIT = 12;
+
+	static uint HashSequence(uint value)
+	{
+		return (value * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	static void WriteLength(byte*& op, uint length)
+	{
+		while(length >= 255)
+		{
+			*op++ = 255;
+			length -= 255;
+		}
+		*op++ = (byte)length;
+	}
+
+	static bool ReadLength(const byte*& ip, const byte* ip_end, uint& length)
+	{
+		byte b;
+		do
+		{
+			if(ip == ip_end)
+				return false;
+			b = *ip++;
+			length += b;
+		}
+		while(b == 255);
+		return true;
+	}
+
+	// token (literals length, match length), literals, offset, match length is 0 for last sequence
+	static bool WriteSequence(byte*& op, byte* op_end, const byte* literals, uint literals_length, uint offset, uint match_length)
+	{
+		const uint required = 1 + literals_length / 255 + 1 + literals_length + 2 + match_length / 255 + 1;
+		if(uint(op_end - op) < required)
+			return false;
+
+		byte* token = op++;
+		*token = byte(min(literals_length, 15u) << 4);
+		if(literals_length >= 15)
+			WriteLength(op, literals_length - 15);
+		memcpy(op, literals, literals_length);
+		op += literals_length;
+		if(match_length == 0)
+			return true;
+
+		*op++ = byte(offset);
+		*op++ = byte(offset >> 8);
+		match_length -= MIN_MATCH;
+		*token |= byte(min(match_length, 15u));
+		if(match_length >= 15)
+			WriteLength(op, match_length - 15);
+		return true;
+	}
+
+	uint Compress(const byte* src, uint size, byte* dst, uint dst_size)
+	{
+		assert(src && dst);
+		vector<uint> table(1u << HASH_BITS, 0u); // position + 1 of last sequence with this hash
+		const byte* ip = src;
+		const byte* anchor = src;
+		const byte* end = src + size;
+		const byte* match_limit = (size > MATCH_LIMIT ? end - MATCH_LIMIT : src);
+		byte* op = dst;
+		byte* op_end = dst + dst_size;
+
+		while(ip < match_limit)
+		{
+			uint sequence;
+			memcpy(&sequence, ip, sizeof(sequence));
+			uint& entry = table[HashSequence(sequence)];
+			const byte* ref = (entry ? src + entry - 1 : nullptr);
+			entry = uint(ip - src) + 1;
+			if(!ref || uint(ip - ref) > MAX_OFFSET || memcmp(ref, ip, MIN_MATCH) != 0)
+			{
+				++ip;
+				continue;
+			}
+
+			const byte* match_end = ip + MIN_MATCH;
+			ref += MIN_MATCH;
+			while(match_end < end - END_LITERALS && *match_end == *ref)
+			{
+				++match_end;
+				++ref;
+			}
+			if(!WriteSequence(op, op_end, anchor, uint(ip - anchor), uint(match_end - ref), uint(match_end - ip)))
+				return 0;
+			ip = anchor = match_end;
+		}
+
+		if(!WriteSequence(op, op_end, anchor, uint(end - anchor), 0, 0))
+			return 0;
+		return uint(op - dst);
+	}
+
+	bool Decompress(const byte* src, uint size, byte* dst, uint dst_size)
+	{
+		assert(src && dst);
+		const byte* ip = src;
+		const byte* ip_end = src + size;
+		byte* op = dst;
+		byte* op_end = dst + dst_size;
+
+		while(ip < ip_end)
+		{
+			const byte token = *ip++;
+			uint literals_length = token >> 4;
+			if(literals_length == 15 && !ReadLength(ip, ip_end, literals_length))
+				return false;
+			if(literals_length > uint(ip_end - ip) || literals_length > uint(op_end - op))
+				return false;
+			memcpy(op, ip, literals_length);
+			op += literals_length;
+			ip += literals_length;
+			if(ip == ip_end)
+				break; // last sequence have only literals
+
+			if(ip_end - ip < 2)
+				return false;
+			const uint offset = ip[0] | (ip[1] << 8);
+			ip += 2;
+			if(offset == 0 || offset > uint(op - dst))
+				return false;
+			uint match_length = token & 15;
+			if(match_length == 15 && !ReadLength(ip, ip_end, match_length))
+				return false;
+			match_length += MIN_MATCH;
+			if(match_length > uint(op_end - op))
+				return false;
+
+			const byte* ref = op - offset;
+			if(offset >= match_length)
+				memcpy(op, ref, match_length);
+			else
+			{
+				// overlapping match repeats last bytes
+				for(uint i = 0; i < match_length; ++i)
+					op[i] = ref[i];
+			}
+			op += match_length;
+		}
+
+		return op == op_end;
+	}
+}
@@ -2,7 +2,7 @@
 #include "Config.h"
 #include "Tokenizer.h"
 
-ObjectPool<string> StringPool;
+ConcurrentObjectPool<string> StringPool;
 
 cstring var_type_name[] = {
 	"bool",
@@ -1,4 +1,8 @@
 #include "Core.h"
+#include <atomic>
+#include <mutex>
+#include <malloc.h>
+#include <new>
 #ifdef _DEBUG // for ObjectPoolLeakManager
 #pragma warning(push)
 #pragma warning(disable:4091)
@@ -9,6 +13,7 @@
 
 #ifdef _DEBUG
 
+static std::mutex leak_mutex; // ConcurrentObjectPool use manager from many threads
 ObjectPoolLeakManager ObjectPoolLeakManager::instance;
 
 struct ObjectPoolLeakManager::CallStackEntry
@@ -58,6 +63,7 @@ ObjectPoolLeakManager::~ObjectPoolLeakManager()
 void ObjectPoolLeakManager::Register(void* ptr)
 {
 	assert(ptr);
+	std::lock_guard<std::mutex> lock(leak_mutex);
 	assert(call_stacks.find(ptr) == call_stacks.end());
 
 	CallStackEntry* cs;
@@ -79,6 +85,7 @@ void ObjectPoolLeakManager::Register(void* ptr)
 void ObjectPoolLeakManager::Unregister(void* ptr)
 {
 	assert(ptr);
+	std::lock_guard<std::mutex> lock(leak_mutex);
 
 	auto it = call_stacks.find(ptr);
 	assert(it != call_stacks.end());
@@ -87,3 +94,94 @@ void ObjectPoolLeakManager::Unregister(void* ptr)
 }
 
 #endif
+
+namespace internal
+{
+	static std::atomic<bool> thread_slots[MAX_THREAD_SLOTS];
+
+	struct ThreadSlot
+	{
+		ThreadSlot() : index(INVALID_THREAD_SLOT)
+		{
+			for(uint i = 0; i < MAX_THREAD_SLOTS; ++i)
+			{
+				if(!thread_slots[i].exchange(true))
+				{
+					index = i;
+					break;
+				}
+			}
+		}
+
+		~ThreadSlot()
+		{
+			if(index != INVALID_THREAD_SLOT)
+				thread_slots[index] = false;
+		}
+
+		uint index;
+	};
+
+	uint GetThreadSlot()
+	{
+		static thread_local ThreadSlot slot;
+		return slot.index;
+	}
+}
+
+#ifdef HEAP_STATS
+
+static std::atomic<uint64> heap_allocs, heap_frees;
+static std::atomic<int64> heap_size, heap_peak_size;
+
+void* operator new(size_t size)
+{
+	void* ptr = malloc(size ? size : 1);
+	if(!ptr)
+		throw std::bad_alloc();
+
+	int64 block_size = (int64)_msize(ptr);
+	int64 new_size = (heap_size += block_size);
+	int64 peak_size = heap_peak_size.load(std::memory_order_relaxed);
+	while(new_size > peak_size && !heap_peak_size.compare_exchange_weak(peak_size, new_size, std::memory_order_relaxed));
+	heap_allocs.fetch_add(1, std::memory_order_relaxed);
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	if(!ptr)
+		return;
+	heap_size -= (int64)_msize(ptr);
+	heap_frees.fetch_add(1, std::memory_order_relaxed);
+	free(ptr);
+}
+
+HeapStats HeapStats::Get()
+{
+	HeapStats stats;
+	stats.allocs = heap_allocs.load(std::memory_order_relaxed);
+	stats.frees = heap_frees.load(std::memory_order_relaxed);
+	stats.size = heap_size.load();
+	stats.peak_size = heap_peak_size.load();
+	return stats;
+}
+
+void HeapStats::ResetPeak()
+{
+	heap_peak_size = heap_size.load();
+}
+
+#else
+
+HeapStats HeapStats::Get()
+{
+	HeapStats stats = {};
+	return stats;
+}
+
+void HeapStats::ResetPeak()
+{
+}
+
+#endif
@@ -172,7 +172,7 @@ void DebugShader::Draw(const Mesh* mesh, const Matrix& mat_world, Color color)
 		uint stride = sizeof(Vec3),
 			offset = 0;
 		device_context->IASetVertexBuffers(0, 1, &mesh->vb, &stride, &offset);
-		device_context->IASetIndexBuffer(mesh->ib, DXGI_FORMAT_R16_UINT, 0);
+		device_context->IASetIndexBuffer(mesh->ib, mesh->IsIndex32() ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT, 0);
 		device_context->IASetInputLayout(layout);
 		device_context->VSSetShader(vertex_shader, nullptr, 0);
 		device_context->PSSetShader(pixel_shader, nullptr, 0);
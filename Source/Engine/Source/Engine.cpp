@@ -8,9 +8,12 @@
 #include "ResourceManager.h"
 #include "Scene.h"
 #include "Gui.h"
+#include "ThreadPool.h"
+#include "FramePipeline.h"
+#include "FrameArena.h"
 
 Engine::Engine() : handler(nullptr), input(new Input), window(new Window), render(new Render), sound_mgr(new SoundManager), res_mgr(new ResourceManager),
-scene(new Scene), gui(new Gui), fps(0)
+scene(new Scene), gui(new Gui), thread_pool(new ThreadPool), pipeline(new FramePipeline), fps(0), frame_allocs(0), headless(false)
 {
 	render->Prepare();
 }
@@ -35,18 +38,38 @@ void Engine::Init(GameHandler* handler)
 	render->Init(window->GetSize(), window->GetHandle());
 	window->StartFullscreen();
 	sound_mgr->Init();
-	res_mgr->Init(render.get(), sound_mgr.get());
+	thread_pool->Init();
+	res_mgr->Init(render.get(), sound_mgr.get(), thread_pool.get());
+	res_mgr->Mount("Data.pak");
 	scene->Init(render.get(), res_mgr.get());
 	gui->SetWindowSize(window->GetSize());
 	gui->Init(render.get(), res_mgr.get(), input.get());
+	pipeline->Init();
+}
+
+// init only systems required for simulation, without window, rendering and sound
+void Engine::InitHeadless()
+{
+	Info("Engine: Initializing in headless mode.");
+
+	if(!XMVerifyCPUSupport())
+		throw "Unsupported CPU.";
+
+	headless = true;
+	thread_pool->Init();
+	res_mgr->Init(nullptr, nullptr, thread_pool.get());
+	res_mgr->Mount("Data.pak");
+	pipeline->Init();
 }
 
 void Engine::Run()
 {
+	assert(!headless);
 	Info("Engine: Started game loop.");
 	timer.Start();
 	frames = 0;
 	frame_time = 0.f;
+	uint64 last_allocs = HeapStats::Get().allocs;
 
 	while(true)
 	{
@@ -67,18 +90,32 @@ void Engine::Run()
 
 		if(dt > 0.3f)
 			dt = 0.3f;
+		res_mgr->Update();
 		if(!handler->OnTick(dt))
 			return;
 
 		gui->Update(dt);
 		sound_mgr->Update(dt);
 
+		// snapshot of scene is drawn while next frame is simulated
+		scene->Prepare();
 		render->BeginScene();
-		scene->Draw();
+		scene->DrawSkybox();
+		pipeline->Start([this, dt] { handler->OnUpdate(dt); });
+		scene->DrawNodes();
+		pipeline->Wait();
+		scene->DrawParticles();
+		scene->DrawDebug();
 		gui->Draw(scene->GetViewProjectionMatrix());
 		render->EndScene();
-
+		thread_pool->EndFrame();
 		input->Update();
+
+		// transient data is freed at end of frame, count heap allocations so they can be replaced by arena
+		uint64 allocs = HeapStats::Get().allocs;
+		frame_allocs = uint(allocs - last_allocs);
+		last_allocs = allocs;
+		FrameArena::NextFrame();
 	}
 }
 
@@ -86,7 +123,8 @@ void Engine::ShowError(cstring err)
 {
 	Logger::Get()->Log(Logger::L_ERROR, err);
 	Logger::Get()->Flush();
-	window->ShowError(err);
+	if(!headless)
+		window->ShowError(err);
 }
 
 void Engine::OnChangeResolution(const Int2& wnd_size)
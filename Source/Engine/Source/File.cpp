@@ -1,99 +1,430 @@
 #include "Core.h"
-#include <Windows.h>
+#include <atomic>
+#ifdef _WIN32
+#	include <Windows.h>
+#	undef DeleteFile
+#else
+#	include <dirent.h>
+#	include <fcntl.h>
+#	include <strings.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#	define _stricmp strcasecmp
+#endif
 
-#undef DeleteFile
-
-static DWORD tmp;
 string FileReader::buf;
+static std::atomic<uint64> syscalls;
 
 
 //-----------------------------------------------------------------------------
-FileReader::~FileReader()
+// Platform backend
+//-----------------------------------------------------------------------------
+#ifdef _WIN32
+
+static FileHandle OpenHandle(cstring filename, bool write)
+{
+	++syscalls;
+	if(write)
+		return CreateFile(filename, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	else
+		return CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+}
+
+static void CloseFileHandle(FileHandle file)
+{
+	++syscalls;
+	CloseHandle(file);
+}
+
+static uint ReadFromHandle(FileHandle file, void* ptr, uint size)
+{
+	++syscalls;
+	DWORD read;
+	if(!ReadFile(file, ptr, size, &read, nullptr))
+		return 0;
+	return read;
+}
+
+static uint WriteToHandle(FileHandle file, const void* ptr, uint size)
+{
+	++syscalls;
+	DWORD written;
+	if(!WriteFile(file, ptr, size, &written, nullptr))
+		return 0;
+	return written;
+}
+
+static void FlushHandle(FileHandle file)
 {
-	if(own_handle && file != INVALID_HANDLE_VALUE)
+	++syscalls;
+	FlushFileBuffers(file);
+}
+
+static uint GetHandleSize(FileHandle file)
+{
+	++syscalls;
+	return GetFileSize(file, nullptr);
+}
+
+static uint GetHandlePos(FileHandle file)
+{
+	++syscalls;
+	return (uint)SetFilePointer(file, 0, nullptr, FILE_CURRENT);
+}
+
+static bool SetHandlePos(FileHandle file, uint pos)
+{
+	++syscalls;
+	return SetFilePointer(file, pos, nullptr, FILE_BEGIN) != INVALID_SET_FILE_POINTER;
+}
+
+static const byte* MapHandle(FileHandle file, uint size, void*& mapping)
+{
+	syscalls += 2;
+	mapping = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(!mapping)
+		return nullptr;
+	const byte* data = (const byte*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+	if(!data)
 	{
-		CloseHandle(file);
-		file = INVALID_HANDLE_VALUE;
-		ok = false;
+		CloseHandle(mapping);
+		mapping = nullptr;
 	}
+	return data;
 }
 
-bool FileReader::Open(cstring filename)
+static void UnmapHandle(const byte* data, uint size, void* mapping)
 {
-	assert(filename);
-	file = CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-	own_handle = true;
-	if(file != INVALID_HANDLE_VALUE)
+	syscalls += 2;
+	UnmapViewOfFile(data);
+	CloseHandle(mapping);
+}
+
+#else
+
+static FileHandle ToHandle(int fd)
+{
+	return (FileHandle)(IntPointer)fd;
+}
+
+static int ToFd(FileHandle file)
+{
+	return (int)(IntPointer)file;
+}
+
+static FileHandle OpenHandle(cstring filename, bool write)
+{
+	++syscalls;
+	if(write)
+		return ToHandle(open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644));
+	else
+		return ToHandle(open(filename, O_RDONLY));
+}
+
+static void CloseFileHandle(FileHandle file)
+{
+	++syscalls;
+	close(ToFd(file));
+}
+
+static uint ReadFromHandle(FileHandle file, void* ptr, uint size)
+{
+	uint total = 0;
+	while(total < size)
+	{
+		++syscalls;
+		ssize_t result = read(ToFd(file), (byte*)ptr + total, size - total);
+		if(result <= 0)
+			break;
+		total += (uint)result;
+	}
+	return total;
+}
+
+static uint WriteToHandle(FileHandle file, const void* ptr, uint size)
+{
+	uint total = 0;
+	while(total < size)
+	{
+		++syscalls;
+		ssize_t result = write(ToFd(file), (const byte*)ptr + total, size - total);
+		if(result <= 0)
+			break;
+		total += (uint)result;
+	}
+	return total;
+}
+
+static void FlushHandle(FileHandle file)
+{
+	++syscalls;
+	fsync(ToFd(file));
+}
+
+static uint GetHandleSize(FileHandle file)
+{
+	++syscalls;
+	struct stat st;
+	if(fstat(ToFd(file), &st) != 0)
+		return 0;
+	return (uint)st.st_size;
+}
+
+static uint GetHandlePos(FileHandle file)
+{
+	++syscalls;
+	return (uint)lseek(ToFd(file), 0, SEEK_CUR);
+}
+
+static bool SetHandlePos(FileHandle file, uint pos)
+{
+	++syscalls;
+	return lseek(ToFd(file), (off_t)pos, SEEK_SET) != (off_t)-1;
+}
+
+static const byte* MapHandle(FileHandle file, uint size, void*& mapping)
+{
+	++syscalls;
+	void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, ToFd(file), 0);
+	if(data == MAP_FAILED)
+		return nullptr;
+	mapping = data;
+	return (const byte*)data;
+}
+
+static void UnmapHandle(const byte* data, uint size, void* mapping)
+{
+	++syscalls;
+	munmap((void*)data, size);
+}
+
+#endif
+
+
+//-----------------------------------------------------------------------------
+FileReader::FileReader(FileHandle file) : file(file), size(0), mode(UNBUFFERED), own_handle(false), ok(false)
+{
+	ResetWindow();
+	if(file != INVALID_FILE_HANDLE)
 	{
-		size = GetFileSize(file, nullptr);
+		size = GetHandleSize(file);
 		ok = true;
 	}
-	else
+}
+
+FileReader::~FileReader()
+{
+	Close();
+}
+
+bool FileReader::Open(cstring filename, Mode mode)
+{
+	assert(filename);
+	Close();
+	file = OpenHandle(filename, false);
+	own_handle = true;
+	this->mode = mode;
+	if(file == INVALID_FILE_HANDLE)
 	{
 		size = 0;
 		ok = false;
+		return false;
 	}
-	return ok;
+
+	size = GetHandleSize(file);
+	ok = true;
+	if(mode == MAPPED)
+	{
+		const byte* data = (size != 0 ? MapHandle(file, size, mapping) : nullptr);
+		if(data)
+		{
+			base = cur = data;
+			end = data + size;
+		}
+		else
+			this->mode = BUFFERED;
+	}
+	if(this->mode == BUFFERED)
+		buffer.resize(BUFFER_SIZE);
+	return true;
 }
 
-void FileReader::Read(void* ptr, uint size)
+void FileReader::OpenMemory(const void* data, uint size)
 {
-	BOOL result = ReadFile(file, ptr, size, &tmp, nullptr);
-	assert(result != FALSE);
-	ok = (size == tmp);
+	assert(data || size == 0);
+	Close();
+	this->size = size;
+	mode = MAPPED;
+	base = cur = (const byte*)data;
+	end = base + size;
+	ok = true;
+}
+
+void FileReader::Close()
+{
+	if(file != INVALID_FILE_HANDLE)
+	{
+		if(mapping)
+			UnmapHandle(base, size, mapping);
+		if(own_handle)
+			CloseFileHandle(file);
+		file = INVALID_FILE_HANDLE;
+	}
+	ResetWindow();
+	ok = false;
+}
+
+// called when data is not in window, read rest of window & refill it (or read directly for big reads)
+void FileReader::ReadFromFile(void* ptr, uint size)
+{
+	if(mode == UNBUFFERED)
+	{
+		if(ok && ReadFromHandle(file, ptr, size) != size)
+			ok = false;
+		return;
+	}
+
+	uint available = uint(end - cur);
+	if(mode == MAPPED || !ok)
+	{
+		cur = end;
+		ok = false;
+		return;
+	}
+
+	if(available)
+	{
+		memcpy(ptr, cur, available);
+		ptr = (byte*)ptr + available;
+		size -= available;
+	}
+	offset += uint(end - base);
+
+	if(size >= BUFFER_SIZE)
+	{
+		base = cur = end = buffer.data();
+		uint read = ReadFromHandle(file, ptr, size);
+		offset += read;
+		if(read != size)
+			ok = false;
+		return;
+	}
+
+	uint read = ReadFromHandle(file, buffer.data(), BUFFER_SIZE);
+	base = cur = buffer.data();
+	end = base + read;
+	if(read < size)
+	{
+		cur = end;
+		ok = false;
+		return;
+	}
+	memcpy(ptr, cur, size);
+	cur += size;
 }
 
 void FileReader::ReadToString(string& s)
 {
-	DWORD size = GetFileSize(file, nullptr);
-	s.resize(size);
-	BOOL result = ReadFile(file, (char*)s.c_str(), size, &tmp, nullptr);
-	assert(result != FALSE);
-	assert(size == tmp);
+	uint pos = GetPos();
+	s.resize(size - pos);
+	if(!s.empty())
+		Read((char*)s.c_str(), s.size());
 }
 
 void FileReader::Skip(uint bytes)
 {
-	ok = (ok && SetFilePointer(file, bytes, nullptr, FILE_CURRENT) != INVALID_SET_FILE_POINTER);
+	if(!ok)
+		return;
+	uint pos = GetPos(), new_pos;
+	if(!checked::add(pos, bytes, new_pos) || new_pos > size)
+	{
+		ok = false;
+		return;
+	}
+
+	if(bytes <= uint(end - cur))
+		cur += bytes;
+	else if(mode == MAPPED)
+		ok = false;
+	else
+	{
+		if(mode == BUFFERED)
+		{
+			base = cur = end = buffer.data();
+			offset = new_pos;
+		}
+		ok = SetHandlePos(file, new_pos);
+	}
 }
 
 uint FileReader::GetPos() const
 {
-	return (uint)SetFilePointer(file, 0, nullptr, FILE_CURRENT);
+	if(mode == UNBUFFERED)
+		return GetHandlePos(file);
+	return offset + uint(cur - base);
 }
 
 
 //-----------------------------------------------------------------------------
 FileWriter::~FileWriter()
 {
-	if(own_handle && file != INVALID_HANDLE_VALUE)
-	{
-		CloseHandle(file);
-		file = INVALID_HANDLE_VALUE;
-	}
+	Close();
 }
 
-bool FileWriter::Open(cstring filename)
+bool FileWriter::Open(cstring filename, Mode mode)
 {
 	assert(filename);
-	file = CreateFile(filename, GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
-	return (file != INVALID_HANDLE_VALUE);
+	Close();
+	file = OpenHandle(filename, true);
+	own_handle = true;
+	this->mode = mode;
+	if(mode == BUFFERED)
+		buffer.reserve(BUFFER_SIZE);
+	return (file != INVALID_FILE_HANDLE);
+}
+
+void FileWriter::Close()
+{
+	if(file == INVALID_FILE_HANDLE)
+		return;
+	WriteBuffer();
+	if(own_handle)
+		CloseFileHandle(file);
+	file = INVALID_FILE_HANDLE;
 }
 
-void FileWriter::Write(const void* ptr, uint size)
+// called when data don't fit in buffer
+void FileWriter::WriteToFile(const void* ptr, uint size)
 {
-	WriteFile(file, ptr, size, &tmp, nullptr);
-	assert(size == tmp);
+	WriteBuffer();
+	if(mode == BUFFERED && size < BUFFER_SIZE)
+		buffer.insert(buffer.end(), (const byte*)ptr, (const byte*)ptr + size);
+	else
+	{
+		uint written = WriteToHandle(file, ptr, size);
+		assert(written == size);
+	}
+}
+
+void FileWriter::WriteBuffer()
+{
+	if(buffer.empty())
+		return;
+	uint written = WriteToHandle(file, buffer.data(), buffer.size());
+	assert(written == buffer.size());
+	buffer.clear();
 }
 
 void FileWriter::Flush()
 {
-	FlushFileBuffers(file);
+	WriteBuffer();
+	FlushHandle(file);
 }
 
 uint FileWriter::GetSize() const
 {
-	return GetFileSize(file, nullptr);
+	return GetHandleSize(file) + buffer.size();
 }
 
 
@@ -102,31 +433,100 @@ namespace io
 {
 	bool FileExists(Cstring path)
 	{
+		++syscalls;
+#ifdef _WIN32
 		DWORD attrib = GetFileAttributes(path);
 		if(attrib == INVALID_FILE_ATTRIBUTES)
 			return false;
 		return !IS_SET(attrib, FILE_ATTRIBUTE_DIRECTORY);
+#else
+		struct stat st;
+		if(stat(path, &st) != 0)
+			return false;
+		return !S_ISDIR(st.st_mode);
+#endif
 	}
 
 	void DeleteFile(Cstring path)
 	{
+		++syscalls;
+#ifdef _WIN32
 		DeleteFileA(path);
+#else
+		unlink(path);
+#endif
 	}
 
 	bool LoadFileToString(Cstring path, string& str, uint max_size)
 	{
-		HANDLE file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-		if(file == INVALID_HANDLE_VALUE)
+		FileHandle file = OpenHandle(path, false);
+		if(file == INVALID_FILE_HANDLE)
 			return false;
 
-		uint file_size = (uint)GetFileSize(file, nullptr);
+		uint file_size = GetHandleSize(file);
 		uint size = min(file_size, max_size);
 		str.resize(size);
 
-		ReadFile(file, (char*)str.c_str(), size, &tmp, nullptr);
+		uint read = (size != 0 ? ReadFromHandle(file, (char*)str.c_str(), size) : 0);
 
-		CloseHandle(file);
+		CloseFileHandle(file);
 
-		return size == tmp;
+		return size == read;
+	}
+
+	// add files with extension from dir & subdirectories, paths are relative to dir
+	static void FindFilesInDir(const string& dir, const string& prefix, cstring ext, vector<string>& files)
+	{
+		const uint ext_len = strlen(ext);
+		auto add = [&](cstring name, bool is_dir)
+		{
+			if(strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+				return;
+			if(is_dir)
+			{
+				FindFilesInDir(dir + "/" + name, prefix + name + "/", ext, files);
+				return;
+			}
+			uint len = strlen(name);
+			if(ext_len == 0 || (len > ext_len && name[len - ext_len - 1] == '.' && _stricmp(name + len - ext_len, ext) == 0))
+				files.push_back(prefix + name);
+		};
+
+		++syscalls;
+#ifdef _WIN32
+		WIN32_FIND_DATA data;
+		HANDLE find = FindFirstFile(Format("%s/*", dir.c_str()), &data);
+		if(find == INVALID_HANDLE_VALUE)
+			return;
+		do
+		{
+			++syscalls;
+			add(data.cFileName, IS_SET(data.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY));
+		}
+		while(FindNextFile(find, &data));
+		FindClose(find);
+#else
+		DIR* d = opendir(dir.c_str());
+		if(!d)
+			return;
+		while(dirent* entry = readdir(d))
+		{
+			++syscalls;
+			struct stat st;
+			bool is_dir = stat((dir + "/" + entry->d_name).c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+			add(entry->d_name, is_dir);
+		}
+		closedir(d);
+#endif
+	}
+
+	void FindFiles(Cstring dir, Cstring ext, vector<string>& files)
+	{
+		FindFilesInDir(dir.s, string(), ext, files);
+	}
+
+	uint64 GetSyscallsCount()
+	{
+		return syscalls.load();
 	}
 }
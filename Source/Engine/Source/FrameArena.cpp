@@ -0,0 +1,92 @@
+#include "EngineCore.h"
+#include "FrameArena.h"
+#include <atomic>
+
+static std::atomic<uint> current_frame, frame_peak_size;
+
+FrameArena::FrameArena(uint block_size) : block_size(block_size), pos(0), frame(0), stats()
+{
+	assert(block_size > 0);
+}
+
+FrameArena::~FrameArena()
+{
+	for(Block& block : blocks)
+		delete[] block.data;
+}
+
+void* FrameArena::Alloc(uint size, uint align)
+{
+	assert(align != 0 && (align & (align - 1)) == 0);
+	if(!blocks.empty())
+	{
+		Block& block = blocks.back();
+		uintptr_t start = ((uintptr_t)(block.data + pos) + align - 1) & ~(uintptr_t)(align - 1);
+		uint end = uint(start - (uintptr_t)block.data) + size;
+		if(end <= block.size)
+		{
+			pos = end;
+			stats.size += size;
+			return (void*)start;
+		}
+	}
+
+	AddBlock(max(block_size, size + align));
+	Block& block = blocks.back();
+	uintptr_t start = ((uintptr_t)block.data + align - 1) & ~(uintptr_t)(align - 1);
+	pos = uint(start - (uintptr_t)block.data) + size;
+	stats.size += size;
+	return (void*)start;
+}
+
+void FrameArena::AddBlock(uint size)
+{
+	Block block;
+	block.data = new byte[size];
+	block.size = size;
+	blocks.push_back(block);
+	stats.capacity += size;
+	++stats.blocks_allocated;
+}
+
+// free all allocations, if more than one block was used replace them with single block
+void FrameArena::Reset()
+{
+	stats.peak_size = max(stats.peak_size, stats.size);
+	stats.size = 0;
+	pos = 0;
+	if(blocks.size() > 1)
+	{
+		uint total = stats.capacity;
+		for(Block& block : blocks)
+			delete[] block.data;
+		blocks.clear();
+		stats.capacity = 0;
+		block_size = max(block_size, total);
+		AddBlock(total);
+	}
+}
+
+FrameArena& FrameArena::Get()
+{
+	static thread_local FrameArena arena;
+	uint frame = current_frame.load(std::memory_order_relaxed);
+	if(arena.frame != frame)
+	{
+		uint peak = frame_peak_size.load(std::memory_order_relaxed);
+		while(arena.stats.size > peak && !frame_peak_size.compare_exchange_weak(peak, arena.stats.size, std::memory_order_relaxed));
+		arena.Reset();
+		arena.frame = frame;
+	}
+	return arena;
+}
+
+void FrameArena::NextFrame()
+{
+	current_frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint FrameArena::GetFramePeakSize()
+{
+	return frame_peak_size.load(std::memory_order_relaxed);
+}
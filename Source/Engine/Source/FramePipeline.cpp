@@ -0,0 +1,109 @@
+#include "EngineCore.h"
+#include "FramePipeline.h"
+
+
+FramePipeline::FramePipeline() : running(false), has_task(false), failed(false), quit(false)
+{
+}
+
+FramePipeline::~FramePipeline()
+{
+	Shutdown();
+}
+
+void FramePipeline::Init()
+{
+	assert(!thread.joinable());
+	quit = false;
+	thread = std::thread(&FramePipeline::ThreadLoop, this);
+	Info("FramePipeline: Started update thread.");
+}
+
+void FramePipeline::Shutdown()
+{
+	if(!thread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	cv_work.notify_one();
+	thread.join();
+}
+
+void FramePipeline::Start(delegate<void()> task)
+{
+	assert(!running);
+	running = true;
+	failed = false;
+
+	if(!thread.joinable())
+	{
+		try
+		{
+			task();
+		}
+		catch(cstring err)
+		{
+			error = err;
+			failed = true;
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->task = task;
+		has_task = true;
+	}
+	cv_work.notify_one();
+}
+
+void FramePipeline::Wait()
+{
+	if(!running)
+		return;
+
+	if(thread.joinable())
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cv_done.wait(lock, [this] { return !has_task; });
+	}
+	running = false;
+
+	if(failed)
+		throw error.c_str();
+}
+
+void FramePipeline::ThreadLoop()
+{
+	while(true)
+	{
+		delegate<void()> current_task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			cv_work.wait(lock, [this] { return quit || has_task; });
+			if(quit)
+				return;
+			current_task = task;
+		}
+
+		try
+		{
+			current_task();
+		}
+		catch(cstring err)
+		{
+			error = err;
+			failed = true;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			has_task = false;
+			task = nullptr;
+		}
+		cv_done.notify_one();
+	}
+}
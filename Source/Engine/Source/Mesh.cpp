@@ -7,7 +7,7 @@
 const Mesh::KeyframeBone Mesh::KeyframeBone::Zero = { Vec3::Zero, Quat::Identity, 1.f };
 
 
-Mesh::Mesh(cstring name) : Resource(name, Resource::Type::Mesh), vb(nullptr), ib(nullptr)
+Mesh::Mesh(cstring name) : Resource(name, Resource::Type::Mesh), vb(nullptr), ib(nullptr), bone_blocks(0)
 {
 }
 
@@ -32,39 +32,185 @@ void Mesh::SetupBoneMatrices()
 	}
 }
 
-Mesh::Animation* Mesh::GetAnimation(cstring name)
+// convert bones matrices & keyframes to SoA layout, unused lanes are filled with identity
+void Mesh::SetupAnimationBlocks()
 {
-	assert(name);
+	auto set = [](XMFLOAT4& v, uint lane, float value) { (&v.x)[lane] = value; };
+
+	const uint real_bones = head.n_bones - 1;
+	bone_blocks = (real_bones + 3) / 4;
+	bone_mat_blocks.resize(bone_blocks);
+	for(uint i = 0; i < bone_blocks * 4; ++i)
+	{
+		const Matrix& mat = (i < real_bones ? bones[i + 1].mat : Matrix::IdentityMatrix);
+		MatrixBlock& block = bone_mat_blocks[i / 4];
+		for(int row = 0; row < 4; ++row)
+		{
+			for(int col = 0; col < 4; ++col)
+				set(block.m[row][col], i % 4, mat.m[row][col]);
+		}
+	}
+
+	for(Animation& anim : anims)
+	{
+		anim.SetupFrameStep();
+		anim.blocks.resize(anim.n_frames * bone_blocks);
+		for(word frame = 0; frame < anim.n_frames; ++frame)
+		{
+			for(uint i = 0; i < bone_blocks * 4; ++i)
+			{
+				const KeyframeBone& k = (i < real_bones ? anim.GetFrameBones(frame)[i] : KeyframeBone::Zero);
+				KeyframeBlock& block = anim.blocks[frame * bone_blocks + i / 4];
+				const uint lane = i % 4;
+				set(block.pos_x, lane, k.pos.x);
+				set(block.pos_y, lane, k.pos.y);
+				set(block.pos_z, lane, k.pos.z);
+				set(block.rot_x, lane, k.rot.x);
+				set(block.rot_y, lane, k.rot.y);
+				set(block.rot_z, lane, k.rot.z);
+				set(block.rot_w, lane, k.rot.w);
+				set(block.scale, lane, k.scale);
+			}
+		}
+	}
+}
+
+// calculate bone to parent matrices of all bones (same as KeyframeBone::Interpolate & Mix) for 4 bones at once
+// out must have space for 1 + bone_blocks * 4 matrices, out[0] is not changed
+void Mesh::GetAnimationMatrices(Animation& anim, float time, Matrix* out, word* cursor) const
+{
+	static const XMVECTORF32 one_minus_epsilon = { 1.0f - 0.00001f, 1.0f - 0.00001f, 1.0f - 0.00001f, 1.0f - 0.00001f };
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR one = XMVectorSplatOne();
+
+	bool hit;
+	const int index = anim.GetFrameIndex(time, hit, cursor);
+	const KeyframeBlock* keyf = &anim.blocks[index * bone_blocks];
+	const KeyframeBlock* keyf2 = hit ? nullptr : &anim.blocks[(index + 1) * bone_blocks];
+	const XMVECTOR t = XMVectorReplicate(hit ? 0.f : (time - anim.frames[index].time) / (anim.frames[index + 1].time - anim.frames[index].time));
+	const XMVECTOR inv_t = XMVectorSubtract(one, t);
+
+	for(uint i = 0; i < bone_blocks; ++i)
+	{
+		const KeyframeBlock& k = keyf[i];
+		XMVECTOR px = XMLoadFloat4(&k.pos_x),
+			py = XMLoadFloat4(&k.pos_y),
+			pz = XMLoadFloat4(&k.pos_z),
+			qx = XMLoadFloat4(&k.rot_x),
+			qy = XMLoadFloat4(&k.rot_y),
+			qz = XMLoadFloat4(&k.rot_z),
+			qw = XMLoadFloat4(&k.rot_w),
+			s = XMLoadFloat4(&k.scale);
+
+		if(!hit)
+		{
+			// interpolate between two frames
+			const KeyframeBlock& k2 = keyf2[i];
+			const XMVECTOR qx2 = XMLoadFloat4(&k2.rot_x),
+				qy2 = XMLoadFloat4(&k2.rot_y),
+				qz2 = XMLoadFloat4(&k2.rot_z),
+				qw2 = XMLoadFloat4(&k2.rot_w);
+			px = XMVectorLerpV(px, XMLoadFloat4(&k2.pos_x), t);
+			py = XMVectorLerpV(py, XMLoadFloat4(&k2.pos_y), t);
+			pz = XMVectorLerpV(pz, XMLoadFloat4(&k2.pos_z), t);
+			s = XMVectorLerpV(s, XMLoadFloat4(&k2.scale), t);
+
+			// slerp, same as XMQuaternionSlerp
+			XMVECTOR cos_omega = XMVectorMultiply(qx, qx2);
+			cos_omega = XMVectorMultiplyAdd(qy, qy2, cos_omega);
+			cos_omega = XMVectorMultiplyAdd(qz, qz2, cos_omega);
+			cos_omega = XMVectorMultiplyAdd(qw, qw2, cos_omega);
+			const XMVECTOR sign = XMVectorSelect(one, XMVectorNegate(one), XMVectorLess(cos_omega, zero));
+			cos_omega = XMVectorMultiply(cos_omega, sign);
+			const XMVECTOR control = XMVectorLess(cos_omega, one_minus_epsilon);
+			const XMVECTOR sin_omega = XMVectorSqrt(XMVectorNegativeMultiplySubtract(cos_omega, cos_omega, one));
+			const XMVECTOR omega = XMVectorATan2(sin_omega, cos_omega);
+			const XMVECTOR s0 = XMVectorSelect(inv_t, XMVectorDivide(XMVectorSin(XMVectorMultiply(inv_t, omega)), sin_omega), control);
+			const XMVECTOR s1 = XMVectorMultiply(XMVectorSelect(t, XMVectorDivide(XMVectorSin(XMVectorMultiply(t, omega)), sin_omega), control),
+				sign);
+			qx = XMVectorMultiplyAdd(qx2, s1, XMVectorMultiply(qx, s0));
+			qy = XMVectorMultiplyAdd(qy2, s1, XMVectorMultiply(qy, s0));
+			qz = XMVectorMultiplyAdd(qz2, s1, XMVectorMultiply(qz, s0));
+			qw = XMVectorMultiplyAdd(qw2, s1, XMVectorMultiply(qw, s0));
+		}
+
+		// scale * rotation
+		const XMVECTOR two_s = XMVectorAdd(s, s);
+		const XMVECTOR xx = XMVectorMultiply(qx, qx), yy = XMVectorMultiply(qy, qy), zz = XMVectorMultiply(qz, qz),
+			xy = XMVectorMultiply(qx, qy), xz = XMVectorMultiply(qx, qz), yz = XMVectorMultiply(qy, qz),
+			xw = XMVectorMultiply(qx, qw), yw = XMVectorMultiply(qy, qw), zw = XMVectorMultiply(qz, qw);
+		XMVECTOR r[3][3];
+		r[0][0] = XMVectorNegativeMultiplySubtract(two_s, XMVectorAdd(yy, zz), s);
+		r[0][1] = XMVectorMultiply(two_s, XMVectorAdd(xy, zw));
+		r[0][2] = XMVectorMultiply(two_s, XMVectorSubtract(xz, yw));
+		r[1][0] = XMVectorMultiply(two_s, XMVectorSubtract(xy, zw));
+		r[1][1] = XMVectorNegativeMultiplySubtract(two_s, XMVectorAdd(xx, zz), s);
+		r[1][2] = XMVectorMultiply(two_s, XMVectorAdd(yz, xw));
+		r[2][0] = XMVectorMultiply(two_s, XMVectorAdd(xz, yw));
+		r[2][1] = XMVectorMultiply(two_s, XMVectorSubtract(yz, xw));
+		r[2][2] = XMVectorNegativeMultiplySubtract(two_s, XMVectorAdd(xx, yy), s);
+
+		// * translation * bone matrix
+		const MatrixBlock& m = bone_mat_blocks[i];
+		XMVECTOR result[4][4];
+		for(int col = 0; col < 4; ++col)
+		{
+			const XMVECTOR m0 = XMLoadFloat4(&m.m[0][col]),
+				m1 = XMLoadFloat4(&m.m[1][col]),
+				m2 = XMLoadFloat4(&m.m[2][col]),
+				m3 = XMLoadFloat4(&m.m[3][col]);
+			for(int row = 0; row < 3; ++row)
+				result[row][col] = XMVectorMultiplyAdd(r[row][2], m2, XMVectorMultiplyAdd(r[row][1], m1, XMVectorMultiply(r[row][0], m0)));
+			result[3][col] = XMVectorMultiplyAdd(pz, m2, XMVectorMultiplyAdd(py, m1, XMVectorMultiplyAdd(px, m0, m3)));
+		}
+
+		// back to AoS
+		Matrix* mats = out + 1 + i * 4;
+		for(int row = 0; row < 4; ++row)
+		{
+			XMMATRIX rows = XMMatrixTranspose(XMMATRIX(result[row][0], result[row][1], result[row][2], result[row][3]));
+			for(int lane = 0; lane < 4; ++lane)
+				XMStoreFloat4((XMFLOAT4*)mats[lane].m[row], rows.r[lane]);
+		}
+	}
+}
+
+Mesh::Animation* Mesh::GetAnimation(NameId id)
+{
+	if(id == 0)
+		return nullptr;
 
 	for(vector<Animation>::iterator it = anims.begin(), end = anims.end(); it != end; ++it)
 	{
-		if(it->name == name)
+		if(it->name_id == id)
 			return &*it;
 	}
 
 	return nullptr;
 }
 
-Mesh::Bone* Mesh::GetBone(cstring name)
+Mesh::Bone* Mesh::GetBone(NameId id)
 {
-	assert(name);
+	if(id == 0)
+		return nullptr;
 
 	for(vector<Bone>::iterator it = bones.begin(), end = bones.end(); it != end; ++it)
 	{
-		if(it->name == name)
+		if(it->name_id == id)
 			return &*it;
 	}
 
 	return nullptr;
 }
 
-Mesh::Point* Mesh::GetPoint(cstring name)
+Mesh::Point* Mesh::GetPoint(NameId id)
 {
-	assert(name);
+	if(id == 0)
+		return nullptr;
 
 	for(vector<Point>::iterator it = attach_points.begin(), end = attach_points.end(); it != end; ++it)
 	{
-		if(it->name == name)
+		if(it->name_id == id)
 			return &*it;
 	}
 
@@ -98,29 +244,77 @@ bool Mesh::HavePoint(Point* point)
 }
 
 
-int Mesh::Animation::GetFrameIndex(float time, bool& hit)
+// check if keyframes are evenly spaced, then frame index can be calculated from time
+void Mesh::Animation::SetupFrameStep()
+{
+	frame_step = 0.f;
+	if(n_frames < 2)
+		return;
+	const float step = (frames[n_frames - 1].time - frames[0].time) / (n_frames - 1);
+	if(step <= 0.f)
+		return;
+	for(word i = 1; i < n_frames; ++i)
+	{
+		if(abs(frames[i].time - frames[i - 1].time - step) > step * 0.001f)
+			return;
+	}
+	frame_step = step;
+}
+
+// find frame for time, cursor (optional) keeps last frame index between calls so playing forward/backward don't need to search
+int Mesh::Animation::GetFrameIndex(float time, bool& hit, word* cursor)
 {
 	assert(time >= 0 && time <= length);
+	assert((time > frames[0].time || Equal(time, frames[0].time)) && "Time before first frame!");
+
+	const int last = n_frames - 1;
+	int index;
+	if(cursor && *cursor < last && time >= frames[*cursor].time && time < frames[*cursor + 1].time)
+		index = *cursor; // same frame as before
+	else if(cursor && *cursor + 1 < last && time >= frames[*cursor + 1].time && time < frames[*cursor + 2].time)
+		index = *cursor + 1; // next frame
+	else if(cursor && *cursor > 0 && *cursor <= last && time >= frames[*cursor - 1].time && time < frames[*cursor].time)
+		index = *cursor - 1; // previous frame (playing backward)
+	else if(frame_step > 0.f)
+	{
+		// evenly spaced frames, fix rounding errors
+		index = Clamp(int((time - frames[0].time) / frame_step), 0, last);
+		if(index < last && time >= frames[index + 1].time)
+			++index;
+		else if(index > 0 && time < frames[index].time)
+			--index;
+	}
+	else
+	{
+		// binary search for last frame with time <= time
+		auto it = std::upper_bound(frames.begin(), frames.end(), time, [](float t, const Keyframe& frame) { return t < frame.time; });
+		index = max(int(it - frames.begin()) - 1, 0);
+	}
 
-	for(word i = 0; i < n_frames; ++i)
+	if(cursor)
+		*cursor = (word)index;
+
+	if(Equal(time, frames[index].time))
 	{
-		if(Equal(time, frames[i].time))
-		{
-			// hit frame
-			hit = true;
-			return i;
-		}
-		else if(time < frames[i].time)
-		{
-			// need to interpolate between two frames
-			assert(i != 0 && "Time before first frame!");
-			hit = false;
-			return i - 1;
-		}
+		// hit frame
+		hit = true;
+		return index;
+	}
+	else if(index < last && Equal(time, frames[index + 1].time))
+	{
+		hit = true;
+		return index + 1;
+	}
+	else if(index == last)
+	{
+		// after last frame, shouldn't happen when length matches last frame
+		hit = true;
+		return last;
 	}
 
-	// unreachable, should hit assert
-	return 0;
+	// need to interpolate between two frames
+	hit = false;
+	return index;
 }
 
 void Mesh::Animation::GetKeyframeData(uint bone, float time, KeyframeBone& keyframe)
@@ -131,13 +325,13 @@ void Mesh::Animation::GetKeyframeData(uint bone, float time, KeyframeBone& keyfr
 	if(hit)
 	{
 		// exact hit in frame
-		keyframe = frames[index].bones[bone - 1];
+		keyframe = GetFrameBones(index)[bone - 1];
 	}
 	else
 	{
 		// interpolate beetween two key frames
-		const auto& keyf = frames[index].bones[bone - 1];
-		const auto& keyf2 = frames[index + 1].bones[bone - 1];
+		const auto& keyf = GetFrameBones(index)[bone - 1];
+		const auto& keyf2 = GetFrameBones(index + 1)[bone - 1];
 		const float t = (time - frames[index].time) / (frames[index + 1].time - frames[index].time);
 
 		KeyframeBone::Interpolate(keyframe, keyf, keyf2, t);
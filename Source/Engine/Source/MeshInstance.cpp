@@ -1,5 +1,6 @@
 #include "EngineCore.h"
 #include "MeshInstance.h"
+#include <atomic>
 
 
 const int BLEND_TO_BIND_POSE = -1;
@@ -27,8 +28,12 @@ float MeshInstance::Group::GetBlendT() const
 
 
 //=================================================================================================
-MeshInstance::MeshInstance(Mesh* mesh) : mesh(mesh), need_update(true)
+MeshInstance::MeshInstance(Mesh* mesh) : mesh(mesh), need_update(true), have_bones(false)
 {
+	// spread updates of instances with lower lod between frames, instances can be created on worker threads
+	static std::atomic<uint> counter(0);
+	lod_offset = counter++;
+
 	mat_bones.resize(mesh->head.n_bones);
 	blendb.resize(mesh->head.n_bones);
 	groups.resize(mesh->head.n_groups);
@@ -76,6 +81,7 @@ void MeshInstance::Play(Mesh::Animation* anim, int flags, uint group)
 	if(IS_SET(flags, PLAY_CLEAR_FRAME_END_INFO))
 		gr.frame_end_info = false;
 	gr.anim = anim;
+	gr.frame = 0;
 	gr.prio = ((flags & 0x60) >> 5);
 	gr.state = new_state;
 	if(IS_SET(flags, PLAY_BACK))
@@ -212,10 +218,36 @@ void MeshInstance::SetupBones()
 	if(!need_update)
 		return;
 	need_update = false;
+	UpdateBones(false);
+}
+
+//====================================================================================================
+// update bones only if it's time for it at this lod level, returns true if bones were changed
+bool MeshInstance::SetupBones(ANIM_LOD lod, uint frame)
+{
+	if(!need_update)
+		return false;
+	if(have_bones && lod != ANIM_LOD_FULL)
+	{
+		const uint mask = (lod == ANIM_LOD_HALF ? 1 : 3);
+		if(((frame + lod_offset) & mask) != 0)
+			return false;
+	}
+	need_update = false;
+	UpdateBones(lod == ANIM_LOD_QUARTER);
+	return true;
+}
+
+//====================================================================================================
+void MeshInstance::UpdateBones(bool snap)
+{
+	have_bones = true;
 
 	Matrix BoneToParentPoseMat[32];
 	BoneToParentPoseMat[0] = Matrix::IdentityMatrix;
 	Mesh::KeyframeBone tmp_keyf;
+	Matrix anim_mats[33]; // all bones calculated by vectorized path, 4 per block
+	int anim_mats_group = -1;
 
 	// calculate transformations for each group
 	const word n_groups = mesh->head.n_groups;
@@ -255,10 +287,17 @@ void MeshInstance::SetupBones()
 		}
 		else
 		{
-			const Group& gr_anim = groups[anim_group];
+			Group& gr_anim = groups[anim_group];
 			bool hit;
-			const int index = gr_anim.GetFrameIndex(hit);
+			int index = gr_anim.GetFrameIndex(hit);
 			const vector<Mesh::Keyframe>& frames = gr_anim.anim->frames;
+			if(snap && !hit)
+			{
+				// use closest keyframe
+				if(gr_anim.time - frames[index].time > frames[index + 1].time - gr_anim.time)
+					++index;
+				hit = true;
+			}
 
 			if(gr_anim.IsBlending() || gr_bones.IsBlending())
 			{
@@ -269,7 +308,7 @@ void MeshInstance::SetupBones()
 				if(hit)
 				{
 					// exact hit in frame
-					const vector<Mesh::KeyframeBone>& keyf = frames[index].bones;
+					const Mesh::KeyframeBone* keyf = gr_anim.anim->GetFrameBones(index);
 					for(BoneIter it = bones.begin(), end = bones.end(); it != end; ++it)
 					{
 						const word b = *it;
@@ -281,8 +320,8 @@ void MeshInstance::SetupBones()
 				{
 					// interpolate between two frames
 					const float t = (gr_anim.time - frames[index].time) / (frames[index + 1].time - frames[index].time);
-					const vector<Mesh::KeyframeBone>& keyf = frames[index].bones;
-					const vector<Mesh::KeyframeBone>& keyf2 = frames[index + 1].bones;
+					const Mesh::KeyframeBone* keyf = gr_anim.anim->GetFrameBones(index);
+					const Mesh::KeyframeBone* keyf2 = gr_anim.anim->GetFrameBones(index + 1);
 
 					for(BoneIter it = bones.begin(), end = bones.end(); it != end; ++it)
 					{
@@ -295,30 +334,16 @@ void MeshInstance::SetupBones()
 			}
 			else
 			{
-				// there is no blending
-				if(hit)
+				// there is no blending, calculate all bones at once (can be reused by other groups with same animation)
+				if(anim_mats_group != anim_group)
 				{
-					// exact hit in frame
-					const vector<Mesh::KeyframeBone>& keyf = frames[index].bones;
-					for(BoneIter it = bones.begin(), end = bones.end(); it != end; ++it)
-					{
-						const word b = *it;
-						keyf[b - 1].Mix(BoneToParentPoseMat[b], mesh->bones[b].mat);
-					}
+					mesh->GetAnimationMatrices(*gr_anim.anim, hit ? frames[index].time : gr_anim.time, anim_mats, &gr_anim.frame);
+					anim_mats_group = anim_group;
 				}
-				else
+				for(BoneIter it = bones.begin(), end = bones.end(); it != end; ++it)
 				{
-					// interpolate between two frames
-					const float t = (gr_anim.time - frames[index].time) / (frames[index + 1].time - frames[index].time);
-					const vector<Mesh::KeyframeBone>& keyf = frames[index].bones;
-					const vector<Mesh::KeyframeBone>& keyf2 = frames[index + 1].bones;
-
-					for(BoneIter it = bones.begin(), end = bones.end(); it != end; ++it)
-					{
-						const word b = *it;
-						Mesh::KeyframeBone::Interpolate(tmp_keyf, keyf[b - 1], keyf2[b - 1], t);
-						tmp_keyf.Mix(BoneToParentPoseMat[b], mesh->bones[b].mat);
-					}
+					const word b = *it;
+					BoneToParentPoseMat[b] = anim_mats[b];
 				}
 			}
 		}
@@ -376,7 +401,7 @@ void MeshInstance::SetupBlending(uint bones_group, bool first, bool in_update)
 	else
 	{
 		// there is animation
-		const Group& gr_anim = groups[anim_group];
+		Group& gr_anim = groups[anim_group];
 		bool hit;
 		const int index = gr_anim.GetFrameIndex(hit);
 		const vector<Mesh::Keyframe>& frames = gr_anim.anim->frames;
@@ -390,7 +415,7 @@ void MeshInstance::SetupBlending(uint bones_group, bool first, bool in_update)
 			if(hit)
 			{
 				// exact hit in frame
-				const vector<Mesh::KeyframeBone>& keyf = frames[index].bones;
+				const Mesh::KeyframeBone* keyf = gr_anim.anim->GetFrameBones(index);
 				for(BoneIter it = bones.begin(), end = bones.end(); it != end; ++it)
 				{
 					const word b = *it;
@@ -401,8 +426,8 @@ void MeshInstance::SetupBlending(uint bones_group, bool first, bool in_update)
 			{
 				// interpolate between two frames and blend frame
 				const float t = (gr_anim.time - frames[index].time) / (frames[index + 1].time - frames[index].time);
-				const vector<Mesh::KeyframeBone>& keyf = frames[index].bones;
-				const vector<Mesh::KeyframeBone>& keyf2 = frames[index + 1].bones;
+				const Mesh::KeyframeBone* keyf = gr_anim.anim->GetFrameBones(index);
+				const Mesh::KeyframeBone* keyf2 = gr_anim.anim->GetFrameBones(index + 1);
 				Mesh::KeyframeBone tmp_keyf;
 
 				for(BoneIter it = bones.begin(), end = bones.end(); it != end; ++it)
@@ -419,7 +444,7 @@ void MeshInstance::SetupBlending(uint bones_group, bool first, bool in_update)
 			if(hit)
 			{
 				// exact hit in frame
-				const vector<Mesh::KeyframeBone>& keyf = frames[index].bones;
+				const Mesh::KeyframeBone* keyf = gr_anim.anim->GetFrameBones(index);
 				for(BoneIter it = bones.begin(), end = bones.end(); it != end; ++it)
 				{
 					const word b = *it;
@@ -430,8 +455,8 @@ void MeshInstance::SetupBlending(uint bones_group, bool first, bool in_update)
 			{
 				// interpolate between two frames
 				const float t = (gr_anim.time - frames[index].time) / (frames[index + 1].time - frames[index].time);
-				const vector<Mesh::KeyframeBone>& keyf = frames[index].bones;
-				const vector<Mesh::KeyframeBone>& keyf2 = frames[index + 1].bones;
+				const Mesh::KeyframeBone* keyf = gr_anim.anim->GetFrameBones(index);
+				const Mesh::KeyframeBone* keyf2 = gr_anim.anim->GetFrameBones(index + 1);
 
 				for(BoneIter it = bones.begin(), end = bones.end(); it != end; ++it)
 				{
@@ -564,6 +589,7 @@ void MeshInstance::Reset()
 	for(Group& group : groups)
 		group.Reset();
 	need_update = true;
+	have_bones = false;
 }
 
 //=================================================================================================
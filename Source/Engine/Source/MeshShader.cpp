@@ -14,6 +14,11 @@ struct VertexShaderGlobals
 	Matrix mat_world;
 };
 
+struct InstancedVertexShaderGlobals
+{
+	Matrix mat_view_proj;
+};
+
 struct AnimatedVertexShaderGlobals
 {
 	Matrix mat_combined;
@@ -36,24 +41,28 @@ struct PixelShaderPerObject
 };
 
 
-MeshShader::MeshShader(Render* render) : render(render), device_context(nullptr), vertex_shader(nullptr), vertex_shader_animated(nullptr),
-pixel_shader(nullptr), layout_mesh(nullptr), layout_animated(nullptr), layout_animated_no_inst(nullptr), vs_buffer(nullptr), vs_buffer_animated(nullptr),
-ps_buffer(nullptr), ps_buffer_object(nullptr), sampler(nullptr)
+MeshShader::MeshShader(Render* render) : render(render), device_context(nullptr), vertex_shader(nullptr), vertex_shader_instanced(nullptr),
+vertex_shader_animated(nullptr), pixel_shader(nullptr), layout_mesh(nullptr), layout_animated(nullptr), layout_animated_no_inst(nullptr), vs_buffer(nullptr),
+vs_buffer_instanced(nullptr), vs_buffer_animated(nullptr), ps_buffer(nullptr), ps_buffer_object(nullptr), instance_buffer(nullptr), sampler(nullptr),
+instance_pos(INSTANCE_BUFFER_SIZE)
 {
 }
 
 MeshShader::~MeshShader()
 {
 	SafeRelease(vertex_shader);
+	SafeRelease(vertex_shader_instanced);
 	SafeRelease(vertex_shader_animated);
 	SafeRelease(pixel_shader);
 	SafeRelease(layout_mesh);
 	SafeRelease(layout_animated);
 	SafeRelease(layout_animated_no_inst);
 	SafeRelease(vs_buffer);
+	SafeRelease(vs_buffer_instanced);
 	SafeRelease(vs_buffer_animated);
 	SafeRelease(ps_buffer);
 	SafeRelease(ps_buffer_object);
+	SafeRelease(instance_buffer);
 	SafeRelease(sampler);
 }
 
@@ -78,6 +87,7 @@ void MeshShader::InitInternal()
 
 	// compile shader to blobs
 	ID3DBlob* blob_vs_mesh = render->CompileShader("mesh.hlsl", "vs_mesh", true);
+	ID3DBlob* blob_vs_instanced = render->CompileShader("mesh.hlsl", "vs_mesh_instanced", true);
 	ID3DBlob* blob_vs_animated = render->CompileShader("mesh.hlsl", "vs_animated", true);
 	ID3DBlob* blob_ps = render->CompileShader("mesh.hlsl", "ps_main", false);
 
@@ -86,6 +96,10 @@ void MeshShader::InitInternal()
 	if(FAILED(result))
 		throw Format("Failed to create vertex shader (%u).", result);
 
+	result = device->CreateVertexShader(blob_vs_instanced->GetBufferPointer(), blob_vs_instanced->GetBufferSize(), nullptr, &vertex_shader_instanced);
+	if(FAILED(result))
+		throw Format("Failed to create instanced vertex shader (%u).", result);
+
 	result = device->CreateVertexShader(blob_vs_animated->GetBufferPointer(), blob_vs_animated->GetBufferSize(), nullptr, &vertex_shader_animated);
 	if(FAILED(result))
 		throw Format("Failed to create animated vertex shader (%u).", result);
@@ -98,7 +112,11 @@ void MeshShader::InitInternal()
 	D3D11_INPUT_ELEMENT_DESC desc_mesh[] = {
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "INSTANCE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "INSTANCE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "INSTANCE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "INSTANCE", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
 	};
 
 	D3D11_INPUT_ELEMENT_DESC desc_animated[] = {
@@ -109,7 +127,8 @@ void MeshShader::InitInternal()
 		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0 }
 	};
 
-	result = device->CreateInputLayout(desc_mesh, countof(desc_mesh), blob_vs_mesh->GetBufferPointer(), blob_vs_mesh->GetBufferSize(), &layout_mesh);
+	result = device->CreateInputLayout(desc_mesh, countof(desc_mesh), blob_vs_instanced->GetBufferPointer(), blob_vs_instanced->GetBufferSize(),
+		&layout_mesh);
 	if(FAILED(result))
 		throw Format("Failed to create mesh layout (%u).", result);
 
@@ -124,15 +143,30 @@ void MeshShader::InitInternal()
 		throw Format("Failed to create animated mesh without instance layout (%u).", result);
 
 	blob_vs_mesh->Release();
+	blob_vs_instanced->Release();
 	blob_vs_animated->Release();
 	blob_ps->Release();
 
 	// create constant buffers
 	vs_buffer = render->CreateConstantBuffer(sizeof(VertexShaderGlobals));
+	vs_buffer_instanced = render->CreateConstantBuffer(sizeof(InstancedVertexShaderGlobals));
 	vs_buffer_animated = render->CreateConstantBuffer(sizeof(AnimatedVertexShaderGlobals));
 	ps_buffer = render->CreateConstantBuffer(sizeof(PixelShaderGlobals));
 	ps_buffer_object = render->CreateConstantBuffer(sizeof(PixelShaderPerObject));
 
+	// create instance buffer
+	D3D11_BUFFER_DESC desc;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.ByteWidth = INSTANCE_BUFFER_SIZE * sizeof(Matrix);
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	desc.MiscFlags = 0;
+	desc.StructureByteStride = 0;
+
+	result = device->CreateBuffer(&desc, nullptr, &instance_buffer);
+	if(FAILED(result))
+		throw Format("Failed to create instance buffer (%u).", result);
+
 	// create texture sampler
 	D3D11_SAMPLER_DESC sampler_desc;
 	sampler_desc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
@@ -154,13 +188,18 @@ void MeshShader::InitInternal()
 		throw Format("Failed to create sampler state (%u).", result);
 }
 
-void MeshShader::Prepare(const Vec3& fog_color, const Vec3& fog_params, const Vec3& light_dir, const Vec3& light_color, const Vec3& ambient_color)
+void MeshShader::Prepare(const Vec3& fog_color, const Vec3& fog_params, const Vec3& light_dir, const Vec3& light_color, const Vec3& ambient_color,
+	const Matrix& mat_view_proj)
 {
+	this->mat_view_proj = mat_view_proj;
 	device_context->PSSetShader(pixel_shader, nullptr, 0);
 	ID3D11Buffer* buffers[] = { ps_buffer, ps_buffer_object };
 	device_context->PSSetConstantBuffers(0, 2, buffers);
 	device_context->PSSetSamplers(0, 1, &sampler);
-	current_mode = MODE_NONE;
+	current_mode = RenderQueue::MODE_NONE;
+	current_mesh = nullptr;
+	current_tex = nullptr;
+	current_tint = Vec4(-1, -1, -1, -1);
 
 	D3D11_MAPPED_SUBRESOURCE resource;
 	C(device_context->Map(ps_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &resource));
@@ -171,88 +210,133 @@ void MeshShader::Prepare(const Vec3& fog_color, const Vec3& fog_params, const Ve
 	psg.light_color = Vec4(light_color, 0);
 	psg.ambient_color = Vec4(ambient_color, 0);
 	device_context->Unmap(ps_buffer, 0);
+
+	C(device_context->Map(vs_buffer_instanced, 0, D3D11_MAP_WRITE_DISCARD, 0, &resource));
+	InstancedVertexShaderGlobals& g = *(InstancedVertexShaderGlobals*)resource.pData;
+	g.mat_view_proj = mat_view_proj.Transpose();
+	device_context->Unmap(vs_buffer_instanced, 0);
 }
 
-void MeshShader::DrawMesh(Mesh* mesh, MeshInstance* mesh_inst, const Matrix& mat_combined, const Matrix& mat_world, const Vec4& tint, int subs)
+// draw sorted batches, shader/buffers/textures/tint are changed only when different from previous batch
+void MeshShader::Draw(const RenderQueue& queue)
 {
-	assert(mesh);
-
-	// change mode
-	Mode new_mode;
-	if(mesh_inst)
-		new_mode = MODE_ANIMATED;
-	else if(mesh->IsAnimated())
-		new_mode = MODE_ANIMATED_NO_INST;
-	else
-		new_mode = MODE_MESH;
-	if(new_mode != current_mode)
+	const vector<Matrix>& matrices = queue.GetMatrices();
+	const vector<Matrix>& bones = queue.GetBones();
+	D3D11_MAPPED_SUBRESOURCE resource;
+
+	for(const RenderQueue::Batch& batch : queue.GetBatches())
 	{
-		current_mode = new_mode;
-		switch(new_mode)
+		SetMode(batch.mode);
+
+		// set world matrices
+		uint first_instance = 0;
+		if(batch.mode == RenderQueue::MODE_MESH)
 		{
-		case MODE_MESH:
-			device_context->IASetInputLayout(layout_mesh);
-			device_context->VSSetShader(vertex_shader, nullptr, 0);
-			device_context->VSSetConstantBuffers(0, 1, &vs_buffer);
-			break;
-		case MODE_ANIMATED:
-			device_context->IASetInputLayout(layout_animated);
-			device_context->VSSetShader(vertex_shader_animated, nullptr, 0);
-			device_context->VSSetConstantBuffers(0, 1, &vs_buffer_animated);
-			break;
-		case MODE_ANIMATED_NO_INST:
-			device_context->IASetInputLayout(layout_animated_no_inst);
-			device_context->VSSetShader(vertex_shader, nullptr, 0);
-			device_context->VSSetConstantBuffers(0, 1, &vs_buffer);
-			break;
+			// instance buffer is discarded only when full
+			D3D11_MAP map_type = D3D11_MAP_WRITE_NO_OVERWRITE;
+			if(instance_pos + batch.count > INSTANCE_BUFFER_SIZE)
+			{
+				map_type = D3D11_MAP_WRITE_DISCARD;
+				instance_pos = 0;
+			}
+			C(device_context->Map(instance_buffer, 0, map_type, 0, &resource));
+			memcpy((Matrix*)resource.pData + instance_pos, &matrices[batch.first], sizeof(Matrix) * batch.count);
+			device_context->Unmap(instance_buffer, 0);
+			first_instance = instance_pos;
+			instance_pos += batch.count;
+		}
+		else
+		{
+			const Matrix& mat_world = matrices[batch.first];
+			if(batch.mode == RenderQueue::MODE_ANIMATED_NO_INST)
+			{
+				C(device_context->Map(vs_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &resource));
+				VertexShaderGlobals& g = *(VertexShaderGlobals*)resource.pData;
+				g.mat_combined = (mat_world * mat_view_proj).Transpose();
+				g.mat_world = mat_world.Transpose();
+				device_context->Unmap(vs_buffer, 0);
+			}
+			else
+			{
+				C(device_context->Map(vs_buffer_animated, 0, D3D11_MAP_WRITE_DISCARD, 0, &resource));
+				AnimatedVertexShaderGlobals& g = *(AnimatedVertexShaderGlobals*)resource.pData;
+				g.mat_combined = (mat_world * mat_view_proj).Transpose();
+				g.mat_world = mat_world.Transpose();
+				for(uint i = 0; i < batch.bones; ++i)
+					g.mat_bones[i] = bones[batch.first_bone + i].Transpose();
+				device_context->Unmap(vs_buffer_animated, 0);
+			}
 		}
-	}
 
-	// set vertex shader constants
-	D3D11_MAPPED_SUBRESOURCE resource;
-	if(current_mode != MODE_ANIMATED)
-	{
-		C(device_context->Map(vs_buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &resource));
-		VertexShaderGlobals& g = *(VertexShaderGlobals*)resource.pData;
-		g.mat_combined = mat_combined.Transpose();
-		g.mat_world = mat_world.Transpose();
-		device_context->Unmap(vs_buffer, 0);
-	}
-	else
-	{
-		C(device_context->Map(vs_buffer_animated, 0, D3D11_MAP_WRITE_DISCARD, 0, &resource));
-		AnimatedVertexShaderGlobals& g = *(AnimatedVertexShaderGlobals*)resource.pData;
-		g.mat_combined = mat_combined.Transpose();
-		g.mat_world = mat_world.Transpose();
-		mesh_inst->SetupBones();
-		const vector<Matrix>& bones = mesh_inst->GetMatrixBones();
-		for(size_t i = 0, count = bones.size(); i < count; ++i)
-			g.mat_bones[i] = bones[i].Transpose();
-		device_context->Unmap(vs_buffer_animated, 0);
+		// set pixel shader constants
+		if(batch.tint != current_tint)
+		{
+			current_tint = batch.tint;
+			C(device_context->Map(ps_buffer_object, 0, D3D11_MAP_WRITE_DISCARD, 0, &resource));
+			PixelShaderPerObject& pspo = *(PixelShaderPerObject*)resource.pData;
+			pspo.tint = batch.tint;
+			device_context->Unmap(ps_buffer_object, 0);
+		}
+
+		// set buffers
+		if(batch.mesh != current_mesh)
+		{
+			current_mesh = batch.mesh;
+			uint stride = (batch.mesh->IsAnimated() ? sizeof(AniVertex) : sizeof(Vertex)),
+				offset = 0;
+			device_context->IASetVertexBuffers(0, 1, &batch.mesh->vb, &stride, &offset);
+			device_context->IASetIndexBuffer(batch.mesh->ib, batch.mesh->IsIndex32() ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT, 0);
+		}
+
+		// draw submeshes
+		int index = 1 << 0;
+		for(Mesh::Submesh& sub : batch.mesh->subs)
+		{
+			if(IS_SET(batch.subs, index))
+			{
+				assert(sub.tex && sub.tex->tex);
+				if(sub.tex != current_tex)
+				{
+					current_tex = sub.tex;
+					device_context->PSSetShaderResources(0, 1, &sub.tex->tex);
+				}
+				if(batch.mode == RenderQueue::MODE_MESH)
+					device_context->DrawIndexedInstanced(sub.tris * 3, batch.count, sub.first * 3, sub.min_ind, first_instance);
+				else
+					device_context->DrawIndexed(sub.tris * 3, sub.first * 3, sub.min_ind);
+			}
+			index <<= 1;
+		}
 	}
+}
+
+void MeshShader::SetMode(Mode mode)
+{
+	if(mode == current_mode)
+		return;
 
-	// set pixel shader constants
-	C(device_context->Map(ps_buffer_object, 0, D3D11_MAP_WRITE_DISCARD, 0, &resource));
-	PixelShaderPerObject& pspo = *(PixelShaderPerObject*)resource.pData;
-	pspo.tint = tint;
-	device_context->Unmap(ps_buffer_object, 0);
-
-	// set buffers
-	uint stride = (current_mode == MODE_MESH ? sizeof(Vertex) : sizeof(AniVertex)),
-		offset = 0;
-	device_context->IASetVertexBuffers(0, 1, &mesh->vb, &stride, &offset);
-	device_context->IASetIndexBuffer(mesh->ib, DXGI_FORMAT_R16_UINT, 0);
-
-	// draw submeshes
-	int index = 1 << 0;
-	for(Mesh::Submesh& sub : mesh->subs)
+	current_mode = mode;
+	switch(mode)
 	{
-		if(IS_SET(subs, index))
+	case RenderQueue::MODE_MESH:
 		{
-			assert(sub.tex && sub.tex->tex);
-			device_context->PSSetShaderResources(0, 1, &sub.tex->tex);
-			device_context->DrawIndexed(sub.tris * 3, sub.first * 3, sub.min_ind);
+			device_context->IASetInputLayout(layout_mesh);
+			device_context->VSSetShader(vertex_shader_instanced, nullptr, 0);
+			device_context->VSSetConstantBuffers(0, 1, &vs_buffer_instanced);
+			uint stride = sizeof(Matrix),
+				offset = 0;
+			device_context->IASetVertexBuffers(1, 1, &instance_buffer, &stride, &offset);
 		}
-		index <<= 1;
+		break;
+	case RenderQueue::MODE_ANIMATED:
+		device_context->IASetInputLayout(layout_animated);
+		device_context->VSSetShader(vertex_shader_animated, nullptr, 0);
+		device_context->VSSetConstantBuffers(0, 1, &vs_buffer_animated);
+		break;
+	case RenderQueue::MODE_ANIMATED_NO_INST:
+		device_context->IASetInputLayout(layout_animated_no_inst);
+		device_context->VSSetShader(vertex_shader, nullptr, 0);
+		device_context->VSSetConstantBuffers(0, 1, &vs_buffer);
+		break;
 	}
 }
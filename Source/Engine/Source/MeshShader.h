@@ -1,31 +1,37 @@
 #pragma once
 
+#include "RenderQueue.h"
+
 class MeshShader
 {
 public:
 	MeshShader(Render* render);
 	~MeshShader();
 	void Init();
-	void Prepare(const Vec3& fog_color, const Vec3& fog_params, const Vec3& light_dir, const Vec3& light_color, const Vec3& ambient_color);
-	void DrawMesh(Mesh* mesh, MeshInstance* mesh_inst, const Matrix& mat_combined, const Matrix& mat_world, const Vec4& tint, int subs);
+	void Prepare(const Vec3& fog_color, const Vec3& fog_params, const Vec3& light_dir, const Vec3& light_color, const Vec3& ambient_color,
+		const Matrix& mat_view_proj);
+	void Draw(const RenderQueue& queue);
 
 private:
-	enum Mode
-	{
-		MODE_NONE,
-		MODE_MESH,
-		MODE_ANIMATED,
-		MODE_ANIMATED_NO_INST
-	};
+	typedef RenderQueue::Mode Mode;
+
+	static const uint INSTANCE_BUFFER_SIZE = 4096;
 
 	void InitInternal();
+	void SetMode(Mode mode);
 
 	Render* render;
 	ID3D11DeviceContext* device_context;
-	ID3D11VertexShader* vertex_shader, *vertex_shader_animated;
+	ID3D11VertexShader* vertex_shader, *vertex_shader_instanced, *vertex_shader_animated;
 	ID3D11PixelShader* pixel_shader;
 	ID3D11InputLayout* layout_mesh, *layout_animated, *layout_animated_no_inst;
-	ID3D11Buffer* vs_buffer, *vs_buffer_animated, *ps_buffer, *ps_buffer_object;
+	ID3D11Buffer* vs_buffer, *vs_buffer_instanced, *vs_buffer_animated, *ps_buffer, *ps_buffer_object;
+	ID3D11Buffer* instance_buffer; // world matrices of instanced meshes, filled as ring buffer
 	ID3D11SamplerState* sampler;
+	Matrix mat_view_proj;
 	Mode current_mode;
+	Mesh* current_mesh;
+	Texture* current_tex;
+	Vec4 current_tint;
+	uint instance_pos;
 };
@@ -0,0 +1,177 @@
+#include "EngineCore.h"
+#include "NameTable.h"
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+
+namespace
+{
+	// entries are in pages that never move, so id can be resolved without lock
+	struct Entry
+	{
+		cstring name;
+		uint hash;
+	};
+
+	const uint PAGE_BITS = 10;
+	const uint PAGE_SIZE = 1u << PAGE_BITS;
+	const uint MAX_PAGES = 1024;
+	const uint STRINGS_BLOCK_SIZE = 16 * 1024;
+
+	struct Table
+	{
+		Table() : count(1), strings_pos(STRINGS_BLOCK_SIZE)
+		{
+			for(std::atomic<Entry*>& page : pages)
+				page = nullptr;
+			pages[0] = new Entry[PAGE_SIZE];
+			pages[0].load()[0] = { "", 0 };
+			slots.resize(1024, 0u);
+		}
+		~Table()
+		{
+			for(std::atomic<Entry*>& page : pages)
+				delete[] page.load();
+			for(char* block : strings)
+				delete[] block;
+		}
+
+		const Entry& GetEntry(NameId id) const
+		{
+			return pages[id >> PAGE_BITS].load(std::memory_order_acquire)[id & (PAGE_SIZE - 1)];
+		}
+
+		// return slot with name or empty slot where it should be added
+		uint FindSlot(cstring name, uint hash) const
+		{
+			const uint mask = slots.size() - 1;
+			for(uint i = hash & mask; ; i = (i + 1) & mask)
+			{
+				const NameId id = slots[i];
+				if(id == 0)
+					return i;
+				const Entry& entry = GetEntry(id);
+				if(entry.hash == hash && _stricmp(entry.name, name) == 0)
+					return i;
+			}
+		}
+
+		cstring CopyString(cstring name)
+		{
+			const uint size = strlen(name) + 1;
+			if(strings_pos + size > STRINGS_BLOCK_SIZE)
+			{
+				strings.push_back(new char[max(size, STRINGS_BLOCK_SIZE)]);
+				strings_pos = 0;
+			}
+			char* str = strings.back() + strings_pos;
+			memcpy(str, name, size);
+			strings_pos += size;
+			return str;
+		}
+
+		// grow at half load, hashes are stored so names are not hashed again
+		void Grow()
+		{
+			vector<NameId> old_slots;
+			old_slots.swap(slots);
+			slots.resize(old_slots.size() * 2, 0u);
+			const uint mask = slots.size() - 1;
+			for(NameId id : old_slots)
+			{
+				if(id == 0)
+					continue;
+				uint i = GetEntry(id).hash & mask;
+				while(slots[i] != 0)
+					i = (i + 1) & mask;
+				slots[i] = id;
+			}
+		}
+
+		std::shared_mutex mutex;
+		vector<NameId> slots;
+		std::atomic<Entry*> pages[MAX_PAGES];
+		std::atomic<uint> count;
+		vector<char*> strings;
+		uint strings_pos;
+	};
+
+	Table& GetTable()
+	{
+		static Table table;
+		return table;
+	}
+}
+
+NameId NameTable::Add(cstring name)
+{
+	assert(name);
+	if(name[0] == 0)
+		return 0;
+
+	Table& table = GetTable();
+	const uint hash = Hash(name);
+	{
+		std::shared_lock<std::shared_mutex> lock(table.mutex);
+		const NameId id = table.slots[table.FindSlot(name, hash)];
+		if(id != 0)
+			return id;
+	}
+
+	std::unique_lock<std::shared_mutex> lock(table.mutex);
+	uint slot = table.FindSlot(name, hash);
+	if(table.slots[slot] != 0)
+		return table.slots[slot]; // added in meantime
+
+	const NameId id = table.count;
+	if((id >> PAGE_BITS) >= MAX_PAGES)
+		throw "Too many names.";
+	std::atomic<Entry*>& page = table.pages[id >> PAGE_BITS];
+	if(!page.load(std::memory_order_relaxed))
+		page.store(new Entry[PAGE_SIZE], std::memory_order_release);
+	Entry& entry = page.load(std::memory_order_relaxed)[id & (PAGE_SIZE - 1)];
+	entry.name = table.CopyString(name);
+	entry.hash = hash;
+	table.count.store(id + 1, std::memory_order_release);
+
+	table.slots[slot] = id;
+	if(table.count * 2 > table.slots.size())
+		table.Grow();
+	return id;
+}
+
+NameId NameTable::Find(cstring name)
+{
+	assert(name);
+	if(name[0] == 0)
+		return 0;
+
+	Table& table = GetTable();
+	const uint hash = Hash(name);
+	std::shared_lock<std::shared_mutex> lock(table.mutex);
+	return table.slots[table.FindSlot(name, hash)];
+}
+
+cstring NameTable::GetName(NameId id)
+{
+	Table& table = GetTable();
+	assert(id < table.count.load(std::memory_order_acquire));
+	return table.GetEntry(id).name;
+}
+
+uint NameTable::GetCount()
+{
+	return GetTable().count.load(std::memory_order_acquire);
+}
+
+uint NameTable::Hash(cstring name)
+{
+	assert(name);
+	uint hash = 2166136261u;
+	for(; *name; ++name)
+	{
+		hash ^= (byte)tolower((byte)*name);
+		hash *= 16777619u;
+	}
+	return hash;
+}
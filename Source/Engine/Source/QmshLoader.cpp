@@ -7,32 +7,50 @@
 #include <d3d11_1.h>
 
 QmshLoader::QmshLoader(ResourceManager* res_mgr, ID3D11Device* device, ID3D11DeviceContext* device_context)
-	: res_mgr(res_mgr), device(device), device_context(device_context)
+	: res_mgr(res_mgr), device(device), device_context(device_context), priority(ResourceManager::Priority::Normal), async(false)
 {
 }
 
-Mesh* QmshLoader::Load(cstring name, cstring path, bool raw)
+QmshLoader::QmshLoader(ResourceManager* res_mgr, ResourceManager::Priority priority)
+	: res_mgr(res_mgr), device(nullptr), device_context(nullptr), priority(priority), async(true)
+{
+}
+
+Mesh* QmshLoader::Load(cstring name, FileReader& f, bool raw)
 {
 	Mesh* mesh = new Mesh(name);
+	try
+	{
+		Load(*mesh, f, raw);
+	}
+	catch(cstring)
+	{
+		delete mesh;
+		throw;
+	}
+	return mesh;
+}
 
-	cstring dir_part = strrchr(name, '/');
-	if(!dir_part)
+void QmshLoader::Load(Mesh& mesh, FileReader& f, bool raw)
+{
+	// without device keep mesh data in memory
+	if(!device)
+		raw = true;
+
+	size_t pos = mesh.name.find_last_of('/');
+	if(pos == string::npos)
 		dir.clear();
 	else
-		dir = string(name, dir_part - name + 1);
+		dir = mesh.name.substr(0, pos + 1);
 
 	try
 	{
-		FileReader f(path);
-		LoadInternal(*mesh, f, raw);
+		LoadInternal(mesh, f, raw);
 	}
 	catch(cstring err)
 	{
-		delete mesh;
-		throw Format("Failed to load mesh '%s': %s", path, err);
+		throw Format("Failed to load mesh '%s': %s", mesh.name.c_str(), err);
 	}
-
-	return mesh;
 }
 
 void QmshLoader::LoadInternal(Mesh& mesh, FileReader& f, bool raw)
@@ -87,15 +105,20 @@ void QmshLoader::LoadInternal(Mesh& mesh, FileReader& f, bool raw)
 	if(!f.Ensure(size))
 		throw "Failed to read vertex data.";
 
+	// use data in place when file is mapped, otherwise copy it once
+	const byte* data = f.ReadInPlace(size);
 	if(raw)
 	{
 		mesh.vertex_data.resize(size);
-		f.Read(mesh.vertex_data.data(), size);
+		if(data)
+			memcpy(mesh.vertex_data.data(), data, size);
+		else
+			f.Read(mesh.vertex_data.data(), size);
 	}
 	else
 	{
-		buf.resize(size);
-		f.Read(buf.data(), size);
+		if(!data)
+			data = ReadToBuffer(f, size);
 
 		D3D11_BUFFER_DESC v_desc;
 		v_desc.Usage = D3D11_USAGE_DEFAULT;
@@ -106,7 +129,7 @@ void QmshLoader::LoadInternal(Mesh& mesh, FileReader& f, bool raw)
 		v_desc.StructureByteStride = 0;
 
 		D3D11_SUBRESOURCE_DATA v_data;
-		v_data.pSysMem = buf.data();
+		v_data.pSysMem = data;
 
 		HRESULT result = device->CreateBuffer(&v_desc, &v_data, &mesh.vb);
 		if(FAILED(result))
@@ -118,15 +141,19 @@ void QmshLoader::LoadInternal(Mesh& mesh, FileReader& f, bool raw)
 	if(!f.Ensure(size))
 		throw "Failed to read index data.";
 
+	data = f.ReadInPlace(size);
 	if(raw)
 	{
 		mesh.index_data.resize(size / 2);
-		f.Read(mesh.index_data.data(), size);
+		if(data)
+			memcpy(mesh.index_data.data(), data, size);
+		else
+			f.Read(mesh.index_data.data(), size);
 	}
 	else
 	{
-		buf.resize(size);
-		f.Read(buf.data(), size);
+		if(!data)
+			data = ReadToBuffer(f, size);
 
 		D3D11_BUFFER_DESC v_desc;
 		v_desc.Usage = D3D11_USAGE_DEFAULT;
@@ -137,7 +164,7 @@ void QmshLoader::LoadInternal(Mesh& mesh, FileReader& f, bool raw)
 		v_desc.StructureByteStride = 0;
 
 		D3D11_SUBRESOURCE_DATA v_data;
-		v_data.pSysMem = buf.data();
+		v_data.pSysMem = data;
 
 		HRESULT result = device->CreateBuffer(&v_desc, &v_data, &mesh.ib);
 		if(FAILED(result))
@@ -152,17 +179,14 @@ void QmshLoader::LoadInternal(Mesh& mesh, FileReader& f, bool raw)
 	uint index = 0;
 	for(auto& sub : mesh.subs)
 	{
-		f >> sub.first;
-		f >> sub.tris;
-		f >> sub.min_ind;
+		f.ReadCasted<word>(sub.first);
+		f.ReadCasted<word>(sub.tris);
+		f.ReadCasted<word>(sub.min_ind);
 		f.Skip<word>();
 		f >> sub.name;
 		f >> filename;
 
-		if(!filename.empty())
-			sub.tex = res_mgr->GetTexture(Format("%s%s", dir.c_str(), filename.c_str()));
-		else
-			sub.tex = nullptr;
+		sub.tex = GetTexture(filename);
 
 		// specular value
 		f >> sub.specular_color;
@@ -175,7 +199,7 @@ void QmshLoader::LoadInternal(Mesh& mesh, FileReader& f, bool raw)
 			f >> filename;
 			if(!filename.empty())
 			{
-				sub.tex_normal = res_mgr->GetTexture(Format("%s%s", dir.c_str(), filename.c_str()));
+				sub.tex_normal = GetTexture(filename);
 				f >> sub.normal_factor;
 			}
 			else
@@ -188,7 +212,7 @@ void QmshLoader::LoadInternal(Mesh& mesh, FileReader& f, bool raw)
 		f >> filename;
 		if(!filename.empty())
 		{
-			sub.tex_specular = res_mgr->GetTexture(Format("%s%s", dir.c_str(), filename.c_str()));
+			sub.tex_specular = GetTexture(filename);
 			f >> sub.specular_factor;
 			f >> sub.specular_color_factor;
 		}
@@ -214,6 +238,7 @@ void QmshLoader::LoadInternal(Mesh& mesh, FileReader& f, bool raw)
 		Mesh::Bone& zero_bone = mesh.bones[0];
 		zero_bone.parent = 0;
 		zero_bone.name = "zero";
+		zero_bone.name_id = NameTable::Add("zero");
 		zero_bone.id = 0;
 		zero_bone.mat = Matrix::IdentityMatrix;
 
@@ -242,6 +267,7 @@ void QmshLoader::LoadInternal(Mesh& mesh, FileReader& f, bool raw)
 			bone.mat._44 = 1;
 
 			f.Read(bone.name);
+			bone.name_id = NameTable::Add(bone.name.c_str());
 
 			mesh.bones[bone.parent].childs.push_back(i);
 		}
@@ -264,20 +290,29 @@ void QmshLoader::LoadInternal(Mesh& mesh, FileReader& f, bool raw)
 			Mesh::Animation& anim = mesh.anims[i];
 
 			f.Read(anim.name);
+			anim.name_id = NameTable::Add(anim.name.c_str());
 			f.Read(anim.length);
 			f.Read(anim.n_frames);
 
-			size = anim.n_frames * (4 + sizeof(Mesh::KeyframeBone) * real_bones);
+			const uint frame_bones_size = sizeof(Mesh::KeyframeBone) * real_bones;
+			size = anim.n_frames * (4 + frame_bones_size);
 			if(!f.Ensure(size))
 				throw Format("Failed to read animation %u data.", i);
 
+			// read all keyframes at once, bones of all frames are stored in single allocation
+			data = f.ReadInPlace(size);
+			if(!data)
+				data = ReadToBuffer(f, size);
 			anim.frames.resize(anim.n_frames);
+			anim.bones.resize(anim.n_frames * real_bones);
 
 			for(word j = 0; j < anim.n_frames; ++j)
 			{
-				f.Read(anim.frames[j].time);
-				anim.frames[j].bones.resize(real_bones);
-				f.Read(anim.frames[j].bones.data(), sizeof(Mesh::KeyframeBone) * real_bones);
+				Mesh::Keyframe& frame = anim.frames[j];
+				memcpy(&frame.time, data, sizeof(frame.time));
+				frame.bones_offset = j * real_bones;
+				memcpy(&anim.bones[frame.bones_offset], data + sizeof(frame.time), frame_bones_size);
+				data += sizeof(frame.time) + frame_bones_size;
 			}
 		}
 	}
@@ -293,6 +328,7 @@ void QmshLoader::LoadInternal(Mesh& mesh, FileReader& f, bool raw)
 		Mesh::Point& p = mesh.attach_points[i];
 
 		f.Read(p.name);
+		p.name_id = NameTable::Add(p.name.c_str());
 		f.Read(p.mat);
 		f.Read(p.bone);
 		f.Read(p.type);
@@ -328,9 +364,60 @@ void QmshLoader::LoadInternal(Mesh& mesh, FileReader& f, bool raw)
 			throw "Failed to read bone groups data.";
 
 		mesh.SetupBoneMatrices();
+		mesh.SetupAnimationBlocks();
 	}
 }
 
+const byte* QmshLoader::ReadToBuffer(FileReader& f, uint size)
+{
+	buf.resize(size);
+	f.Read(buf.data(), size);
+	return buf.data();
+}
+
+Texture* QmshLoader::GetTexture(const string& filename)
+{
+	if(filename.empty())
+		return nullptr;
+	const string path = dir + filename;
+	if(async)
+		return res_mgr->GetTextureAsync(path, priority);
+	return res_mgr->GetTexture(path);
+}
+
+// create buffers for mesh loaded in raw mode & free its data, in headless mode data is kept
+void QmshLoader::Upload(Mesh& mesh)
+{
+	if(!device)
+		return;
+
+	D3D11_BUFFER_DESC v_desc;
+	v_desc.Usage = D3D11_USAGE_DEFAULT;
+	v_desc.ByteWidth = mesh.vertex_data.size();
+	v_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	v_desc.CPUAccessFlags = 0;
+	v_desc.MiscFlags = 0;
+	v_desc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA v_data;
+	v_data.pSysMem = mesh.vertex_data.data();
+
+	HRESULT result = device->CreateBuffer(&v_desc, &v_data, &mesh.vb);
+	if(FAILED(result))
+		throw Format("Failed to create vertex buffer for mesh '%s' (%u).", mesh.name.c_str(), result);
+
+	v_desc.ByteWidth = sizeof(word) * mesh.index_data.size();
+	v_desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	v_data.pSysMem = mesh.index_data.data();
+
+	result = device->CreateBuffer(&v_desc, &v_data, &mesh.ib);
+	if(FAILED(result))
+		throw Format("Failed to create index buffer for mesh '%s' (%u).", mesh.name.c_str(), result);
+
+	vector<byte>().swap(mesh.vertex_data);
+	vector<word>().swap(mesh.index_data);
+}
+
 Mesh* QmshLoader::Create(MeshBuilder* mesh_builder)
 {
 	assert(mesh_builder);
@@ -349,37 +436,61 @@ Mesh* QmshLoader::Create(MeshBuilder* mesh_builder)
 
 void QmshLoader::CreateInternal(Mesh& mesh, MeshBuilder& builder)
 {
-	mesh.head.flags = 0;
+	const bool index32 = builder.IsIndex32();
+	mesh.head.flags = (index32 ? Mesh::F_INDEX32 : 0);
 
 	// vb
 	uint vertex_size = sizeof(Vertex);
 	uint size = vertex_size * builder.vertices.size();
 
-	D3D11_BUFFER_DESC v_desc;
-	v_desc.Usage = D3D11_USAGE_DEFAULT;
-	v_desc.ByteWidth = size;
-	v_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	v_desc.CPUAccessFlags = 0;
-	v_desc.MiscFlags = 0;
-	v_desc.StructureByteStride = 0;
+	if(!device)
+	{
+		// headless mode, keep mesh data in memory
+		mesh.vertex_data.resize(size);
+		memcpy(mesh.vertex_data.data(), builder.vertices.data(), size);
+		if(index32)
+			mesh.index_data32 = builder.indices;
+		else
+			mesh.index_data.assign(builder.indices.begin(), builder.indices.end());
+	}
+	else
+	{
+		D3D11_BUFFER_DESC v_desc;
+		v_desc.Usage = D3D11_USAGE_DEFAULT;
+		v_desc.ByteWidth = size;
+		v_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		v_desc.CPUAccessFlags = 0;
+		v_desc.MiscFlags = 0;
+		v_desc.StructureByteStride = 0;
 
-	D3D11_SUBRESOURCE_DATA v_data;
-	v_data.pSysMem = builder.vertices.data();
+		D3D11_SUBRESOURCE_DATA v_data;
+		v_data.pSysMem = builder.vertices.data();
 
-	HRESULT result = device->CreateBuffer(&v_desc, &v_data, &mesh.vb);
-	if(FAILED(result))
-		throw Format("Failed to create vertex buffer (%u).", result);
+		HRESULT result = device->CreateBuffer(&v_desc, &v_data, &mesh.vb);
+		if(FAILED(result))
+			throw Format("Failed to create vertex buffer (%u).", result);
 
-	// ib
-	size = sizeof(word) * builder.indices.size();
+		// ib, use 16 bit indices when possible
+		vector<word> indices16;
+		if(index32)
+		{
+			size = sizeof(uint) * builder.indices.size();
+			v_data.pSysMem = builder.indices.data();
+		}
+		else
+		{
+			indices16.assign(builder.indices.begin(), builder.indices.end());
+			size = sizeof(word) * indices16.size();
+			v_data.pSysMem = indices16.data();
+		}
 
-	v_desc.ByteWidth = size;
-	v_desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	v_data.pSysMem = builder.indices.data();
+		v_desc.ByteWidth = size;
+		v_desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
 
-	result = device->CreateBuffer(&v_desc, &v_data, &mesh.ib);
-	if(FAILED(result))
-		throw Format("Failed to create index buffer (%u).", result);
+		result = device->CreateBuffer(&v_desc, &v_data, &mesh.ib);
+		if(FAILED(result))
+			throw Format("Failed to create index buffer (%u).", result);
+	}
 
 	// subs
 	mesh.subs.resize(builder.subs.size());
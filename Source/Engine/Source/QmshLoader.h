@@ -1,19 +1,30 @@
 #pragma once
 
+#include "ResourceManager.h"
+
 class QmshLoader
 {
 public:
 	QmshLoader(ResourceManager* res_mgr, ID3D11Device* device, ID3D11DeviceContext* device_context);
-	Mesh* Load(cstring name, cstring path, bool raw);
+	// loader for worker thread, only decodes mesh data (raw mode) & requests textures asynchronously
+	QmshLoader(ResourceManager* res_mgr, ResourceManager::Priority priority);
+	// file can be mapped from disk or opened on memory from archive
+	Mesh* Load(cstring name, FileReader& f, bool raw);
+	void Load(Mesh& mesh, FileReader& f, bool raw);
+	void Upload(Mesh& mesh);
 	Mesh* Create(MeshBuilder* mesh_builder);
 
 private:
 	void LoadInternal(Mesh& mesh, FileReader& f, bool raw);
 	void CreateInternal(Mesh& mesh, MeshBuilder& builder);
+	const byte* ReadToBuffer(FileReader& f, uint size);
+	Texture* GetTexture(const string& filename);
 
 	ResourceManager* res_mgr;
 	ID3D11Device* device;
 	ID3D11DeviceContext* device_context;
 	vector<byte> buf;
 	string dir;
+	ResourceManager::Priority priority;
+	bool async;
 };
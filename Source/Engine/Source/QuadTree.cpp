@@ -2,157 +2,229 @@
 #include "QuadTree.h"
 
 
-QuadTree::Factory default_factory;
-
-
-void QuadTree::Part::Remove(Factory* factory)
+// spread bits of value to even positions (used for Z-order)
+inline uint SpreadBits(uint value)
 {
-	for(int i = 0; i < 4; ++i)
-	{
-		if(childs[i])
-			childs[i]->Remove(factory);
-	}
-	factory->Remove(this);
+	value &= 0x0000FFFF;
+	value = (value | (value << 8)) & 0x00FF00FF;
+	value = (value | (value << 4)) & 0x0F0F0F0F;
+	value = (value | (value << 2)) & 0x33333333;
+	value = (value | (value << 1)) & 0x55555555;
+	return value;
 }
 
 
-QuadTree::QuadTree() : root(nullptr)
-{
-	factory = &default_factory;
-}
-
-QuadTree::~QuadTree()
+QuadTree::QuadTree() : splits(0), leafs(0)
 {
-	if(root)
-		root->Remove(factory);
 }
 
-void QuadTree::Init(float size, uint splits, Factory* new_factory)
+void QuadTree::Init(float new_size, uint new_splits)
 {
-	assert(size > 0 && splits > 0);
-	if(new_factory)
-		factory = new_factory;
-
-	root = factory->Create();
-	root->box = Box2d(0, 0, size, size);
-	root->size = splits;
-	c.push_back(root);
-
-	while(!c.empty())
+	assert(new_size > 0 && new_splits > 0 && new_splits <= MAX_SPLITS);
+	size = new_size;
+	splits = new_splits;
+	leafs = 1u << (2 * splits);
+	leaf_size = size / (1u << splits);
+
+	groups.resize(GetGroupIndex(splits, 0));
+
+	// root, other lanes are never checked
+	Group& root = groups[0];
+	root.min_x = XMFLOAT4(0, 0, 0, 0);
+	root.min_z = XMFLOAT4(0, 0, 0, 0);
+	root.max_x = XMFLOAT4(size, 0, 0, 0);
+	root.max_z = XMFLOAT4(size, 0, 0, 0);
+
+	for(uint level = 0; level < splits; ++level)
 	{
-		Part& part = *c.back();
-		c.pop_back();
-
-		for(int i = 0; i < 4; ++i)
+		const uint count = 1u << level; // nodes in row at this level
+		const float node_size = size / count,
+			half_size = node_size / 2;
+		for(uint index = 0, max_index = count * count; index < max_index; ++index)
 		{
-			part.childs[i] = factory->Create();
-			Part& child = *part.childs[i];
-			child.size = part.size - 1;
-			if(child.size == 0)
+			// decode Z-order index to node position
+			uint x = 0, y = 0;
+			for(uint bit = 0; bit < level; ++bit)
 			{
-				for(int j = 0; j < 4; ++j)
-					child.childs[j] = nullptr;
+				x |= ((index >> (2 * bit)) & 1) << bit;
+				y |= ((index >> (2 * bit + 1)) & 1) << bit;
 			}
-			else
-				c.push_back(&child);
-		}
 
-		part.childs[LEFT_TOP]->box = part.box.LeftTopPart();
-		part.childs[RIGHT_TOP]->box = part.box.RightTopPart();
-		part.childs[LEFT_BOTTOM]->box = part.box.LeftBottomPart();
-		part.childs[RIGHT_BOTTOM]->box = part.box.RightBottomPart();
+			const float left = node_size * x,
+				top = node_size * y;
+			Group& group = groups[GetGroupIndex(level, index)];
+			group.min_x = XMFLOAT4(left, left + half_size, left, left + half_size);
+			group.min_z = XMFLOAT4(top, top, top + half_size, top + half_size);
+			group.max_x = XMFLOAT4(left + half_size, left + node_size, left + half_size, left + node_size);
+			group.max_z = XMFLOAT4(top + half_size, top + half_size, top + node_size, top + node_size);
+		}
 	}
-
-	leaf_size = (float)(size / pow(2u, splits));
 }
 
 Int2 QuadTree::PosToIndex(const Vec2& pos)
 {
-	if(pos.x < 0 || pos.y < 0 || pos.x > root->box.v2.x || pos.y > root->box.v2.y)
+	if(pos.x < 0 || pos.y < 0 || pos.x > size || pos.y > size)
 		return Int2(-1, -1);
 	else
 		return Int2(int(pos.x / leaf_size), int(pos.y / leaf_size));
 }
 
-QuadTree::Part* QuadTree::GetPart(const Int2& pt)
+uint QuadTree::GetLeafIndex(const Int2& pt)
 {
-	return GetPart(Vec2(leaf_size * pt.x + leaf_size / 2, leaf_size * pt.y + leaf_size / 2));
+	const int max_pt = (1 << splits) - 1;
+	assert(pt.x >= 0 && pt.y >= 0 && pt.x <= max_pt && pt.y <= max_pt);
+	return SpreadBits(pt.x) | (SpreadBits(pt.y) << 1);
 }
 
-QuadTree::Part* QuadTree::GetPart(const Vec2& pos)
+uint QuadTree::GetLeafIndex(const Vec2& pos)
 {
-	if(pos.x < 0 || pos.y < 0 || pos.x > root->box.v2.x || pos.y > root->box.v2.y)
-		return nullptr;
+	Int2 pt = PosToIndex(pos);
+	if(pt.x == -1)
+		return (uint)-1;
+	const int max_pt = (1 << splits) - 1;
+	return GetLeafIndex(Int2(min(pt.x, max_pt), min(pt.y, max_pt)));
+}
 
-	Part* part = root;
-	while(true)
+Box2d QuadTree::GetLeafBox(uint index) const
+{
+	assert(index < leafs);
+	uint x = 0, y = 0;
+	for(uint bit = 0; bit < splits; ++bit)
 	{
-		Vec2 midpoint = part->box.Midpoint();
-		int index;
-		if(pos.x >= midpoint.x)
-		{
-			if(pos.y >= midpoint.y)
-				index = RIGHT_BOTTOM;
-			else
-				index = RIGHT_TOP;
-		}
-		else
-		{
-			if(pos.y >= midpoint.y)
-				index = LEFT_BOTTOM;
-			else
-				index = LEFT_TOP;
-		}
-
-		part = part->childs[index];
-		if(part->IsLeaf())
-			break;
+		x |= ((index >> (2 * bit)) & 1) << bit;
+		y |= ((index >> (2 * bit + 1)) & 1) << bit;
 	}
+	return Box2d(leaf_size * x, leaf_size * y, leaf_size * (x + 1), leaf_size * (y + 1));
+}
 
-	return part;
+// node for object in loose quadtree, object must fit in node size and have center inside node
+uint QuadTree::GetLooseNodeId(const Vec2& pos, float radius)
+{
+	if(pos.x < 0 || pos.y < 0 || pos.x > size || pos.y > size || radius * 2 > size)
+		return INVALID_NODE;
+	uint level = splits;
+	while(level > 0 && size / (1u << level) < radius * 2)
+		--level;
+	const int max_pt = (1 << level) - 1;
+	const float node_size = size / (1u << level);
+	const uint x = (uint)min(int(pos.x / node_size), max_pt),
+		y = (uint)min(int(pos.y / node_size), max_pt);
+	return GetNodeId(level, SpreadBits(x) | (SpreadBits(y) << 1));
 }
 
-void QuadTree::ListVisibleParts(FrustumPlanes& frustum, vector<Part*>& parts)
+// list ranges of nodes that are visible, node fully inside frustum is added without checking childs
+// normal - only leafs are returned
+// loose - boxes are extended by half of node size, all visible nodes are returned
+void QuadTree::ListVisible(const FrustumPlanes& frustum, bool loose, vector<Range>& ranges)
 {
-	parts.clear();
-	c.clear();
-	c.push_back(root);
+	// node childs to check or range of nodes to add (then first is first node & count is number of nodes)
+	struct Entry
+	{
+		uint group, level, first, count;
+	};
+	const uint RANGE = (uint)-1;
+	// each popped group at level L pushes at most 4 * (splits - L + 1) entries (loose mode, all lanes inside) & only one of them
+	// is expanded further, so stack never holds more than sum of it over all levels
+	const uint MAX_STACK = 2 * (MAX_SPLITS + 1) * (MAX_SPLITS + 2);
+	Entry stack[MAX_STACK];
+	uint stack_size = 0;
+	auto push = [&](uint group, uint level, uint first, uint count)
+	{
+		assert(stack_size < MAX_STACK);
+		stack[stack_size++] = { group, level, first, count };
+	};
+
+	ranges.clear();
+	if(leafs == 0)
+		return;
+	push(0, 0, 0, 1);
 
-	while(!c.empty())
+	while(stack_size > 0)
 	{
-		Part* part = c.back();
-		c.pop_back();
-		if(frustum.BoxToFrustum(part->box))
+		const Entry e = stack[--stack_size];
+		if(e.group == RANGE)
 		{
-			if(part->IsLeaf())
-				parts.push_back(part);
+			Range* prev = ranges.empty() ? nullptr : &ranges.back();
+			if(prev && prev->level == e.level && prev->end == e.first)
+				prev->end += e.count;
 			else
-			{
-				for(int i = 0; i < 4; ++i)
-					c.push_back(part->childs[i]);
-			}
+				ranges.push_back({ e.level, e.first, e.first + e.count });
+			continue;
 		}
-	}
-}
 
-void QuadTree::ForEach(delegate<void(Part*)> callback, bool leaf_only)
-{
-	assert(callback);
-	c.clear();
-	c.push_back(root);
+		const Group& group = groups[e.group];
+		XMVECTOR min_x = XMLoadFloat4(&group.min_x),
+			min_z = XMLoadFloat4(&group.min_z),
+			max_x = XMLoadFloat4(&group.max_x),
+			max_z = XMLoadFloat4(&group.max_z);
+		float min_y = MIN_Y,
+			max_y = MAX_Y;
+		if(loose)
+		{
+			const float expand = size / (1u << e.level) / 2;
+			const XMVECTOR v_expand = XMVectorReplicate(expand);
+			min_x = XMVectorSubtract(min_x, v_expand);
+			min_z = XMVectorSubtract(min_z, v_expand);
+			max_x = XMVectorAdd(max_x, v_expand);
+			max_z = XMVectorAdd(max_z, v_expand);
+			min_y -= expand;
+			max_y += expand;
+		}
 
-	while(!c.empty())
-	{
-		Part* part = c.back();
-		c.pop_back();
-		if(part->IsLeaf())
-			callback(part);
-		else
+		// check 4 boxes against each plane, using nearest (for intersection) & farthest (for inside) corner
+		XMVECTOR visible = XMVectorTrueInt(),
+			inside = XMVectorTrueInt();
+		for(int i = 0; i < 6; ++i)
+		{
+			const Plane& plane = frustum.planes[i];
+			const XMVECTOR a = XMVectorReplicate(plane.x),
+				c = XMVectorReplicate(plane.z);
+			const bool pos_x = plane.x > 0.f,
+				pos_z = plane.z > 0.f;
+			const float far_y = (plane.y > 0.f ? max_y : min_y),
+				near_y = (plane.y > 0.f ? min_y : max_y);
+			const XMVECTOR far_dist = XMVectorMultiplyAdd(a, pos_x ? max_x : min_x,
+				XMVectorMultiplyAdd(c, pos_z ? max_z : min_z, XMVectorReplicate(plane.y * far_y + plane.w)));
+			const XMVECTOR near_dist = XMVectorMultiplyAdd(a, pos_x ? min_x : max_x,
+				XMVectorMultiplyAdd(c, pos_z ? min_z : max_z, XMVectorReplicate(plane.y * near_y + plane.w)));
+			visible = XMVectorAndInt(visible, XMVectorGreaterOrEqual(far_dist, XMVectorZero()));
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(near_dist, XMVectorZero()));
+		}
+
+		uint visible_lanes[4], inside_lanes[4];
+		XMStoreInt4(visible_lanes, visible);
+		XMStoreInt4(inside_lanes, inside);
+
+		// push in reverse order so nodes are listed in order and ranges can be merged
+		for(int lane = (int)e.count - 1; lane >= 0; --lane)
 		{
-			if(!leaf_only)
-				callback(part);
-			for(int i = 0; i < 4; ++i)
-				c.push_back(part->childs[i]);
+			if(!visible_lanes[lane])
+				continue;
+			const uint index = e.first + lane;
+			if(inside_lanes[lane] || e.level == splits)
+			{
+				// whole subtree is visible
+				if(loose)
+				{
+					for(uint level = splits; level > e.level; --level)
+					{
+						const uint count = 1u << (2 * (level - e.level));
+						push(RANGE, level, index * count, count);
+					}
+					push(RANGE, e.level, index, 1);
+				}
+				else
+				{
+					const uint count = 1u << (2 * (splits - e.level));
+					push(RANGE, splits, index * count, count);
+				}
+			}
+			else
+			{
+				push(GetGroupIndex(e.level, index), e.level + 1, index * 4, 4);
+				if(loose)
+					push(RANGE, e.level, index, 1);
+			}
 		}
 	}
 }
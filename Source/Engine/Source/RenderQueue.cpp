@@ -0,0 +1,168 @@
+#include "EngineCore.h"
+#include "RenderQueue.h"
+#include "SceneNode.h"
+#include "Mesh.h"
+#include "MeshInstance.h"
+
+
+void RenderQueue::Clear()
+{
+	entries.clear();
+	batches.clear();
+	matrices.clear();
+	bones.clear();
+	stats = {};
+}
+
+// node must be visible & have updated world matrix (and bones if animated)
+void RenderQueue::Add(SceneNode* node)
+{
+	assert(node && node->mesh);
+	Entry e;
+	e.mode = GetMode(node);
+	e.mesh = node->mesh;
+	e.mesh_inst = (e.mode == MODE_ANIMATED ? node->GetMeshInstance() : nullptr);
+	e.tex = GetFirstTexture(node->mesh, node->subs);
+	e.node = node;
+	entries.push_back(e);
+}
+
+RenderQueue::Mode RenderQueue::GetMode(SceneNode* node)
+{
+	if(node->GetMeshInstance())
+		return MODE_ANIMATED;
+	else if(node->mesh->IsAnimated())
+		return MODE_ANIMATED_NO_INST;
+	else
+		return MODE_MESH;
+}
+
+Texture* RenderQueue::GetFirstTexture(Mesh* mesh, int subs)
+{
+	int index = 1 << 0;
+	for(Mesh::Submesh& sub : mesh->subs)
+	{
+		if(IS_SET(subs, index))
+			return sub.tex;
+		index <<= 1;
+	}
+	return nullptr;
+}
+
+// sort nodes by state & pack nodes with same static mesh into instanced batches
+// when sort is false nodes are kept in order (for alpha nodes), only consecutive nodes are merged
+void RenderQueue::Build(bool sort)
+{
+	stats.nodes = entries.size();
+	CountUnsorted();
+
+	if(sort)
+	{
+		std::sort(entries.begin(), entries.end(), [](const Entry& e1, const Entry& e2)
+		{
+			if(e1.mode != e2.mode)
+				return e1.mode < e2.mode;
+			if(e1.tex != e2.tex)
+				return e1.tex < e2.tex;
+			if(e1.mesh != e2.mesh)
+				return e1.mesh < e2.mesh;
+			if(e1.node->subs != e2.node->subs)
+				return e1.node->subs < e2.node->subs;
+			return memcmp(&e1.node->tint, &e2.node->tint, sizeof(Vec4)) < 0;
+		});
+	}
+
+	matrices.reserve(entries.size());
+	Batch* prev = nullptr;
+	for(Entry& e : entries)
+	{
+		if(prev && e.mode == MODE_MESH && prev->mode == MODE_MESH && prev->mesh == e.mesh && prev->subs == e.node->subs
+			&& prev->tint == e.node->tint && prev->count < MAX_INSTANCES)
+			++prev->count;
+		else
+		{
+			Batch b;
+			b.mode = e.mode;
+			b.mesh = e.mesh;
+			b.tint = e.node->tint;
+			b.subs = e.node->subs;
+			b.first = matrices.size();
+			b.count = 1;
+			b.first_bone = bones.size();
+			if(e.mesh_inst)
+			{
+				const vector<Matrix>& mesh_bones = e.mesh_inst->GetMatrixBones();
+				bones.insert(bones.end(), mesh_bones.begin(), mesh_bones.end());
+				b.bones = mesh_bones.size();
+			}
+			else
+				b.bones = 0;
+			batches.push_back(b);
+			prev = &batches.back();
+		}
+		matrices.push_back(e.node->GetWorldMatrix());
+	}
+
+	stats.batches = batches.size();
+	CountSorted();
+	entries.clear();
+}
+
+// state changes when drawing each node separately (vertex buffer & textures are set for every node, mode only when changed)
+void RenderQueue::CountUnsorted()
+{
+	Mode mode = MODE_NONE;
+	for(Entry& e : entries)
+	{
+		if(e.mode != mode)
+		{
+			mode = e.mode;
+			++stats.unsorted_state_changes;
+		}
+		++stats.unsorted_state_changes;
+		int index = 1 << 0;
+		for(uint i = 0, count = e.mesh->subs.size(); i < count; ++i, index <<= 1)
+		{
+			if(IS_SET(e.node->subs, index))
+			{
+				++stats.unsorted_state_changes;
+				++stats.unsorted_draw_calls;
+			}
+		}
+	}
+}
+
+// state changes when drawing batches, state is set only when it changes
+void RenderQueue::CountSorted()
+{
+	Mode mode = MODE_NONE;
+	Mesh* mesh = nullptr;
+	Texture* tex = nullptr;
+	for(Batch& b : batches)
+	{
+		if(b.mode != mode)
+		{
+			mode = b.mode;
+			++stats.state_changes;
+		}
+		if(b.mesh != mesh)
+		{
+			mesh = b.mesh;
+			++stats.state_changes;
+		}
+		int index = 1 << 0;
+		for(Mesh::Submesh& sub : b.mesh->subs)
+		{
+			if(IS_SET(b.subs, index))
+			{
+				if(sub.tex != tex)
+				{
+					tex = sub.tex;
+					++stats.state_changes;
+				}
+				++stats.draw_calls;
+			}
+			index <<= 1;
+		}
+	}
+}
@@ -9,20 +9,35 @@
 #include "Mesh.h"
 #include "Font.h"
 #include "Sound.h"
+#include "Archive.h"
 
-ResourceManager::ResourceManager()
+ResourceManager::ResourceManager() : thread_pool(nullptr), pending(0), request_index(0)
 {
 }
 
+// thread pool is already stopped, requests that weren't loaded are dropped
 ResourceManager::~ResourceManager()
 {
+	DeleteElements(requests);
+	DeleteElements(loaded);
 	DeleteElements(resources);
+	DeleteElements(archives);
 }
 
-void ResourceManager::Init(Render* render, SoundManager* sound_mgr)
+void ResourceManager::Init(Render* render, SoundManager* sound_mgr, ThreadPool* thread_pool)
 {
-	assert(render && sound_mgr);
+	assert(thread_pool);
+	this->thread_pool = thread_pool;
 
+	if(!render)
+	{
+		// headless mode, meshes are kept in memory, textures & sounds are only placeholders
+		assert(!sound_mgr);
+		qmsh_loader.reset(new QmshLoader(this, nullptr, nullptr));
+		return;
+	}
+
+	assert(sound_mgr);
 	ID3D11Device* device = render->GetDevice();
 	ID3D11DeviceContext* device_context = render->GetDeviceContext();
 	tex_loader.reset(new TextureLoader(device, device_context));
@@ -31,89 +46,240 @@ void ResourceManager::Init(Render* render, SoundManager* sound_mgr)
 	sound_loader.reset(new SoundLoader(sound_mgr));
 }
 
-Resource* ResourceManager::Get(cstring name, Resource::Type type)
+bool ResourceManager::Mount(Cstring path)
+{
+	Archive* archive = new Archive;
+	try
+	{
+		if(!archive->Open(path))
+		{
+			delete archive;
+			return false;
+		}
+	}
+	catch(cstring)
+	{
+		delete archive;
+		throw;
+	}
+	archives.push_back(archive);
+	Info("ResourceManager: Mounted archive '%s' (%u files).", path.s, archive->GetEntriesCount());
+	return true;
+}
+
+// return data of file from archive (in place or decompressed to buf), nullptr when not found
+const byte* ResourceManager::FindInArchives(cstring name, string& buf, uint& size)
+{
+	for(auto it = archives.rbegin(), end = archives.rend(); it != end; ++it)
+	{
+		Archive* archive = *it;
+		const Archive::Entry* entry = archive->Find(name);
+		if(!entry)
+			continue;
+		const byte* data = archive->GetData(*entry, buf);
+		if(!data)
+			throw Format("Corrupted archive entry '%s'.", name);
+		size = entry->size;
+		return data;
+	}
+	return nullptr;
+}
+
+// open file from archive or from Data dir, buf must be valid while file is used
+void ResourceManager::OpenFile(cstring name, FileReader& f, string& buf, FileReader::Mode mode)
+{
+	uint size;
+	const byte* data = FindInArchives(name, buf, size);
+	if(data)
+		f.OpenMemory(data, size);
+	else
+		f.Open(Format("Data/%s", name), mode);
+}
+
+// copy file content from archive
+bool ResourceManager::ReadFromArchives(cstring name, string& data)
+{
+	uint size;
+	const byte* ptr = FindInArchives(name, data, size);
+	if(!ptr)
+		return false;
+	if(ptr != (const byte*)data.data())
+		data.assign((cstring)ptr, size);
+	return true;
+}
+
+// find resource, wait for it if it is loading
+Resource* ResourceManager::Get(ResourceId id, Resource::Type type)
+{
+	assert(id != 0);
+
+	Resource* res;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		res = Find(id);
+		if(!res)
+			return nullptr;
+	}
+	if(res->type != type)
+		throw Format("Resource '%s' type mismatch.", res->name.c_str());
+	if(res->state == Resource::State::Loading)
+		Wait(res);
+	return res;
+}
+
+// resources are indexed by id, must be called with locked mutex
+Resource* ResourceManager::Find(ResourceId id) const
 {
-	assert(name);
+	return id < resources.size() ? resources[id] : nullptr;
+}
 
-	static Resource res_search;
-	res_search.name = name;
-	auto it = resources.find(&res_search);
-	if(it == resources.end())
-		return nullptr;
-	if((*it)->type != type)
-		throw Format("Resource '%s' type mismatch.", name);
-	return *it;
+void ResourceManager::Insert(Resource* res)
+{
+	assert(res->id != 0 && !Find(res->id));
+	if(res->id >= resources.size())
+		resources.resize(max(res->id + 1, NameTable::GetCount()), nullptr);
+	resources[res->id] = res;
 }
 
+// add loaded resource, if same resource was requested in meantime by worker thread use it instead
+Resource* ResourceManager::Add(Resource* res)
+{
+	Resource* existing;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		existing = Find(res->id);
+		if(!existing)
+		{
+			Insert(res);
+			return res;
+		}
+	}
+	delete res;
+	if(existing->state == Resource::State::Loading)
+		Wait(existing);
+	return existing;
+}
+
+// fonts are found by family name & size, only main thread use them
 Font* ResourceManager::GetFont(Cstring name, int size)
 {
 	assert(size >= 1);
-	cstring resource_name = Format("%s;%d", name, size);
-	Font* font = (Font*)Get(resource_name, Resource::Type::Font);
-	if(!font)
+	const NameId family = NameTable::Add(name);
+	for(const FontEntry& entry : fonts)
 	{
-		font = font_loader->Load(name, size);
-		resources.insert(font);
+		if(entry.family == family && entry.size == size)
+			return entry.font;
 	}
+
+	Font* font = (Font*)Add(font_loader->Load(name, size));
+	FontEntry entry = { family, size, font };
+	fonts.push_back(entry);
 	return font;
 }
 
-Mesh* ResourceManager::GetMesh(Cstring name)
+Mesh* ResourceManager::GetMesh(ResourceId id)
 {
-	Mesh* mesh = (Mesh*)Get(name, Resource::Type::Mesh);
+	Mesh* mesh = (Mesh*)Get(id, Resource::Type::Mesh);
 	if(!mesh)
 	{
-		cstring path = Format("Data/%s", name);
-		mesh = qmsh_loader->Load(name, path, false);
-		resources.insert(mesh);
+		cstring name = NameTable::GetName(id);
+		FileReader f;
+		string buf;
+		OpenFile(name, f, buf);
+		mesh = (Mesh*)Add(qmsh_loader->Load(name, f, false));
 	}
 	return mesh;
 }
 
-Mesh* ResourceManager::GetMeshRaw(Cstring name)
+Mesh* ResourceManager::GetMeshRaw(ResourceId id)
 {
-	Mesh* mesh = (Mesh*)Get(name, Resource::Type::Mesh);
+	Mesh* mesh = (Mesh*)Get(id, Resource::Type::Mesh);
 	if(!mesh)
 	{
-		cstring path = Format("Data/%s", name);
-		mesh = qmsh_loader->Load(name, path, true);
-		resources.insert(mesh);
+		cstring name = NameTable::GetName(id);
+		FileReader f;
+		string buf;
+		OpenFile(name, f, buf);
+		mesh = (Mesh*)Add(qmsh_loader->Load(name, f, true));
 	}
 	return mesh;
 }
 
-Music* ResourceManager::GetMusic(Cstring name)
+Music* ResourceManager::GetMusic(ResourceId id)
 {
-	Music* music = (Music*)Get(name, Resource::Type::Music);
+	Music* music = (Music*)Get(id, Resource::Type::Music);
 	if(!music)
 	{
-		cstring path = Format("Data/%s", name);
-		music = sound_loader->LoadMusic(name, path);
-		resources.insert(music);
+		cstring name = NameTable::GetName(id);
+		if(sound_loader)
+		{
+			string data;
+			if(ReadFromArchives(name, data))
+			{
+				unique_ptr<Music> ptr(new Music(name, nullptr));
+				sound_loader->LoadFromMemory(*ptr, data);
+				music = ptr.release();
+			}
+			else
+				music = sound_loader->LoadMusic(name, Format("Data/%s", name));
+		}
+		else
+			music = new Music(name, nullptr);
+		music = (Music*)Add(music);
 	}
 	return music;
 }
 
-Sound* ResourceManager::GetSound(Cstring name)
+Sound* ResourceManager::GetSound(ResourceId id)
 {
-	Sound* sound = (Sound*)Get(name, Resource::Type::Sound);
+	Sound* sound = (Sound*)Get(id, Resource::Type::Sound);
 	if(!sound)
 	{
-		cstring path = Format("Data/%s", name);
-		sound = sound_loader->LoadSound(name, path);
-		resources.insert(sound);
+		cstring name = NameTable::GetName(id);
+		if(sound_loader)
+		{
+			string data;
+			if(ReadFromArchives(name, data))
+			{
+				unique_ptr<Sound> ptr(new Sound(name, nullptr));
+				sound_loader->LoadFromMemory(*ptr, data);
+				sound = ptr.release();
+			}
+			else
+				sound = sound_loader->LoadSound(name, Format("Data/%s", name));
+		}
+		else
+			sound = new Sound(name, nullptr);
+		sound = (Sound*)Add(sound);
 	}
 	return sound;
 }
 
-Texture* ResourceManager::GetTexture(Cstring name)
+Texture* ResourceManager::GetTexture(ResourceId id)
 {
-	Texture* tex = (Texture*)Get(name, Resource::Type::Texture);
+	Texture* tex = (Texture*)Get(id, Resource::Type::Texture);
 	if(!tex)
 	{
-		cstring path = Format("Data/%s", name);
-		tex = tex_loader->Load(name, path);
-		resources.insert(tex);
+		cstring name = NameTable::GetName(id);
+		if(tex_loader)
+		{
+			string buf;
+			uint size;
+			const byte* data = FindInArchives(name, buf, size);
+			if(data)
+			{
+				unique_ptr<Texture> ptr(new Texture(name, nullptr));
+				TextureData tex_data;
+				tex_loader->Decode(*ptr, data, size, tex_data);
+				tex_loader->Create(*ptr, tex_data);
+				tex = ptr.release();
+			}
+			else
+				tex = tex_loader->Load(name, Format("Data/%s", name));
+		}
+		else
+			tex = new Texture(name, nullptr);
+		tex = (Texture*)Add(tex);
 	}
 	return tex;
 }
@@ -127,3 +293,260 @@ Mesh* ResourceManager::CreateMesh(MeshBuilder* mesh_builder)
 {
 	return qmsh_loader->Create(mesh_builder);
 }
+
+Mesh* ResourceManager::LoadMeshRaw(Cstring name, FileReader::Mode mode)
+{
+	FileReader f;
+	string buf;
+	OpenFile(name, f, buf, mode);
+	return qmsh_loader->Load(name, f, true);
+}
+
+Mesh* ResourceManager::GetMeshAsync(ResourceId id, Priority priority)
+{
+	return (Mesh*)GetAsync(id, Resource::Type::Mesh, priority);
+}
+
+Sound* ResourceManager::GetSoundAsync(ResourceId id, Priority priority)
+{
+	return (Sound*)GetAsync(id, Resource::Type::Sound, priority);
+}
+
+Texture* ResourceManager::GetTextureAsync(ResourceId id, Priority priority)
+{
+	return (Texture*)GetAsync(id, Resource::Type::Texture, priority);
+}
+
+// can be called from worker thread (mesh requests textures)
+Resource* ResourceManager::GetAsync(ResourceId id, Resource::Type type, Priority priority)
+{
+	assert(id != 0);
+
+	Resource* res;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		res = Find(id);
+		if(res)
+		{
+			if(res->type != type)
+				throw Format("Resource '%s' type mismatch.", res->name.c_str());
+			return res;
+		}
+
+		cstring name = NameTable::GetName(id);
+
+		switch(type)
+		{
+		case Resource::Type::Mesh:
+			res = new Mesh(name);
+			break;
+		case Resource::Type::Sound:
+			res = new Sound(name, nullptr);
+			break;
+		case Resource::Type::Texture:
+		default:
+			assert(type == Resource::Type::Texture);
+			res = new Texture(name, nullptr);
+			break;
+		}
+		res->state = Resource::State::Loading;
+		Insert(res);
+
+		Request* request = new Request;
+		request->res = res;
+		request->priority = priority;
+		request->index = request_index++;
+		requests.push_back(request);
+		std::push_heap(requests.begin(), requests.end(), RequestComparer());
+		++pending;
+	}
+
+	// each job loads request with highest priority at the time it starts, io is low priority so frame jobs never wait for it
+	thread_pool->SubmitLowPriority(delegate<void()>(this, &ResourceManager::LoadWorker), &counter);
+	return res;
+}
+
+// read & decode resource on worker thread, request could be already taken by Wait
+void ResourceManager::LoadWorker()
+{
+	Request* request;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(requests.empty())
+			return;
+		std::pop_heap(requests.begin(), requests.end(), RequestComparer());
+		request = requests.back();
+		requests.pop_back();
+	}
+	Load(*request);
+}
+
+void ResourceManager::Load(Request& request)
+{
+	Resource* res = request.res;
+	cstring name = res->name.c_str();
+	try
+	{
+		if(res->type == Resource::Type::Mesh)
+		{
+			FileReader f;
+			OpenFile(name, f, request.data);
+			QmshLoader loader(this, request.priority);
+			loader.Load(*(Mesh*)res, f, true);
+		}
+		else
+		{
+			if(!ReadFromArchives(name, request.data) && !io::LoadFileToString(Format("Data/%s", name), request.data))
+				throw Format("Failed to read file 'Data/%s'.", name);
+			if(res->type == Resource::Type::Texture && tex_loader)
+			{
+				request.tex_data.reset(new TextureData);
+				tex_loader->Decode(*(Texture*)res, (const byte*)request.data.data(), request.data.size(), *request.tex_data);
+				string().swap(request.data);
+			}
+		}
+	}
+	catch(cstring err)
+	{
+		request.error = err;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	loaded.push_back(&request);
+}
+
+// finish loading on main thread, create gpu buffers, textures & sounds
+void ResourceManager::Finish(Request& request)
+{
+	Resource* res = request.res;
+	if(request.error.empty())
+	{
+		try
+		{
+			switch(res->type)
+			{
+			case Resource::Type::Mesh:
+				qmsh_loader->Upload(*(Mesh*)res);
+				break;
+			case Resource::Type::Sound:
+				if(sound_loader)
+					sound_loader->LoadFromMemory(*(Sound*)res, request.data);
+				break;
+			case Resource::Type::Texture:
+				if(tex_loader)
+					tex_loader->Create(*(Texture*)res, *request.tex_data);
+				break;
+			default:
+				assert(0);
+				break;
+			}
+		}
+		catch(cstring err)
+		{
+			request.error = err;
+		}
+	}
+
+	res->state = (request.error.empty() ? Resource::State::Ready : Resource::State::Failed);
+	--pending;
+}
+
+void ResourceManager::Update()
+{
+	string error;
+	if(pending != 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			finished.swap(loaded);
+		}
+
+		for(Request* request : finished)
+		{
+			Finish(*request);
+			if(error.empty())
+				error = request->error;
+			delete request;
+		}
+		finished.clear();
+	}
+
+	// also for resources finished in Wait by sync getters
+	for(uint i = 0; i < callbacks.size();)
+	{
+		if(callbacks[i].first->state == Resource::State::Loading)
+		{
+			++i;
+			continue;
+		}
+		auto callback = callbacks[i];
+		callbacks.erase(callbacks.begin() + i);
+		callback.second(callback.first);
+	}
+
+	if(!error.empty())
+		throw Format("%s", error.c_str());
+}
+
+void ResourceManager::OnLoaded(Resource* res, delegate<void(Resource*)> callback)
+{
+	assert(res && callback);
+	if(res->state == Resource::State::Loading)
+		callbacks.push_back(std::make_pair(res, callback));
+	else
+		callback(res);
+}
+
+// load resource on main thread if it wasn't started yet, other loaded requests are left for Update
+void ResourceManager::Wait(Resource* res)
+{
+	Request* request = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = std::find_if(requests.begin(), requests.end(), [res](Request* r) { return r->res == res; });
+		if(it != requests.end())
+		{
+			request = *it;
+			requests.erase(it);
+			std::make_heap(requests.begin(), requests.end(), RequestComparer());
+		}
+	}
+	if(request)
+		Load(*request);
+
+	while(true)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = std::find_if(loaded.begin(), loaded.end(), [res](Request* r) { return r->res == res; });
+			if(it != loaded.end())
+			{
+				request = *it;
+				loaded.erase(it);
+				break;
+			}
+		}
+		// worker is loading it
+		std::this_thread::yield();
+	}
+
+	Finish(*request);
+	string error = std::move(request->error);
+	delete request;
+	if(!error.empty())
+		throw Format("%s", error.c_str());
+}
+
+// main thread helps loading remaining requests
+void ResourceManager::WaitForAll()
+{
+	while(pending != 0)
+	{
+		LoadWorker();
+		Update();
+		if(pending != 0)
+			std::this_thread::yield();
+	}
+	// remaining jobs have nothing to load
+	thread_pool->Wait(counter);
+}
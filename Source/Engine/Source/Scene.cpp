@@ -15,30 +15,22 @@
 #include "DebugDrawer.h"
 
 
-struct ScenePartFactory : QuadTree::Factory
-{
-	QuadTree::Part* Create() override
-	{
-		return new ScenePart;
-	}
-
-	void Remove(QuadTree::Part* part) override
-	{
-		delete (ScenePart*)part;
-	}
-} scene_part_factory;
-
-
 Scene::Scene() : fog_color(Color::White), fog_params(1000, 2000, 1000), skybox(nullptr), sky(nullptr), light_dir(0, 1, 0), light_color(1, 1, 1),
-ambient_color(1, 1, 1), debug_draw_enabled(false)
+ambient_color(1, 1, 1), frame(0), debug_draw_enabled(false)
 {
 	camera.reset(new Camera);
+	cells.resize(1);
+	anim_lod_dist[0] = 20.f;
+	anim_lod_dist[1] = 40.f;
+	anim_stats = {};
 }
 
 Scene::~Scene()
 {
 	DeleteElements(nodes);
 	ParticleEmitter::Free(pes);
+	for(ScenePart& part : parts)
+		part.Reset();
 	DeleteElements(mesh_inst_pool);
 	delete sky;
 }
@@ -67,27 +59,33 @@ void Scene::Init(Render* render, ResourceManager* res_mgr)
 void Scene::Reset()
 {
 	DeleteElements(nodes);
+	for(vector<SceneNode*>& cell : cells)
+		cell.clear();
 	ParticleEmitter::Free(pes);
-	if(quad_tree)
-	{
-		quad_tree->ForEach([](QuadTree::Part* part)
-		{
-			ScenePart* scene_part = (ScenePart*)part;
-			scene_part->Reset();
-		});
-	}
+	for(ScenePart& part : parts)
+		part.Reset();
 }
 
-void Scene::Draw()
+// list visible nodes & fill render queues, don't require render so can be used in headless mode
+// queues & camera matrices are snapshot of scene, drawing nodes don't use scene nodes so simulation can run at same time
+void Scene::Prepare()
 {
 	mat_view_proj = camera->GetMatrix(&mat_view);
+	cam_pos = camera->from;
+	lighting = { fog_color, fog_params, light_dir, light_color, ambient_color };
 	frustum_planes.Set(mat_view_proj);
+	++frame;
+	anim_stats = {};
 	ListVisibleNodes();
-	DrawSkybox();
-	DrawNodes();
-	DrawParticles();
-	if(debug_draw_enabled)
-		debug_drawer->Draw(mat_view, mat_view_proj, camera->from, debug_draw_handler);
+
+	queue.Clear();
+	QueueNodes(visible_nodes, queue);
+	queue.Build();
+
+	// alpha nodes keep order
+	alpha_queue.Clear();
+	QueueNodes(visible_alpha_nodes, alpha_queue);
+	alpha_queue.Build(false);
 }
 
 void Scene::DrawSkybox()
@@ -95,7 +93,7 @@ void Scene::DrawSkybox()
 	if(!skybox && !sky)
 		return;
 
-	Matrix mat_combined = Matrix::Translation(camera->from) * mat_view_proj;
+	Matrix mat_combined = Matrix::Translation(cam_pos) * mat_view_proj;
 
 	if(skybox)
 		skybox_shader->Draw(skybox, mat_combined);
@@ -108,56 +106,78 @@ void Scene::DrawNodes()
 	render->SetAlphaBlend(Render::BLEND_NO);
 	render->SetDepthState(Render::DEPTH_YES);
 	render->SetCulling(true);
-	mesh_shader->Prepare(fog_color, fog_params, light_dir, light_color, ambient_color);
+	mesh_shader->Prepare(lighting.fog_color, lighting.fog_params, lighting.light_dir, lighting.light_color, lighting.ambient_color,
+		mat_view_proj);
 
-	DrawNodes(visible_nodes, nullptr);
+	mesh_shader->Draw(queue);
 
-	if(!visible_alpha_nodes.empty())
+	if(!alpha_queue.GetBatches().empty())
 	{
 		render->SetAlphaBlend(Render::BLEND_NORMAL);
 		render->SetDepthState(Render::DEPTH_READONLY);
-		DrawNodes(visible_alpha_nodes, nullptr);
+		mesh_shader->Draw(alpha_queue);
 	}
 }
 
-void Scene::DrawNodes(vector<SceneNode*>& nodes, const Matrix* parent_matrix)
+void Scene::QueueNodes(vector<SceneNode*>& nodes, RenderQueue& queue)
 {
-	Matrix mat_world, mat_combined;
-
 	for(SceneNode* node : nodes)
 	{
-		if(node->parent_point && node->parent_point != SceneNode::USE_PARENT_BONES)
-		{
-			assert(node->parent && parent_matrix);
-			Mesh::Point* point = (Mesh::Point*)node->parent_point;
-			mat_world = point->mat
-				* node->parent->mesh_inst->GetMatrixBones().at(point->bone)
-				* (*parent_matrix);
-		}
-		else
-		{
-			// convert right handed rotation to left handed
-			if(node->use_matrix)
-				mat_world = node->mat;
-			else
-				mat_world = Matrix::Scale(node->scale)
-					* Matrix::Rotation(-node->rot.y, node->rot.x, node->rot.z)
-					* Matrix::Translation(node->pos);
-			if(parent_matrix)
-				mat_world *= (*parent_matrix);
-		}
-		mat_combined = mat_world * mat_view_proj;
+		node->UpdateTransform();
 
 		if(node->visible)
-			mesh_shader->DrawMesh(node->mesh, node->GetMeshInstance(), mat_combined, mat_world, node->tint, node->subs);
+		{
+			MeshInstance* mesh_inst = node->GetMeshInstance();
+			if(mesh_inst)
+				SetupBones(mesh_inst, node->sphere_center);
+			queue.Add(node);
+		}
 
 		if(!node->childs.empty())
-			DrawNodes(node->childs, &mat_world);
+			QueueNodes(node->childs, queue);
 	}
 }
 
+RenderQueue::Stats Scene::GetRenderStats()
+{
+	const RenderQueue::Stats& s1 = queue.GetStats(),
+		&s2 = alpha_queue.GetStats();
+	RenderQueue::Stats stats;
+	stats.nodes = s1.nodes + s2.nodes;
+	stats.batches = s1.batches + s2.batches;
+	stats.draw_calls = s1.draw_calls + s2.draw_calls;
+	stats.state_changes = s1.state_changes + s2.state_changes;
+	stats.unsorted_draw_calls = s1.unsorted_draw_calls + s2.unsorted_draw_calls;
+	stats.unsorted_state_changes = s1.unsorted_state_changes + s2.unsorted_state_changes;
+	return stats;
+}
+
+// update bones of visible node, distant nodes are updated less often (not visible nodes only advance animation time in Update)
+void Scene::SetupBones(MeshInstance* mesh_inst, const Vec3& pos)
+{
+	const float dist = Vec3::Distance(cam_pos, pos);
+	ANIM_LOD lod;
+	if(dist < anim_lod_dist[0])
+		lod = ANIM_LOD_FULL;
+	else if(dist < anim_lod_dist[1])
+		lod = ANIM_LOD_HALF;
+	else
+		lod = ANIM_LOD_QUARTER;
+	if(mesh_inst->SetupBones(lod, frame))
+		++anim_stats.updated[lod];
+	else
+		++anim_stats.skipped;
+}
+
+// particles are listed when drawing (not in Prepare), must be called when simulation is not running
 void Scene::DrawParticles()
 {
+	visible_pes.clear();
+	for(ParticleEmitter* pe : pes)
+	{
+		if(frustum_planes.SphereToFrustum(pe->pos, pe->radius))
+			visible_pes.push_back(pe);
+	}
 	if(visible_pes.empty())
 		return;
 
@@ -169,10 +189,27 @@ void Scene::DrawParticles()
 	}
 }
 
+void Scene::DrawDebug()
+{
+	if(debug_draw_enabled)
+		debug_drawer->Draw(mat_view, mat_view_proj, cam_pos, debug_draw_handler);
+}
+
 void Scene::Update(float dt)
 {
 	UpdateNodes(nodes, dt);
 
+	// move nodes between loose quadtree cells
+	for(SceneNode* node : nodes)
+	{
+		const uint cell = GetCell(node);
+		if(cell != node->cell)
+		{
+			RemoveFromCell(node);
+			AddToCell(node, cell);
+		}
+	}
+
 	LoopRemove(pes, [&](ParticleEmitter* pe)
 	{
 		if(!pe->Update(dt))
@@ -199,7 +236,9 @@ void Scene::Add(SceneNode* node)
 {
 	// not null, have mesh or is container, don't have parent
 	assert(node && (node->mesh || node->container) && !node->parent);
+	node->scene_index = nodes.size();
 	nodes.push_back(node);
+	AddToCell(node, GetCell(node));
 }
 
 void Scene::Add(ParticleEmitter* pe)
@@ -211,8 +250,70 @@ void Scene::Add(ParticleEmitter* pe)
 
 void Scene::Remove(SceneNode* node)
 {
-	assert(node);
-	DeleteElement(nodes, node);
+	assert(node && node->scene_index < nodes.size() && nodes[node->scene_index] == node);
+	RemoveFromCell(node);
+	SceneNode* last = nodes.back();
+	nodes[node->scene_index] = last;
+	last->scene_index = node->scene_index;
+	nodes.pop_back();
+	delete node;
+}
+
+// cell of loose quadtree for node, nodes that don't fit are in last cell
+uint Scene::GetCell(SceneNode* node)
+{
+	const uint outside = cells.size() - 1;
+	if(!dynamic_tree)
+		return outside;
+
+	Vec3 center;
+	float radius;
+	if(node->container)
+	{
+		if(node->container->is_sphere)
+		{
+			center = node->pos;
+			radius = node->container->radius;
+		}
+		else
+		{
+			center = node->container->box.Midpoint();
+			radius = node->container->box.Size().Length() / 2;
+		}
+	}
+	else if(node->use_matrix)
+	{
+		center = Vec3::TransformZero(node->mat);
+		radius = node->mesh->head.radius;
+	}
+	else
+	{
+		center = node->pos;
+		radius = node->mesh->head.radius * node->scale;
+	}
+
+	if(center.y < QuadTree::MIN_Y || center.y > QuadTree::MAX_Y)
+		return outside;
+	const uint id = dynamic_tree->GetLooseNodeId(center.XZ(), radius);
+	return id == QuadTree::INVALID_NODE ? outside : id;
+}
+
+void Scene::AddToCell(SceneNode* node, uint cell)
+{
+	vector<SceneNode*>& nodes = cells[cell];
+	node->cell = cell;
+	node->cell_index = nodes.size();
+	nodes.push_back(node);
+}
+
+void Scene::RemoveFromCell(SceneNode* node)
+{
+	vector<SceneNode*>& nodes = cells[node->cell];
+	assert(node->cell_index < nodes.size() && nodes[node->cell_index] == node);
+	SceneNode* last = nodes.back();
+	nodes[node->cell_index] = last;
+	last->cell_index = node->cell_index;
+	nodes.pop_back();
 }
 
 void Scene::SetFogParams(float start, float end)
@@ -227,22 +328,27 @@ void Scene::ListVisibleNodes()
 {
 	visible_nodes.clear();
 	visible_alpha_nodes.clear();
-	visible_pes.clear();
-
-	ListVisibleNodes(nodes);
 
-	for(ParticleEmitter* pe : pes)
+	// dynamic nodes
+	ListVisibleNodes(cells.back());
+	if(dynamic_tree)
 	{
-		if(frustum_planes.SphereToFrustum(pe->pos, pe->radius))
-			visible_pes.push_back(pe);
+		dynamic_tree->ListVisibleLooseNodes(frustum_planes, visible_ranges);
+		for(const QuadTree::Range& range : visible_ranges)
+		{
+			for(uint i = range.start; i < range.end; ++i)
+				ListVisibleNodes(cells[QuadTree::GetNodeId(range.level, i)]);
+		}
 	}
 
 	if(quad_tree)
 	{
-		quad_tree->ListVisibleParts(frustum_planes, (vector<QuadTree::Part*>&)parts);
-
-		for(ScenePart* part : parts)
-			ListVisibleNodes(part->nodes);
+		quad_tree->ListVisibleLeafs(frustum_planes, visible_ranges);
+		for(const QuadTree::Range& range : visible_ranges)
+		{
+			for(uint i = range.start; i < range.end; ++i)
+				ListVisibleNodes(parts[i].nodes);
+		}
 	}
 }
 
@@ -265,20 +371,8 @@ void Scene::ListVisibleNodes(vector<SceneNode*>& nodes)
 		}
 		else
 		{
-			bool ok = false;
-			if(node->use_matrix)
-			{
-				Vec3 center = Vec3::TransformZero(node->mat);
-				if(frustum_planes.SphereToFrustum(center, node->mesh->head.radius))
-					ok = true;
-			}
-			else
-			{
-				if(frustum_planes.SphereToFrustum(node->pos, node->mesh->head.radius * node->scale))
-					ok = true;
-			}
-
-			if(ok)
+			node->UpdateTransform();
+			if(frustum_planes.SphereToFrustum(node->sphere_center, node->sphere_radius))
 			{
 				if(node->alpha)
 					visible_alpha_nodes.push_back(node);
@@ -295,7 +389,25 @@ void Scene::InitQuadTree(float size, uint splits)
 		return;
 
 	quad_tree.reset(new QuadTree);
-	quad_tree->Init(size, splits, &scene_part_factory);
+	quad_tree->Init(size, splits);
+	parts.resize(quad_tree->GetLeafsCount());
+
+	// loose quadtree for dynamic nodes, smallest cells are ~16 meters
+	uint dynamic_splits = 1;
+	while(size / (1u << dynamic_splits) > 16.f && dynamic_splits < QuadTree::MAX_SPLITS)
+		++dynamic_splits;
+	dynamic_tree.reset(new QuadTree);
+	dynamic_tree->Init(size, dynamic_splits);
+	cells.clear();
+	cells.resize(dynamic_tree->GetNodesCount() + 1);
+	for(SceneNode* node : nodes)
+		AddToCell(node, GetCell(node));
+}
+
+ScenePart* Scene::GetPart(const Int2& pt)
+{
+	assert(quad_tree);
+	return &parts[quad_tree->GetLeafIndex(pt)];
 }
 
 void Scene::RecycleMeshInstance(SceneNode* node)
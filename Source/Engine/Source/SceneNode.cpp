@@ -35,6 +35,52 @@ void SceneNode::SetParentPoint(MeshPoint* point)
 	parent_point = pt;
 }
 
+// update cached world matrix & bounding sphere, returns true if changed
+// container don't affect childs transform
+bool SceneNode::UpdateTransform()
+{
+	SceneNode* transform_parent = (parent && !parent->container) ? parent : nullptr;
+	if(parent_point && parent_point != USE_PARENT_BONES)
+	{
+		// attached to bone, changes with parent animation
+		assert(transform_parent);
+		Mesh::Point* point = (Mesh::Point*)parent_point;
+		mat_world = point->mat
+			* parent->mesh_inst->GetMatrixBones().at(point->bone)
+			* transform_parent->mat_world;
+	}
+	else
+	{
+		const uint size = (use_matrix ? sizeof(Matrix) : sizeof(Vec3) * 2 + sizeof(float));
+		if(version != 0
+			&& (!transform_parent || transform_parent->version == parent_version)
+			&& (is_static || memcmp(&mat, &prev_transform, size) == 0))
+			return false;
+		memcpy(&prev_transform, &mat, size);
+
+		// convert right handed rotation to left handed
+		if(use_matrix)
+			mat_world = mat;
+		else
+			mat_world = Matrix::Scale(scale) * Matrix::Rotation(-rot.y, rot.x, rot.z) * Matrix::Translation(pos);
+		if(transform_parent)
+			mat_world *= transform_parent->mat_world;
+	}
+
+	if(transform_parent)
+		parent_version = transform_parent->version;
+	++version;
+	if(version == 0)
+		version = 1;
+
+	if(mesh)
+	{
+		sphere_center = Vec3::TransformZero(mat_world);
+		sphere_radius = mesh->head.radius * (use_matrix ? 1.f : scale);
+	}
+	return true;
+}
+
 MeshInstance* SceneNode::GetMeshInstance()
 {
 	if(mesh_inst)
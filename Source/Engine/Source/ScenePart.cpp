@@ -2,14 +2,10 @@
 #include "ScenePart.h"
 #include "SceneNode.h"
 
-ScenePart::~ScenePart()
-{
-	DeleteElements(nodes);
-}
-
 void ScenePart::Add(SceneNode* node)
 {
 	assert(node);
+	node->is_static = true; // nodes in scene parts never move
 	nodes.push_back(node);
 }
 
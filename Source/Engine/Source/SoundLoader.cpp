@@ -33,3 +33,33 @@ FMOD::Sound* SoundLoader::Load(cstring path, bool is_music)
 		throw Format("Failed to load %s '%s' (%d).", is_music ? "music" : "sound", path, result);
 	return sound;
 }
+
+// stream is created from file content, data is moved to sound because stream reads from it
+void SoundLoader::LoadFromMemory(Music& music, string& data)
+{
+	music.snd = LoadFromMemory(music.name.c_str(), data, true);
+	music.data.swap(data);
+}
+
+void SoundLoader::LoadFromMemory(Sound& sound, string& data)
+{
+	sound.snd = LoadFromMemory(sound.name.c_str(), data, false);
+	sound.data.swap(data);
+}
+
+FMOD::Sound* SoundLoader::LoadFromMemory(cstring name, const string& data, bool is_music)
+{
+	FMOD_CREATESOUNDEXINFO info = {};
+	info.cbsize = sizeof(info);
+	info.length = data.size();
+	int flags = FMOD_HARDWARE | FMOD_LOWMEM | FMOD_OPENMEMORY;
+	if(is_music)
+		flags |= FMOD_2D | FMOD_LOOP_NORMAL;
+	else
+		flags |= FMOD_3D;
+	FMOD::Sound* sound;
+	FMOD_RESULT result = system->createStream(data.data(), flags, &info, &sound);
+	if(result != FMOD_OK)
+		throw Format("Failed to load %s '%s' (%d).", is_music ? "music" : "sound", name, result);
+	return sound;
+}
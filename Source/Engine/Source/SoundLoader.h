@@ -6,9 +6,12 @@ public:
 	SoundLoader(SoundManager* sound_mgr);
 	Music* LoadMusic(cstring name, cstring path);
 	Sound* LoadSound(cstring name, cstring path);
+	void LoadFromMemory(Music& music, string& data);
+	void LoadFromMemory(Sound& sound, string& data);
 
 private:
 	FMOD::Sound* Load(cstring path, bool is_music);
+	FMOD::Sound* LoadFromMemory(cstring name, const string& data, bool is_music);
 
 	FMOD::System* system;
 };
@@ -93,7 +93,7 @@ void SoundManager::PlayMusic(Music* music)
 void SoundManager::PlaySound2d(Sound* sound)
 {
 	assert(sound);
-	if(!play_sound)
+	if(!play_sound || !sound->snd)
 		return;
 
 	FMOD::Channel* channel;
@@ -106,7 +106,7 @@ void SoundManager::PlaySound2d(Sound* sound)
 void SoundManager::PlaySound3d(Sound* sound, const Vec3& pos, float smin)
 {
 	assert(sound);
-	if(!play_sound)
+	if(!play_sound || !sound->snd)
 		return;
 
 	FMOD::Channel* channel;
@@ -3,8 +3,9 @@
 
 static const uint FORMAT_STRINGS = 8;
 static const uint FORMAT_LENGTH = 2048;
-static char format_buf[FORMAT_STRINGS][FORMAT_LENGTH];
-static int format_marker;
+// per thread, Format is used by worker threads
+static thread_local char format_buf[FORMAT_STRINGS][FORMAT_LENGTH];
+static thread_local int format_marker;
 static char escape_from[] = { '\n', '\t', '\r', ' ' };
 static cstring escape_to[] = { "\\n", "\\t", "\\r", " " };
 
@@ -1,7 +1,7 @@
 #include "EngineCore.h"
 #include "TextureLoader.h"
-#include "WICTextureLoader.h"
 #include "Texture.h"
+#include <objbase.h>
 
 TextureLoader::TextureLoader(ID3D11Device* device, ID3D11DeviceContext* device_context) : device(device), device_context(device_context)
 {
@@ -17,3 +17,33 @@ Texture* TextureLoader::Load(cstring name, cstring path)
 		throw Format("Failed to load texture '%s' (%u).", path, result);
 	return new Texture(name, view);
 }
+
+// WIC needs COM initialized on each thread that decodes textures
+struct ComInit
+{
+	ComInit() : result(CoInitializeEx(nullptr, COINIT_MULTITHREADED)) {}
+	~ComInit()
+	{
+		if(SUCCEEDED(result))
+			CoUninitialize();
+	}
+	HRESULT result;
+};
+
+// can be called from worker thread, device is only used to check supported formats
+void TextureLoader::Decode(Texture& tex, const byte* data, uint size, TextureData& tex_data)
+{
+	static thread_local ComInit com_init;
+	HRESULT result = DecodeWICImageFromMemory(device, data, size, 0, true, WIC_LOADER_DEFAULT, tex_data.image);
+	if(FAILED(result))
+		throw Format("Failed to decode texture '%s' (%u).", tex.name.c_str(), result);
+}
+
+// create gpu texture & generate mipmaps, must be called on main thread
+void TextureLoader::Create(Texture& tex, const TextureData& tex_data)
+{
+	HRESULT result = CreateWICTextureFromImage(device, device_context, tex_data.image, D3D11_USAGE_DEFAULT, D3D11_BIND_SHADER_RESOURCE,
+		0, 0, nullptr, &tex.tex);
+	if(FAILED(result))
+		throw Format("Failed to create texture '%s' (%u).", tex.name.c_str(), result);
+}
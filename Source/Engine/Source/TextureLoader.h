@@ -1,10 +1,20 @@
 #pragma once
 
+#include "WICTextureLoader.h"
+
+// texture decoded on worker thread, gpu texture is created from it on main thread
+struct TextureData
+{
+	DirectX::WICImage image;
+};
+
 class TextureLoader
 {
 public:
 	TextureLoader(ID3D11Device* device, ID3D11DeviceContext* device_context);
 	Texture* Load(cstring name, cstring path);
+	void Decode(Texture& tex, const byte* data, uint size, TextureData& tex_data);
+	void Create(Texture& tex, const TextureData& tex_data);
 
 private:
 	ID3D11Device* device;
@@ -0,0 +1,340 @@
+#include "EngineCore.h"
+#include "ThreadPool.h"
+
+thread_local uint ThreadPool::thread_index = 0;
+
+ThreadPool::ThreadPool() : queues_count(0), max_low_running(0), queued(0), low_queued(0), low_running(0), jobs_count(0), stolen_count(0), used_frame_counters(0), quit(false)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+	Shutdown();
+	DeleteElements(frame_counters);
+}
+
+// threads_count - number of worker threads, 0 for one per core (without main thread)
+void ThreadPool::Init(uint threads_count)
+{
+	assert(threads.empty());
+	if(threads_count == 0)
+	{
+		uint cores = std::thread::hardware_concurrency();
+		threads_count = cores > 1 ? cores - 1 : 0;
+	}
+
+	quit = false;
+	queues_count = threads_count + 1;
+	max_low_running = max(1u, threads_count / 2);
+	queues.reset(new Queue[queues_count]);
+	threads.reserve(threads_count);
+	for(uint i = 0; i < threads_count; ++i)
+		threads.push_back(std::thread(&ThreadPool::ThreadLoop, this, i + 1));
+
+	Info("ThreadPool: Started %u worker threads.", threads_count);
+}
+
+void ThreadPool::Shutdown()
+{
+	if(threads.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	cv_work.notify_all();
+	for(std::thread& thread : threads)
+		thread.join();
+	threads.clear();
+}
+
+void ThreadPool::Submit(delegate<void()> action, Counter* counter, Counter* dependency)
+{
+	assert(action);
+	Job job;
+	job.action = action;
+	job.start = 0;
+	job.end = 0;
+	job.counter = counter;
+	if(counter)
+		++counter->value;
+	AddJob(job, dependency);
+	Notify(false);
+}
+
+void ThreadPool::SubmitFor(uint count, delegate<void(uint)> action, Counter* counter, Counter* dependency, uint chunk)
+{
+	assert(action);
+	if(count == 0)
+		return;
+	if(chunk == 0)
+		chunk = GetChunkSize(count);
+
+	Job job;
+	job.for_action = action;
+	job.counter = counter;
+	if(counter)
+		counter->value += (count + chunk - 1) / chunk;
+	for(uint start = 0; start < count; start += chunk)
+	{
+		job.start = start;
+		job.end = min(start + chunk, count);
+		AddJob(job, dependency);
+	}
+	Notify(true);
+}
+
+void ThreadPool::SubmitLowPriority(delegate<void()> action, Counter* counter)
+{
+	assert(action);
+	Job job;
+	job.action = action;
+	job.start = 0;
+	job.end = 0;
+	job.counter = counter;
+	if(counter)
+		++counter->value;
+	PushLowPriority(job);
+	Notify(false);
+}
+
+void ThreadPool::SubmitLowPriorityFor(uint count, delegate<void(uint)> action, Counter* counter)
+{
+	assert(action);
+	if(count == 0)
+		return;
+
+	Job job;
+	job.for_action = action;
+	job.counter = counter;
+	if(counter)
+		counter->value += count;
+	for(uint i = 0; i < count; ++i)
+	{
+		job.start = i;
+		job.end = i + 1;
+		PushLowPriority(job);
+	}
+	Notify(true);
+}
+
+// add job to queue or to list of jobs waiting for dependency
+void ThreadPool::AddJob(const Job& job, Counter* dependency)
+{
+	if(dependency)
+	{
+		std::lock_guard<std::mutex> lock(dependency->mutex);
+		if(dependency->value != 0)
+		{
+			dependency->waiting.push_back(job);
+			return;
+		}
+	}
+	Push(job);
+}
+
+void ThreadPool::Push(const Job& job)
+{
+	if(queues_count == 0)
+	{
+		// not initialized, do it now
+		Job copy = job;
+		Execute(copy);
+		return;
+	}
+
+	Queue& queue = queues[GetQueueIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(job);
+	}
+	++queued;
+}
+
+void ThreadPool::PushLowPriority(const Job& job)
+{
+	if(threads.empty())
+	{
+		// no workers, do it now
+		Job copy = job;
+		Execute(copy);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(low_queue.mutex);
+		low_queue.jobs.push_back(job);
+	}
+	++low_queued;
+}
+
+void ThreadPool::Notify(bool all)
+{
+	if(threads.empty())
+		return;
+	// lock to not miss worker that is going to sleep
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+	}
+	if(all)
+		cv_work.notify_all();
+	else
+		cv_work.notify_one();
+}
+
+void ThreadPool::Wait(Counter& counter)
+{
+	while(counter.value != 0)
+	{
+		if(!TryExecute())
+			std::this_thread::yield();
+	}
+	// thread that finished last job can still hold lock
+	std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void ThreadPool::ParallelFor(uint count, delegate<void(uint)> action)
+{
+	if(count == 0)
+		return;
+
+	if(threads.empty() || count == 1)
+	{
+		for(uint i = 0; i < count; ++i)
+			action(i);
+		return;
+	}
+
+	Counter counter;
+	SubmitFor(count, action, &counter);
+	Wait(counter);
+}
+
+ThreadPool::Counter* ThreadPool::GetFrameCounter()
+{
+	if(used_frame_counters == frame_counters.size())
+		frame_counters.push_back(new Counter);
+	return frame_counters[used_frame_counters++];
+}
+
+void ThreadPool::EndFrame()
+{
+	for(uint i = 0; i < used_frame_counters; ++i)
+		Wait(*frame_counters[i]);
+	used_frame_counters = 0;
+}
+
+void ThreadPool::ResetStats()
+{
+	jobs_count = 0;
+	stolen_count = 0;
+}
+
+void ThreadPool::ThreadLoop(uint index)
+{
+	thread_index = index;
+	while(true)
+	{
+		if(TryExecute() || TryExecuteLowPriority())
+			continue;
+
+		std::unique_lock<std::mutex> lock(mutex);
+		cv_work.wait(lock, [this] { return quit || queued != 0 || (low_queued != 0 && low_running < max_low_running); });
+		if(quit)
+			return;
+	}
+}
+
+// take job from own queue or steal from other thread
+bool ThreadPool::TryExecute()
+{
+	if(queued == 0)
+		return false;
+
+	const uint self = GetQueueIndex();
+	Job job;
+	bool found = false;
+	{
+		Queue& queue = queues[self];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if(!queue.jobs.empty())
+		{
+			job = queue.jobs.back();
+			queue.jobs.pop_back();
+			found = true;
+		}
+	}
+
+	if(!found)
+	{
+		for(uint i = 1; i < queues_count && !found; ++i)
+		{
+			Queue& queue = queues[(self + i) % queues_count];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if(!queue.jobs.empty())
+			{
+				job = queue.jobs.front();
+				queue.jobs.pop_front();
+				found = true;
+			}
+		}
+		if(!found)
+			return false;
+		++stolen_count;
+	}
+
+	--queued;
+	Execute(job);
+	return true;
+}
+
+// take job from low priority queue, called only by workers when there is no other work
+bool ThreadPool::TryExecuteLowPriority()
+{
+	if(low_queued == 0 || low_running >= max_low_running)
+		return false;
+
+	Job job;
+	{
+		std::lock_guard<std::mutex> lock(low_queue.mutex);
+		if(low_queue.jobs.empty() || low_running >= max_low_running)
+			return false;
+		job = low_queue.jobs.front();
+		low_queue.jobs.pop_front();
+		++low_running;
+	}
+
+	--low_queued;
+	Execute(job);
+	--low_running;
+	return true;
+}
+
+void ThreadPool::Execute(Job& job)
+{
+	if(job.for_action)
+	{
+		for(uint i = job.start; i < job.end; ++i)
+			job.for_action(i);
+	}
+	else
+		job.action();
+	++jobs_count;
+
+	Counter* counter = job.counter;
+	if(!counter)
+		return;
+
+	// start jobs waiting for this counter
+	vector<Job> ready;
+	{
+		std::lock_guard<std::mutex> lock(counter->mutex);
+		if(--counter->value == 0)
+			ready.swap(counter->waiting);
+	}
+	for(Job& ready_job : ready)
+		Push(ready_job);
+	if(!ready.empty())
+		Notify(true);
+}
@@ -292,17 +292,12 @@ namespace
 
 
 	//---------------------------------------------------------------------------------
-	HRESULT CreateTextureFromWIC(_In_ ID3D11Device* d3dDevice,
-		_In_opt_ ID3D11DeviceContext* d3dContext,
+	HRESULT DecodeFrame(_In_ ID3D11Device* d3dDevice,
+		_In_ bool autogen,
 		_In_ IWICBitmapFrameDecode *frame,
 		_In_ size_t maxsize,
-		_In_ D3D11_USAGE usage,
-		_In_ unsigned int bindFlags,
-		_In_ unsigned int cpuAccessFlags,
-		_In_ unsigned int miscFlags,
 		_In_ unsigned int loadFlags,
-		_Outptr_opt_ ID3D11Resource** texture,
-		_Outptr_opt_ ID3D11ShaderResourceView** textureView)
+		_Out_ WICImage& image)
 	{
 		UINT width, height;
 		HRESULT hr = frame->GetSize(&width, &height);
@@ -419,7 +414,7 @@ namespace
 		}
 
 #if (_WIN32_WINNT >= _WIN32_WINNT_WIN8) || defined(_WIN7_PLATFORM_UPDATE)
-		if((format == DXGI_FORMAT_R32G32B32_FLOAT) && d3dContext != 0 && textureView != 0)
+		if((format == DXGI_FORMAT_R32G32B32_FLOAT) && autogen)
 		{
 			// Special case test for optional device support for autogen mipchains for R32G32B32_FLOAT
 			UINT fmtSupport = 0;
@@ -493,17 +488,24 @@ namespace
 		size_t rowPitch = (twidth * bpp + 7) / 8;
 		size_t imageSize = rowPitch * theight;
 
-		std::unique_ptr<uint8_t[]> temp(new (std::nothrow) uint8_t[imageSize]);
+		image.pixels.reset(new (std::nothrow) uint8_t[imageSize]);
+		uint8_t* temp = image.pixels.get();
 		if(!temp)
 			return E_OUTOFMEMORY;
 
+		image.width = twidth;
+		image.height = theight;
+		image.rowPitch = rowPitch;
+		image.imageSize = imageSize;
+		image.format = format;
+
 		// Load image data
 		if(memcmp(&convertGUID, &pixelFormat, sizeof(GUID)) == 0
 			&& twidth == width
 			&& theight == height)
 		{
 			// No format conversion or resize needed
-			hr = frame->CopyPixels(0, static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize), temp.get());
+			hr = frame->CopyPixels(0, static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize), temp);
 			if(FAILED(hr))
 				return hr;
 		}
@@ -531,7 +533,7 @@ namespace
 			if(memcmp(&convertGUID, &pfScaler, sizeof(GUID)) == 0)
 			{
 				// No format conversion needed
-				hr = scaler->CopyPixels(0, static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize), temp.get());
+				hr = scaler->CopyPixels(0, static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize), temp);
 				if(FAILED(hr))
 					return hr;
 			}
@@ -553,7 +555,7 @@ namespace
 				if(FAILED(hr))
 					return hr;
 
-				hr = FC->CopyPixels(0, static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize), temp.get());
+				hr = FC->CopyPixels(0, static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize), temp);
 				if(FAILED(hr))
 					return hr;
 			}
@@ -581,11 +583,31 @@ namespace
 			if(FAILED(hr))
 				return hr;
 
-			hr = FC->CopyPixels(0, static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize), temp.get());
+			hr = FC->CopyPixels(0, static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize), temp);
 			if(FAILED(hr))
 				return hr;
 		}
 
+		return S_OK;
+	}
+
+	//---------------------------------------------------------------------------------
+	HRESULT CreateTextureFromImage(_In_ ID3D11Device* d3dDevice,
+		_In_opt_ ID3D11DeviceContext* d3dContext,
+		_In_ const WICImage& image,
+		_In_ D3D11_USAGE usage,
+		_In_ unsigned int bindFlags,
+		_In_ unsigned int cpuAccessFlags,
+		_In_ unsigned int miscFlags,
+		_Outptr_opt_ ID3D11Resource** texture,
+		_Outptr_opt_ ID3D11ShaderResourceView** textureView)
+	{
+		HRESULT hr;
+		const uint8_t* temp = image.pixels.get();
+		UINT twidth = image.width, theight = image.height;
+		size_t rowPitch = image.rowPitch, imageSize = image.imageSize;
+		DXGI_FORMAT format = image.format;
+
 		// See if format is supported for auto-gen mipmaps (varies by feature level)
 		bool autogen = false;
 		if(d3dContext != 0 && textureView != 0) // Must have context and shader-view to auto generate mipmaps
@@ -622,7 +644,7 @@ namespace
 		}
 
 		D3D11_SUBRESOURCE_DATA initData;
-		initData.pSysMem = temp.get();
+		initData.pSysMem = temp;
 		initData.SysMemPitch = static_cast<UINT>(rowPitch);
 		initData.SysMemSlicePitch = static_cast<UINT>(imageSize);
 
@@ -648,7 +670,7 @@ namespace
 				if(autogen)
 				{
 					assert(d3dContext != 0);
-					d3dContext->UpdateSubresource(tex, 0, nullptr, temp.get(), static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize));
+					d3dContext->UpdateSubresource(tex, 0, nullptr, temp, static_cast<UINT>(rowPitch), static_cast<UINT>(imageSize));
 					d3dContext->GenerateMips(*textureView);
 				}
 			}
@@ -666,6 +688,28 @@ namespace
 
 		return hr;
 	}
+
+	//---------------------------------------------------------------------------------
+	HRESULT CreateTextureFromWIC(_In_ ID3D11Device* d3dDevice,
+		_In_opt_ ID3D11DeviceContext* d3dContext,
+		_In_ IWICBitmapFrameDecode *frame,
+		_In_ size_t maxsize,
+		_In_ D3D11_USAGE usage,
+		_In_ unsigned int bindFlags,
+		_In_ unsigned int cpuAccessFlags,
+		_In_ unsigned int miscFlags,
+		_In_ unsigned int loadFlags,
+		_Outptr_opt_ ID3D11Resource** texture,
+		_Outptr_opt_ ID3D11ShaderResourceView** textureView)
+	{
+		WICImage image;
+		HRESULT hr = DecodeFrame(d3dDevice, d3dContext != 0 && textureView != 0, frame, maxsize, loadFlags, image);
+		if(FAILED(hr))
+			return hr;
+
+		return CreateTextureFromImage(d3dDevice, d3dContext, image, usage, bindFlags, cpuAccessFlags, miscFlags,
+			texture, textureView);
+	}
 } // anonymous namespace
 
   //--------------------------------------------------------------------------------------
@@ -737,7 +781,30 @@ HRESULT DirectX::CreateWICTextureFromMemoryEx(ID3D11Device* d3dDevice,
 		*textureView = nullptr;
 	}
 
-	if(!d3dDevice || !wicData || (!texture && !textureView))
+	if(!texture && !textureView)
+		return E_INVALIDARG;
+
+	WICImage image;
+	HRESULT hr = DecodeWICImageFromMemory(d3dDevice, wicData, wicDataSize, maxsize, d3dContext != 0 && textureView != 0,
+		loadFlags, image);
+	if(FAILED(hr))
+		return hr;
+
+	return CreateWICTextureFromImage(d3dDevice, d3dContext, image, usage, bindFlags, cpuAccessFlags, miscFlags,
+		texture, textureView);
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::DecodeWICImageFromMemory(ID3D11Device* d3dDevice,
+	const uint8_t* wicData,
+	size_t wicDataSize,
+	size_t maxsize,
+	bool autogen,
+	unsigned int loadFlags,
+	WICImage& image)
+{
+	if(!d3dDevice || !wicData)
 		return E_INVALIDARG;
 
 	if(!wicDataSize)
@@ -771,8 +838,34 @@ HRESULT DirectX::CreateWICTextureFromMemoryEx(ID3D11Device* d3dDevice,
 	if(FAILED(hr))
 		return hr;
 
-	hr = CreateTextureFromWIC(d3dDevice, d3dContext, frame.Get(), maxsize,
-		usage, bindFlags, cpuAccessFlags, miscFlags, loadFlags,
+	return DecodeFrame(d3dDevice, autogen, frame.Get(), maxsize, loadFlags, image);
+}
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::CreateWICTextureFromImage(ID3D11Device* d3dDevice,
+	ID3D11DeviceContext* d3dContext,
+	const WICImage& image,
+	D3D11_USAGE usage,
+	unsigned int bindFlags,
+	unsigned int cpuAccessFlags,
+	unsigned int miscFlags,
+	ID3D11Resource** texture,
+	ID3D11ShaderResourceView** textureView)
+{
+	if(texture)
+	{
+		*texture = nullptr;
+	}
+	if(textureView)
+	{
+		*textureView = nullptr;
+	}
+
+	if(!d3dDevice || !image.pixels || (!texture && !textureView))
+		return E_INVALIDARG;
+
+	HRESULT hr = CreateTextureFromImage(d3dDevice, d3dContext, image, usage, bindFlags, cpuAccessFlags, miscFlags,
 		texture, textureView);
 	if(FAILED(hr))
 		return hr;
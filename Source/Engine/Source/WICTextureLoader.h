@@ -28,6 +28,7 @@
 #pragma once
 
 #include <d3d11_1.h>
+#include <memory>
 
 namespace DirectX
 {
@@ -38,6 +39,15 @@ namespace DirectX
 		WIC_LOADER_IGNORE_SRGB = 0x2,
 	};
 
+	// Image decoded to memory, ready for texture creation
+	struct WICImage
+	{
+		std::unique_ptr<uint8_t[]> pixels;
+		UINT width, height;
+		size_t rowPitch, imageSize;
+		DXGI_FORMAT format;
+	};
+
 	// Standard version
 	HRESULT CreateWICTextureFromMemory(
 		_In_ ID3D11Device* d3dDevice,
@@ -125,4 +135,26 @@ namespace DirectX
 		_In_ unsigned int loadFlags,
 		_Outptr_opt_ ID3D11Resource** texture,
 		_Outptr_opt_ ID3D11ShaderResourceView** textureView);
+
+	// Split version, decoding doesn't use d3dContext so it can be done on any thread with COM initialized
+	// (autogen - format will be used with auto-gen mipmaps), only texture creation needs d3dContext
+	HRESULT DecodeWICImageFromMemory(
+		_In_ ID3D11Device* d3dDevice,
+		_In_reads_bytes_(wicDataSize) const uint8_t* wicData,
+		_In_ size_t wicDataSize,
+		_In_ size_t maxsize,
+		_In_ bool autogen,
+		_In_ unsigned int loadFlags,
+		_Out_ WICImage& image);
+
+	HRESULT CreateWICTextureFromImage(
+		_In_ ID3D11Device* d3dDevice,
+		_In_opt_ ID3D11DeviceContext* d3dContext,
+		_In_ const WICImage& image,
+		_In_ D3D11_USAGE usage,
+		_In_ unsigned int bindFlags,
+		_In_ unsigned int cpuAccessFlags,
+		_In_ unsigned int miscFlags,
+		_Outptr_opt_ ID3D11Resource** texture,
+		_Outptr_opt_ ID3D11ShaderResourceView** textureView);
 }
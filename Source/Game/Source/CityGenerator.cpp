@@ -18,18 +18,22 @@ const float ts = CityGenerator::tile_size / 2;
 const float jamb_size = 0.25f;
 const uint NAVMESH_TILES = 32;
 
-CityGenerator::CityGenerator() : navmesh_timer(false)
+CityGenerator::CityGenerator() : navmesh_quit(false), navmesh_timer(false)
 {
 }
 
 CityGenerator::~CityGenerator()
 {
 	DeleteElements(buildings);
+	DeleteElements(navmesh_geoms);
+	ClearFloorChunks();
 }
 
-void CityGenerator::Init(Scene* scene, Level* level, ResourceManager* res_mgr, uint size, uint splits, Navmesh* navmesh)
+void CityGenerator::Init(Scene* scene, Level* level, ResourceManager* res_mgr, ThreadPool* thread_pool, uint size, uint splits,
+	Navmesh* navmesh)
 {
 	this->res_mgr = res_mgr;
+	this->thread_pool = thread_pool;
 	this->scene = scene;
 	this->level = level;
 	this->size = size;
@@ -39,15 +43,15 @@ void CityGenerator::Init(Scene* scene, Level* level, ResourceManager* res_mgr, u
 	map.resize(size * size);
 	map_size = tile_size * size;
 
-	mesh[T_ASPHALT] = res_mgr->GetMesh("buildings/asphalt.qmsh");
-	mesh[T_PAVEMENT] = res_mgr->GetMesh("buildings/brick_pavement.qmsh");
-	mesh[T_BUILDING] = res_mgr->GetMesh("buildings/building_floor.qmsh");
+	mesh[T_ASPHALT] = res_mgr->GetMeshRaw("buildings/asphalt.qmsh");
+	mesh[T_PAVEMENT] = res_mgr->GetMeshRaw("buildings/brick_pavement.qmsh");
+	mesh[T_BUILDING] = res_mgr->GetMeshRaw("buildings/building_floor.qmsh");
 
 	mesh_offset[T_ASPHALT] = 0;
 	mesh_offset[T_PAVEMENT] = floor_y;
 	mesh_offset[T_BUILDING] = floor_y;
 
-	mesh_curb = res_mgr->GetMesh("buildings/curb.qmsh");
+	mesh_curb = res_mgr->GetMeshRaw("buildings/curb.qmsh");
 	mesh_table = res_mgr->GetMesh("objects/table.qmsh");
 
 	mesh_wall = res_mgr->GetMeshRaw("buildings/wall.qmsh");
@@ -57,27 +61,31 @@ void CityGenerator::Init(Scene* scene, Level* level, ResourceManager* res_mgr, u
 	mesh_door_jamb_inner = res_mgr->GetMeshRaw("buildings/door_jamb_inner.qmsh");
 	mesh_ceil = res_mgr->GetMeshRaw("buildings/ceil.qmsh");
 
-	navmesh_thread_state = THREAD_NOT_STARTED;
+	navmesh_geoms.resize(thread_pool->GetThreadsCount());
+	for(LevelGeometry*& geom : navmesh_geoms)
+		geom = new LevelGeometry;
 }
 
 void CityGenerator::Reset()
 {
 	DeleteElements(buildings);
 	scene->Reset();
+	ClearFloorChunks();
 	level->Reset();
 }
 
-void CityGenerator::Generate()
+void CityGenerator::Generate(uint zombies_count)
 {
 	GenerateMap();
 	FillBuildings();
 	BuildBuildingsMesh();
+	BuildFloorChunks();
 	CreateScene();
 	BuildNavmesh();
 	level->SpawnBarriers();
 	level->SpawnPlayer(player_start_pos);
 	SpawnItems();
-	SpawnZombies();
+	SpawnZombies(zombies_count);
 }
 
 void CityGenerator::GenerateMap()
@@ -599,78 +607,85 @@ void CityGenerator::BuildBuildingsMesh()
 	}
 }
 
-void CityGenerator::CreateScene()
+// merge floor tiles & curbs inside each quadtree leaf into single mesh
+void CityGenerator::BuildFloorChunks()
 {
-	Int2 pt, prev_pt = Int2(-1, -1);
-	ScenePart* part = nullptr;
 	QuadTree* quad_tree = scene->GetQuadTree();
-	SceneNode* node;
 	const float tile_size2 = tile_size / 2;
+	const Matrix rot_curb = Matrix::RotationY(-PI / 2); // same as node with rot.y = PI/2
 
-	// floor
+	ClearFloorChunks();
+	floor_chunks.resize(quad_tree->GetLeafsCount());
 	for(uint y = 0; y < size; ++y)
 	{
 		for(uint x = 0; x < size; ++x)
 		{
-			pt = quad_tree->PosToIndex(Vec2(tile_size * x + 1, tile_size * y + 1));
+			const Int2 pt = quad_tree->PosToIndex(Vec2(tile_size * x + 1, tile_size * y + 1));
 			assert(pt != Int2(-1, -1));
-			if(pt != prev_pt)
+			const uint leaf = quad_tree->GetLeafIndex(pt);
+			FloorChunk& chunk = floor_chunks[leaf];
+			if(chunk.builder.vertices.empty())
 			{
-				prev_pt = pt;
-				part = (ScenePart*)quad_tree->GetPart(pt);
+				const Vec2 center = quad_tree->GetLeafBox(leaf).Midpoint();
+				chunk.pt = pt;
+				chunk.pos = Vec3(center.x, 0, center.y);
 			}
+			const Vec3 offset = Vec3(tile_size * x, 0, tile_size * y) - chunk.pos;
 
-			// add floor mesh
+			// floor
 			Tile tile = map[x + y * size];
-			node = new SceneNode;
-			node->pos = Vec3(tile_size * x, mesh_offset[tile], tile_size * y);
-			node->rot = Vec3::Zero;
-			node->mesh = mesh[tile];
-			part->Add(node);
+			chunk.builder.Append(mesh[tile], Matrix::Translation(offset + Vec3(0, mesh_offset[tile], 0)));
 
 			if(tile == T_ASPHALT)
 			{
-				// add curb
+				// curbs
 				if(x > 0 && map[x - 1 + y * size] != T_ASPHALT)
-				{
-					// left
-					node = new SceneNode;
-					node->pos = Vec3(tile_size * x, 0, tile_size * y + tile_size2);
-					node->rot = Vec3::Zero;
-					node->mesh = mesh_curb;
-					part->Add(node);
-				}
+					chunk.builder.Append(mesh_curb, Matrix::Translation(offset + Vec3(0, 0, tile_size2))); // left
 				if(x < size - 1 && map[x + 1 + y * size] != T_ASPHALT)
-				{
-					// right
-					node = new SceneNode;
-					node->pos = Vec3(tile_size * (x + 1), 0, tile_size * y + tile_size2);
-					node->rot = Vec3::Zero;
-					node->mesh = mesh_curb;
-					part->Add(node);
-				}
+					chunk.builder.Append(mesh_curb, Matrix::Translation(offset + Vec3(tile_size, 0, tile_size2))); // right
 				if(y > 0 && map[x + (y - 1) * size] != T_ASPHALT)
-				{
-					// top
-					node = new SceneNode;
-					node->pos = Vec3(tile_size * x + tile_size2, 0, tile_size * y);
-					node->rot = Vec3(0, PI / 2, 0);
-					node->mesh = mesh_curb;
-					part->Add(node);
-				}
+					chunk.builder.Append(mesh_curb, rot_curb * Matrix::Translation(offset + Vec3(tile_size2, 0, 0))); // top
 				if(y < size - 1 && map[x + (y + 1) * size] != T_ASPHALT)
-				{
-					// botom
-					node = new SceneNode;
-					node->pos = Vec3(tile_size * x + tile_size2, 0, tile_size * (y + 1));
-					node->rot = Vec3(0, PI / 2, 0);
-					node->mesh = mesh_curb;
-					part->Add(node);
-				}
+					chunk.builder.Append(mesh_curb, rot_curb * Matrix::Translation(offset + Vec3(tile_size2, 0, tile_size))); // bottom
 			}
 		}
 	}
 
+	LoopRemove(floor_chunks, [](FloorChunk& chunk) { return chunk.builder.vertices.empty(); });
+	for(FloorChunk& chunk : floor_chunks)
+		CreateFloorChunkMesh(chunk);
+}
+
+void CityGenerator::CreateFloorChunkMesh(FloorChunk& chunk)
+{
+	chunk.builder.JoinIndices();
+	chunk.mesh = res_mgr->CreateMesh(&chunk.builder);
+	float radius = 0.f;
+	for(Vertex& v : chunk.builder.vertices)
+		radius = max(radius, v.pos.LengthSquared());
+	chunk.mesh->head.radius = sqrt(radius);
+	chunk.builder.indices.clear();
+}
+
+void CityGenerator::ClearFloorChunks()
+{
+	for(FloorChunk& chunk : floor_chunks)
+		delete chunk.mesh;
+	floor_chunks.clear();
+}
+
+void CityGenerator::CreateScene()
+{
+	// floor
+	for(FloorChunk& chunk : floor_chunks)
+	{
+		SceneNode* node = new SceneNode;
+		node->pos = chunk.pos;
+		node->rot = Vec3::Zero;
+		node->mesh = chunk.mesh;
+		scene->GetPart(chunk.pt)->Add(node);
+	}
+
 	// buildings
 	for(Building* p_b : buildings)
 	{
@@ -795,10 +810,10 @@ void CityGenerator::SpawnItem(Building* building, Item* item)
 	}
 }
 
-void CityGenerator::SpawnZombies()
+void CityGenerator::SpawnZombies(uint count)
 {
 	Vec2 player_pos = player_start_pos.XZ();
-	for(int i = 0; i < 25; ++i)
+	for(uint i = 0; i < count; ++i)
 	{
 		for(int tries = 0; tries < 5; ++tries)
 		{
@@ -838,12 +853,17 @@ void CityGenerator::Save(FileWriter& f)
 	f << buildings.size();
 	for(Building* b : buildings)
 		b->Save(f);
+	f << floor_chunks.size();
+	for(FloorChunk& chunk : floor_chunks)
+	{
+		f << chunk.pt;
+		f << chunk.pos;
+		chunk.builder.Save(f);
+	}
 
 	navmesh->Save(f);
 	bool done = navmesh_built != 0;
 	f << done;
-	if(!done)
-		f << navmesh_next_tile;
 }
 
 void CityGenerator::Load(FileReader& f)
@@ -858,6 +878,16 @@ void CityGenerator::Load(FileReader& f)
 		b->Load(f);
 		buildings.push_back(b);
 	}
+	ClearFloorChunks();
+	f >> count;
+	floor_chunks.resize(count);
+	for(FloorChunk& chunk : floor_chunks)
+	{
+		f >> chunk.pt;
+		f >> chunk.pos;
+		chunk.builder.Load(f, res_mgr);
+		CreateFloorChunkMesh(chunk);
+	}
 	BuildBuildingsMesh();
 	CreateScene();
 	level->SpawnBarriers();
@@ -868,47 +898,31 @@ void CityGenerator::Load(FileReader& f)
 	f >> done;
 	if(!done)
 	{
-		f >> navmesh_next_tile;
-		navmesh_timer.Start();
-		navmesh_built = 0;
-		navmesh_thread_state = THREAD_WORKING;
-		navmesh_thread = std::thread(&CityGenerator::NavmeshThreadLoop, this);
+		// build missing tiles
+		navmesh_tiles.clear();
+		for(uint y = 0; y < NAVMESH_TILES; ++y)
+		{
+			for(uint x = 0; x < NAVMESH_TILES; ++x)
+			{
+				if(!navmesh->HaveTile(Int2(x, y)))
+					navmesh_tiles.push_back(Int2(x, y));
+			}
+		}
+		StartNavmeshJobs(level->player->node->pos);
 	}
 	else
 		navmesh_built = 2;
 }
 
-void CityGenerator::NavmeshThreadLoop()
+// low priority pool job, builder & geometry are selected by thread index so each worker use own
+void CityGenerator::BuildNavmeshTileJob(uint index)
 {
-	while(true)
-	{
-		switch(navmesh_thread_state)
-		{
-		case THREAD_NOT_STARTED:
-		case THREAD_FINISHED:
-			assert(0);
-			break;
-		case THREAD_QUIT:
-			return;
-		case THREAD_WORKING:
-			{
-				BuildNavmeshTile(navmesh_next_tile, true);
-				++navmesh_next_tile.x;
-				if(navmesh_next_tile.x == NAVMESH_TILES)
-				{
-					navmesh_next_tile.x = 0;
-					navmesh_next_tile.y++;
-					if(navmesh_next_tile.y == NAVMESH_TILES)
-					{
-						navmesh_built = 1;
-						navmesh_thread_state = THREAD_FINISHED;
-						return;
-					}
-				}
-			}
-			break;
-		}
-	}
+	if(navmesh_quit)
+		return;
+	uint thread_index = ThreadPool::GetThreadIndex();
+	BuildNavmeshTile(navmesh_tiles[index], true, *navmesh_geoms[thread_index], thread_index);
+	if(--navmesh_tiles_left == 0)
+		navmesh_built = 1;
 }
 
 void CityGenerator::BuildNavmesh()
@@ -925,11 +939,40 @@ void CityGenerator::BuildNavmesh()
 	//		BuildNavmeshTile(Int2(x, y), true);
 
 	// build in background
+	navmesh_tiles.clear();
+	for(uint y = 0; y < NAVMESH_TILES; ++y)
+	{
+		for(uint x = 0; x < NAVMESH_TILES; ++x)
+			navmesh_tiles.push_back(Int2(x, y));
+	}
+	StartNavmeshJobs(player_start_pos);
+}
+
+void CityGenerator::StartNavmeshJobs(const Vec3& pos)
+{
 	navmesh_timer.Start();
+	if(navmesh_tiles.empty())
+	{
+		navmesh_built = 1;
+		return;
+	}
+
+	// tiles near player first
+	const float navmesh_tile_size = map_size / NAVMESH_TILES;
+	Vec2 pt = pos.XZ() / navmesh_tile_size;
+	std::sort(navmesh_tiles.begin(), navmesh_tiles.end(), [pt](const Int2& a, const Int2& b)
+	{
+		return Vec2::DistanceSquared(Vec2(a.x + 0.5f, a.y + 0.5f), pt) < Vec2::DistanceSquared(Vec2(b.x + 0.5f, b.y + 0.5f), pt);
+	});
+
+	navmesh->SetBuildersCount(thread_pool->GetThreadsCount());
+	Info("Building navmesh tiles using low priority jobs.");
+
 	navmesh_built = 0;
-	navmesh_next_tile = Int2::Zero;
-	navmesh_thread_state = THREAD_WORKING;
-	navmesh_thread = std::thread(&CityGenerator::NavmeshThreadLoop, this);
+	navmesh_quit = false;
+	navmesh_tiles_left = navmesh_tiles.size();
+	thread_pool->SubmitLowPriorityFor(navmesh_tiles.size(), delegate<void(uint)>(this, &CityGenerator::BuildNavmeshTileJob),
+		&navmesh_counter);
 }
 
 void CityGenerator::CheckNavmeshGeneration()
@@ -939,33 +982,40 @@ void CityGenerator::CheckNavmeshGeneration()
 		navmesh_built = 2;
 		float t = navmesh_timer.Tick();
 		Info("Finished navmesh generation. Took %g sec.", t);
+		navmesh->LogCacheStats();
 	}
 }
 
+// cancel not started tile jobs & wait for running ones, new tiles are saved to cache when leaving level (not during game)
 void CityGenerator::WaitForNavmeshThread()
 {
-	if(navmesh_thread_state == THREAD_WORKING)
-	{
-		navmesh_thread_state = THREAD_QUIT;
-		navmesh_thread.join();
-	}
-	else if(navmesh_thread_state == THREAD_FINISHED)
-		navmesh_thread.join();
-	navmesh_thread_state = THREAD_NOT_STARTED;
+	navmesh_quit = true;
+	thread_pool->Wait(navmesh_counter);
+	navmesh_quit = false;
+	navmesh->SaveCache();
+}
+
+// wait until navmesh jobs build all tiles
+void CityGenerator::FinishNavmeshGeneration()
+{
+	thread_pool->Wait(navmesh_counter);
+	CheckNavmeshGeneration();
 }
 
-void CityGenerator::BuildNavmeshTile(const Int2& tile, bool is_tiled)
+void CityGenerator::BuildNavmeshTile(const Int2& tile, bool is_tiled, LevelGeometry& geom, uint builder_index)
 {
 	geom.verts.clear();
 	geom.tris.clear();
 
-	// floor
+	// floor, only inside tile so same tiles have same geometry (used by navmesh cache)
+	Box2d box = is_tiled ? navmesh->GetBoxForTile(tile) : Box2d(0, 0, map_size, map_size);
+	Box2d floor(max(box.v1.x, 0.f), max(box.v1.y, 0.f), min(box.v2.x, map_size), min(box.v2.y, map_size));
 	geom.verts.insert(geom.verts.end(),
 		{
-			Vec3(0, 0, 0),
-			Vec3(map_size, 0, 0),
-			Vec3(0, 0, map_size),
-			Vec3(map_size, 0, map_size)
+			Vec3(floor.v1.x, 0, floor.v1.y),
+			Vec3(floor.v2.x, 0, floor.v1.y),
+			Vec3(floor.v1.x, 0, floor.v2.y),
+			Vec3(floor.v2.x, 0, floor.v2.y)
 		}
 	);
 	geom.tris.insert(geom.tris.end(),
@@ -975,10 +1025,20 @@ void CityGenerator::BuildNavmeshTile(const Int2& tile, bool is_tiled)
 		}
 	);
 
-	// colliders
-	Box2d box = is_tiled ? navmesh->GetBoxForTile(tile) : Box2d(0, 0, map_size, map_size);
-	vector<Collider> colliders;
+	// colliders, sorted by position to get same order for same tiles
+	geom.arena.Reset();
+	ArenaVector<Collider> colliders(geom.arena);
 	level->GatherColliders(colliders, box);
+	std::sort(colliders.begin(), colliders.end(), [](const Collider& c1, const Collider& c2)
+	{
+		if(c1.center.x != c2.center.x)
+			return c1.center.x < c2.center.x;
+		if(c1.center.y != c2.center.y)
+			return c1.center.y < c2.center.y;
+		if(c1.half_size.x != c2.half_size.x)
+			return c1.half_size.x < c2.half_size.x;
+		return c1.half_size.y < c2.half_size.y;
+	});
 
 	for(Collider& c : colliders)
 	{
@@ -1026,7 +1086,7 @@ void CityGenerator::BuildNavmeshTile(const Int2& tile, bool is_tiled)
 	nav_geom.bounds = box.ToBoxXZ(0.f, 2.f);
 	
 	if(is_tiled)
-		navmesh->BuildTile(tile, nav_geom);
+		navmesh->BuildTile(tile, nav_geom, builder_index);
 	else
 		navmesh->Build(nav_geom);
 }
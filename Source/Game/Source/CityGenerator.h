@@ -2,6 +2,9 @@
 
 #include "Collider.h"
 #include "Building.h"
+#include <MeshBuilder.h>
+#include <FrameArena.h>
+#include <ThreadPool.h>
 
 enum Tile
 {
@@ -15,16 +18,20 @@ struct LevelGeometry
 {
 	vector<Vec3> verts;
 	vector<int> tris;
+	FrameArena arena; // transient data of single tile
 
 	void SaveObj(cstring filename);
 };
 
-enum ThreadState
+// floor tiles & curbs of single scene part merged into one mesh
+struct FloorChunk
 {
-	THREAD_NOT_STARTED,
-	THREAD_WORKING,
-	THREAD_FINISHED,
-	THREAD_QUIT
+	FloorChunk() : mesh(nullptr) {}
+
+	Int2 pt;
+	Vec3 pos;
+	MeshBuilder builder; // kept for saving
+	Mesh* mesh;
 };
 
 class CityGenerator
@@ -32,9 +39,9 @@ class CityGenerator
 public:
 	CityGenerator();
 	~CityGenerator();
-	void Init(Scene* scene, Level* level, ResourceManager* res_mgr, uint size, uint splits, Navmesh* navmesh);
+	void Init(Scene* scene, Level* level, ResourceManager* res_mgr, ThreadPool* thread_pool, uint size, uint splits, Navmesh* navmesh);
 	void Reset();
-	void Generate();
+	void Generate(uint zombies_count = 25);
 	void DrawMap();
 	float GetY(const Vec3& pos);
 	float GetMapSize() { return map_size; }
@@ -42,6 +49,7 @@ public:
 	void Load(FileReader& f);
 	void CheckNavmeshGeneration();
 	void WaitForNavmeshThread();
+	void FinishNavmeshGeneration();
 
 	static const float tile_size;
 	static const float floor_y;
@@ -51,16 +59,21 @@ private:
 	void GenerateMap();
 	void FillBuildings();
 	void BuildBuildingsMesh();
+	void BuildFloorChunks();
+	void CreateFloorChunkMesh(FloorChunk& chunk);
+	void ClearFloorChunks();
 	void CreateScene();
-	void NavmeshThreadLoop();
+	void BuildNavmeshTileJob(uint index);
 	void BuildNavmesh();
-	void BuildNavmeshTile(const Int2& tile, bool is_tiled);
+	void StartNavmeshJobs(const Vec3& pos);
+	void BuildNavmeshTile(const Int2& tile, bool is_tiled, LevelGeometry& geom, uint builder_index);
 	void SpawnItems();
 	void SpawnItem(Building* building, Item* item);
-	void SpawnZombies();
+	void SpawnZombies(uint count);
 	Int2 PosToPt(const Vec3& pos);
 
 	ResourceManager* res_mgr;
+	ThreadPool* thread_pool;
 	Scene* scene;
 	Navmesh* navmesh;
 	Level* level;
@@ -68,12 +81,14 @@ private:
 	uint size;
 	float mesh_offset[T_MAX], map_size;
 	vector<Building*> buildings;
+	vector<FloorChunk> floor_chunks;
 	Vec3 player_start_pos;
-	LevelGeometry geom;
-	std::thread navmesh_thread;
-	ThreadState navmesh_thread_state;
-	int navmesh_built;
-	Int2 navmesh_next_tile;
+	vector<Int2> navmesh_tiles; // tiles to build, closest to player first
+	vector<LevelGeometry*> navmesh_geoms; // for each thread
+	ThreadPool::Counter navmesh_counter;
+	std::atomic<int> navmesh_built;
+	std::atomic<uint> navmesh_tiles_left;
+	std::atomic<bool> navmesh_quit;
 	Timer navmesh_timer;
 
 	// resources
@@ -0,0 +1,166 @@
+#include "GameCore.h"
+#include "FlowField.h"
+#include "Navmesh.h"
+#include <DetourNavMesh.h>
+
+const float FlowField::max_dist = 100.f;
+static const float NOT_REACHED = std::numeric_limits<float>::max();
+
+FlowField::FlowField() : navmesh(nullptr), target_ref(0), target_index(-1), reached(0), tiles_version(0)
+{
+}
+
+void FlowField::Init(Navmesh* navmesh)
+{
+	assert(navmesh);
+	this->navmesh = navmesh;
+}
+
+void FlowField::Clear()
+{
+	target_ref = 0;
+	target_index = -1;
+	reached = 0;
+	tile_offset.clear();
+}
+
+// returns true if field was rebuilt
+bool FlowField::Update(const Vec3& target)
+{
+	dtPolyRef ref = navmesh->GetPolyRef(target);
+	uint version = navmesh->GetTilesVersion();
+	this->target = target;
+	if(ref == target_ref && version == tiles_version)
+		return false;
+	target_ref = ref;
+	tiles_version = version;
+	Build();
+	return true;
+}
+
+int FlowField::GetIndex(dtPolyRef ref) const
+{
+	uint salt, it, ip;
+	navmesh->GetDetourNavmesh()->decodePolyId(ref, salt, it, ip);
+	if(it + 1 >= tile_offset.size())
+		return -1;
+	uint index = tile_offset[it] + ip;
+	if(index >= tile_offset[it + 1])
+		return -1;
+	return (int)index;
+}
+
+void FlowField::Build()
+{
+	std::shared_lock<std::shared_mutex> lock(navmesh->GetTilesMutex());
+	const dtNavMesh* mesh = navmesh->GetDetourNavmesh();
+	target_index = -1;
+	reached = 0;
+
+	// map polygons to indices, tiles can be added later so it's calculated on each build
+	int tiles = mesh->getMaxTiles();
+	tile_offset.resize(tiles + 1);
+	uint count = 0;
+	for(int i = 0; i < tiles; ++i)
+	{
+		tile_offset[i] = count;
+		const dtMeshTile* tile = mesh->getTile(i);
+		if(tile->header)
+			count += tile->header->polyCount;
+	}
+	tile_offset[tiles] = count;
+
+	if(target_ref == 0)
+		return;
+
+	dist.assign(count, NOT_REACHED);
+	next_point.resize(count);
+	parent.resize(count);
+	refs.resize(count);
+
+	target_index = GetIndex(target_ref);
+	if(target_index == -1)
+		return;
+
+	// dijkstra from target, polygon position is center of portal it was entered from
+	auto cmp = [](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first; };
+	dist[target_index] = 0.f;
+	next_point[target_index] = target;
+	parent[target_index] = -1;
+	refs[target_index] = target_ref;
+	open.clear();
+	open.push_back({ 0.f, target_index });
+	while(!open.empty())
+	{
+		std::pop_heap(open.begin(), open.end(), cmp);
+		std::pair<float, int> current = open.back();
+		open.pop_back();
+		int index = current.second;
+		if(current.first > dist[index])
+			continue;
+		++reached;
+
+		const dtMeshTile* tile;
+		const dtPoly* poly;
+		mesh->getTileAndPolyByRefUnsafe(refs[index], &tile, &poly);
+		const Vec3& pos = next_point[index];
+		for(uint i = poly->firstLink; i != DT_NULL_LINK; i = tile->links[i].next)
+		{
+			const dtLink& link = tile->links[i];
+			int nindex = GetIndex(link.ref);
+			if(nindex == -1)
+				continue;
+
+			// portal between polygons, for links between tiles only part of edge is shared
+			const Vec3& v0 = *(const Vec3*)&tile->verts[poly->verts[link.edge] * 3];
+			const Vec3& v1 = *(const Vec3*)&tile->verts[poly->verts[(link.edge + 1) % poly->vertCount] * 3];
+			Vec3 portal;
+			if(link.side != 0xFF && (link.bmin != 0 || link.bmax != 255))
+			{
+				const float s = 1.f / 255;
+				portal = Vec3::Lerp(v0, v1, (link.bmin + link.bmax) * s / 2);
+			}
+			else
+				portal = (v0 + v1) / 2;
+
+			float new_dist = current.first + Vec3::Distance(pos, portal);
+			if(new_dist >= dist[nindex] || new_dist > max_dist)
+				continue;
+			dist[nindex] = new_dist;
+			next_point[nindex] = portal;
+			parent[nindex] = index;
+			refs[nindex] = link.ref;
+			open.push_back({ new_dist, nindex });
+			std::push_heap(open.begin(), open.end(), cmp);
+		}
+	}
+}
+
+// get point to move toward from position inside polygon, false if polygon can't reach target
+bool FlowField::GetNextPoint(dtPolyRef ref, const Vec3& pos, Vec3& pt) const
+{
+	if(target_index == -1 || ref == 0)
+		return false;
+	int index = GetIndex(ref);
+	if(index == -1 || dist[index] == NOT_REACHED)
+		return false;
+	if(index == target_index)
+	{
+		pt = target;
+		return true;
+	}
+
+	// when standing on portal, polygon can be still the same - use next one
+	if(Vec3::Distance2d(pos, next_point[index]) < 0.25f)
+	{
+		index = parent[index];
+		if(index == target_index)
+		{
+			pt = target;
+			return true;
+		}
+	}
+
+	pt = next_point[index];
+	return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+// Dijkstra map over navmesh polygons toward single target (player).
+// Rebuilt only when target changes polygon or navmesh tile is added, then any unit can get next waypoint in O(1) without own path search.
+class FlowField
+{
+public:
+	FlowField();
+	void Init(Navmesh* navmesh);
+	void Clear();
+	bool Update(const Vec3& target);
+	bool GetNextPoint(dtPolyRef ref, const Vec3& pos, Vec3& pt) const;
+
+	dtPolyRef GetTargetRef() const { return target_ref; }
+	uint GetReachedCount() const { return reached; }
+
+	static const float max_dist;
+
+private:
+	int GetIndex(dtPolyRef ref) const;
+	void Build();
+
+	Navmesh* navmesh;
+	vector<uint> tile_offset; // index of first tile poly, last element is polys count
+	vector<float> dist;
+	vector<Vec3> next_point; // portal center toward target
+	vector<int> parent;
+	vector<std::pair<float, int>> open;
+	vector<dtPolyRef> refs;
+	Vec3 target;
+	dtPolyRef target_ref;
+	int target_index;
+	uint reached, tiles_version;
+};
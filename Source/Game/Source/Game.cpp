@@ -26,15 +26,23 @@
 #include <Gui.h>
 #include <Config.h>
 #include <Sky.h>
+#include <ThreadPool.h>
+#include <FrameArena.h>
 #include "PickPerkDialog.h"
 #include "Perk.h"
 #include "Navmesh.h"
+#include "FlowField.h"
+#include "PathQueue.h"
 
+// names used every frame are interned once
+static const NameId ani_attack[2] = { NameTable::Add("atak1"), NameTable::Add("atak2") };
+static const NameId point_hitbox[2] = { NameTable::Add("hitbox1"), NameTable::Add("hitbox2") };
 
-const int level_size = 32;
 
-
-Game::Game() : camera(nullptr), quickstart(false), config(nullptr), pick_perk(nullptr), draw_navmesh(false)
+Game::Game() : camera(nullptr), quickstart(false), config(nullptr), pick_perk(nullptr), draw_navmesh(false), benchmark(false), bench_sim(false), bench_scaling(false),
+bench_pursuit(false), bench_anim(false), bench_render(false), bench_pipeline(false), bench_jobs(false), bench_pool(false), bench_file(false), bench_mesh(false), bench_load(false), bench_archive(false),
+use_flow_field(true), use_navmesh_cache(true), update_game(false), bench_ticks(3600), bench_seed(0), bench_zombies(25), max_zombies(25),
+startup_timer(false), startup_time(0), time_to_first_frame(-1.f), time_to_menu(-1.f), startup_frames(0), startup_menu_loaded(false)
 {
 }
 
@@ -47,11 +55,15 @@ Game::~Game()
 
 int Game::Start(cstring cmd_line)
 {
+	startup_timer.Start();
 	engine.reset(new Engine);
 
 	InitLogger();
 	LoadConfig(cmd_line);
 
+	if(benchmark)
+		return RunBenchmark();
+
 	try
 	{
 		InitEngine();
@@ -149,14 +161,20 @@ void Game::InitGame()
 	game_state.config = config;
 
 	navmesh.reset(new Navmesh);
+	if(use_navmesh_cache)
+		navmesh->LoadCache("navmesh.cache");
+	path_queue.reset(new PathQueue);
+	path_queue->Init(navmesh.get(), engine->GetThreadPool());
+	flow_field.reset(new FlowField);
+	flow_field->Init(navmesh.get());
 
 	// sky
 	sky = new Sky(scene);
-	sky->tex_clouds_noise = res_mgr->GetTexture("sky/noise.png");
-	sky->tex_stars = res_mgr->GetTexture("sky/stars.png");
-	sky->sun.texture = res_mgr->GetTexture("sky/sun.png");
+	sky->tex_clouds_noise = res_mgr->GetTextureAsync("sky/noise.png", ResourceManager::Priority::High);
+	sky->tex_stars = res_mgr->GetTextureAsync("sky/stars.png", ResourceManager::Priority::High);
+	sky->sun.texture = res_mgr->GetTextureAsync("sky/sun.png", ResourceManager::Priority::High);
 	sky->sun.enabled = true;
-	sky->moon.texture = res_mgr->GetTexture("sky/moon.png");
+	sky->moon.texture = res_mgr->GetTextureAsync("sky/moon.png", ResourceManager::Priority::High);
 	sky->moon.enabled = true;
 	scene->SetSky(sky);
 
@@ -171,7 +189,7 @@ void Game::InitGame()
 	LoadResources();
 
 	city_generator.reset(new CityGenerator);
-	city_generator->Init(scene, level.get(), res_mgr, level_size, 3, navmesh.get());
+	city_generator->Init(scene, level.get(), res_mgr, engine->GetThreadPool(), level_size, 3, navmesh.get());
 
 	main_menu = new MainMenu;
 	main_menu->Init(res_mgr, &game_state);
@@ -183,27 +201,29 @@ void Game::InitGame()
 	pick_perk = new PickPerkDialog(&game_state, res_mgr);
 }
 
+// resources are loaded in background while menu is visible, game waits for them in StartGame
 void Game::LoadResources()
 {
 	// particle texture
-	tex_blood = res_mgr->GetTexture("particles/blood.png");
-	tex_zombie_blood = res_mgr->GetTexture("particles/zombie_blood.png");
-	tex_hit_object = res_mgr->GetTexture("particles/hit_object.png");
+	tex_blood = res_mgr->GetTextureAsync("particles/blood.png", ResourceManager::Priority::Low);
+	tex_zombie_blood = res_mgr->GetTextureAsync("particles/zombie_blood.png", ResourceManager::Priority::Low);
+	tex_hit_object = res_mgr->GetTextureAsync("particles/hit_object.png", ResourceManager::Priority::Low);
+	ParticleEmitter::Reserve(128);
 
 	// sounds
-	sound_player_hurt = res_mgr->GetSound("sounds/player_hurt.mp3");
-	sound_player_die = res_mgr->GetSound("sounds/player_die.mp3");
-	sound_zombie_hurt = res_mgr->GetSound("sounds/zombie_hurt.mp3");
-	sound_zombie_die = res_mgr->GetSound("sounds/zombie_die.mp3");
-	sound_zombie_attack = res_mgr->GetSound("sounds/zombie attack.wav");
-	sound_zombie_alert = res_mgr->GetSound("sounds/zombie alert.wav");
-	sound_hit = res_mgr->GetSound("sounds/hit.mp3");
-	sound_medkit = res_mgr->GetSound("sounds/medkit.mp3");
-	sound_eat = res_mgr->GetSound("sounds/eat.mp3");
-	sound_hungry = res_mgr->GetSound("sounds/hungry.mp3");
-	sound_shoot = res_mgr->GetSound("sounds/shoot.mp3");
-	sound_shoot_try = res_mgr->GetSound("sounds/shoot_try.mp3");
-	sound_reload = res_mgr->GetSound("sounds/reload.mp3");
+	sound_player_hurt = res_mgr->GetSoundAsync("sounds/player_hurt.mp3");
+	sound_player_die = res_mgr->GetSoundAsync("sounds/player_die.mp3");
+	sound_zombie_hurt = res_mgr->GetSoundAsync("sounds/zombie_hurt.mp3");
+	sound_zombie_die = res_mgr->GetSoundAsync("sounds/zombie_die.mp3");
+	sound_zombie_attack = res_mgr->GetSoundAsync("sounds/zombie attack.wav");
+	sound_zombie_alert = res_mgr->GetSoundAsync("sounds/zombie alert.wav");
+	sound_hit = res_mgr->GetSoundAsync("sounds/hit.mp3");
+	sound_medkit = res_mgr->GetSoundAsync("sounds/medkit.mp3");
+	sound_eat = res_mgr->GetSoundAsync("sounds/eat.mp3");
+	sound_hungry = res_mgr->GetSoundAsync("sounds/hungry.mp3");
+	sound_shoot = res_mgr->GetSoundAsync("sounds/shoot.mp3");
+	sound_shoot_try = res_mgr->GetSoundAsync("sounds/shoot_try.mp3");
+	sound_reload = res_mgr->GetSoundAsync("sounds/reload.mp3");
 
 	level->LoadResources();
 	Item::LoadData(res_mgr);
@@ -211,6 +231,7 @@ void Game::LoadResources()
 
 void Game::StartGame(bool load)
 {
+	res_mgr->WaitForAll();
 	main_menu->Hide();
 	game_gui->visible = true;
 	if(!load)
@@ -234,12 +255,33 @@ void Game::ExitToMenu()
 	city_generator->WaitForNavmeshThread();
 	main_menu->Show();
 	game_gui->visible = false;
+	path_queue->Clear();
+	flow_field->Clear();
 	city_generator->Reset();
 	in_game = false;
 }
 
 bool Game::OnTick(float dt)
 {
+	if(time_to_menu < 0.f)
+	{
+		// engine calls EndScene after OnTick, so previous frame is presented when next tick starts
+		startup_time += startup_timer.Tick();
+		if(time_to_first_frame < 0.f && startup_frames > 0)
+		{
+			time_to_first_frame = startup_time;
+			Info("Startup: first frame after %g ms.", time_to_first_frame * 1000);
+		}
+		if(startup_menu_loaded)
+		{
+			time_to_menu = startup_time;
+			Info("Startup: menu ready after %g ms.", time_to_menu * 1000);
+		}
+		else if(res_mgr->GetPendingCount() == 0)
+			startup_menu_loaded = true;
+		++startup_frames;
+	}
+
 	GameState::ChangeState change_state = game_state.GetChangeState();
 
 	if((input->Down(Key::Alt) && input->Pressed(Key::F4))
@@ -268,7 +310,7 @@ bool Game::OnTick(float dt)
 		else if(change_state == GameState::EXIT_TO_MENU)
 			ExitToMenu();
 		else
-			UpdateGame(dt);
+			update_game = true;
 	}
 	else
 	{
@@ -284,6 +326,16 @@ bool Game::OnTick(float dt)
 	return true;
 }
 
+// game is updated on pipeline thread while previous frame is drawn
+void Game::OnUpdate(float dt)
+{
+	if(update_game)
+	{
+		update_game = false;
+		UpdateGame(dt);
+	}
+}
+
 void Game::UpdateGame(float dt)
 {
 	if(game_state.IsPaused())
@@ -429,7 +481,7 @@ void Game::UpdatePlayer(float dt)
 		// attack
 		player->action = A_ATTACK;
 		player->action_state = 0;
-		player->node->mesh_inst->Play(Rand() % 2 == 0 ? "atak1" : "atak2", PLAY_ONCE | PLAY_CLEAR_FRAME_END_INFO, 1);
+		player->node->mesh_inst->Play(ani_attack[Rand() % 2], PLAY_ONCE | PLAY_CLEAR_FRAME_END_INFO, 1);
 	}
 	if(player->action == A_NONE && allow_mouse && !player->use_melee && input->Down(Key::RightButton))
 	{
@@ -840,322 +892,375 @@ void Game::UpdateTestPath(const Vec3& player_pos)
 
 void Game::UpdateZombies(float dt)
 {
+	vector<Zombie*>& zombies = level->zombies;
+
+	// deliver paths requested in previous updates
+	path_queue->Update();
+
+	// rebuild flow field toward player when needed
+	if(use_flow_field && level->player->hp > 0
+		&& std::any_of(zombies.begin(), zombies.end(), [](Zombie* zombie) { return zombie->hp > 0 && zombie->state == AI_COMBAT; }))
+		flow_field->Update(level->player->node->pos);
+
+	// think - only reads shared state so it runs in parallel, side effects are queued in actions (valid until end of frame)
+	ArenaVector<ZombieAction> actions(zombies.size());
+	engine->GetThreadPool()->ParallelFor(zombies.size(), [&](uint index)
+	{
+		ThinkZombie(*zombies[index], actions[index], dt);
+	});
+
+	// apply - in fixed order to keep results deterministic
+	for(uint i = 0, count = zombies.size(); i < count; ++i)
+		ApplyZombie(*zombies[i], actions[i], dt);
+
+	LoopRemove(alert_pos, [dt](std::pair<Vec3, float>& alert)
+	{
+		return (alert.second -= dt) <= 0.f;
+	});
+}
+
+// can only modify this zombie, don't use Rand here
+void Game::ThinkZombie(Zombie& zombie, ZombieAction& action, float dt)
+{
+	action.animation = ANI_STAND;
+	action.move = MOVE_NO;
+	action.go_idle = false;
+	action.new_idle = false;
+	action.alert = false;
+	action.attack = false;
+	action.flow = false;
+
+	if(zombie.hp <= 0)
+		return;
+
 	Player* player = level->player;
-	for(Zombie* zombie : level->zombies)
+
+	if(zombie.state == AI_IDLE || zombie.state == AI_FALLOW)
+		SearchForTarget(zombie, action);
+
+	if(zombie.state == AI_IDLE)
 	{
-		if(zombie->hp <= 0)
+		zombie.timer -= dt;
+		if(zombie.timer <= 0.f)
+			action.new_idle = true;
+		else
 		{
-			if(zombie->dying && zombie->node->mesh_inst->GetEndResult(0))
+			switch(zombie.idle)
 			{
-				zombie->dying = false;
-				zombie->death_timer = 0;
-				level->SpawnBlood(*zombie);
-				--level->alive_zombies;
+			case IDLE_NONE:
+				break;
+			case IDLE_ROTATE:
+				action.move = MOVE_ROTATE;
+				break;
+			case IDLE_WALK:
+				if(Vec3::Distance2d(zombie.target_pos, zombie.node->pos) < 0.1f
+					|| Vec3::Distance2d(zombie.start_pos, zombie.node->pos) >= 6.f)
+					zombie.idle = IDLE_NONE;
+				else
+					action.move = MOVE_FORWARD;
+				break;
+			case IDLE_ANIM:
+				if(zombie.node->mesh_inst->GetEndResult(0))
+				{
+					action.animation = ANI_STAND;
+					zombie.idle = IDLE_NONE;
+				}
+				else
+					action.animation = ANI_IDLE;
+				break;
 			}
-			continue;
 		}
-
-		enum Move
+	}
+	else if(zombie.state == AI_COMBAT)
+	{
+		if(player->hp <= 0.f)
 		{
-			MOVE_NO,
-			MOVE_ROTATE,
-			MOVE_FORWARD,
-			MOVE_BACK // no pf
-		};
-
-		Animation animation = ANI_STAND;
-		Move move = MOVE_NO;
+			// target is dead
+			action.go_idle = true;
+			return;
+		}
 
-		if(zombie->state == AI_IDLE || zombie->state == AI_FALLOW)
-			SearchForTarget(zombie);
+		zombie.timer -= dt; // attack delay
 
-		if(zombie->state == AI_IDLE)
+		float dist = Vec3::Distance2d(zombie.node->pos, player->node->pos);
+		if(dist >= 10.f || !CanSee(zombie, player->node->pos))
 		{
-			zombie->timer -= dt;
-			if(zombie->timer <= 0.f)
+			zombie.timer2 += dt;
+			if(zombie.timer2 >= 0.5f)
 			{
-				zombie->timer = Zombie::idle_timer.Random();
-				zombie->idle = (IdleAction)(Rand() % 4);
-				switch(zombie->idle)
-				{
-				case IDLE_NONE:
-					break;
-				case IDLE_ROTATE:
-					{
-						float angle = Clip(zombie->node->rot.y + Random(PI / 2, PI * 3 / 2));
-						zombie->target_pos = zombie->node->pos + Vec3(cos(angle), 0, sin(angle));
-					}
-					break;
-				case IDLE_WALK:
-					{
-						float angle = Random(0.f, PI * 2);
-						float dist = Random(2.f, 5.f);
-						zombie->target_pos = zombie->node->pos + Vec3(cos(angle) * dist, 0, sin(angle) * dist);
-						zombie->start_pos = zombie->node->pos;
-					}
-					break;
-				case IDLE_ANIM:
-					animation = ANI_IDLE;
-					break;
-				}
+				// lost target, go to last known pos
+				zombie.ChangeState(AI_FALLOW);
 			}
 			else
 			{
-				switch(zombie->idle)
-				{
-				case IDLE_NONE:
-					break;
-				case IDLE_ROTATE:
-					move = MOVE_ROTATE;
-					break;
-				case IDLE_WALK:
-					if(Vec3::Distance2d(zombie->target_pos, zombie->node->pos) < 0.1f
-						|| Vec3::Distance2d(zombie->start_pos, zombie->node->pos) >= 6.f)
-						zombie->idle = IDLE_NONE;
-					else
-						move = MOVE_FORWARD;
-					break;
-				case IDLE_ANIM:
-					if(zombie->node->mesh_inst->GetEndResult(0))
-					{
-						animation = ANI_STAND;
-						zombie->idle = IDLE_NONE;
-					}
-					else
-						animation = ANI_IDLE;
-					break;
-				}
+				zombie.target_pos = player->node->pos;
+				action.move = MOVE_FORWARD;
 			}
 		}
-		else if(zombie->state == AI_COMBAT)
+		else
 		{
-			if(player->hp <= 0.f)
+			zombie.target_pos = player->node->pos;
+			zombie.timer2 = 0.f;
+
+			if(dist > 1.2f)
 			{
-				// target is dead
-				zombie->ChangeState(AI_IDLE);
-				continue;
+				// move towards player
+				action.move = MOVE_FORWARD;
 			}
-
-			zombie->timer -= dt; // attack delay
-
-			float dist = Vec3::Distance2d(zombie->node->pos, player->node->pos);
-			if(dist >= 10.f || !CanSee(*zombie, player->node->pos))
+			else if(dist < 1.f)
 			{
-				zombie->timer2 += dt;
-				if(zombie->timer2 >= 0.5f)
-				{
-					// lost target, go to last known pos
-					zombie->ChangeState(AI_FALLOW);
-				}
-				else
-				{
-					zombie->target_pos = player->node->pos;
-					move = MOVE_FORWARD;
-				}
+				// move away from player
+				action.move = MOVE_BACK;
 			}
 			else
-			{
-				zombie->target_pos = player->node->pos;
-				zombie->timer2 = 0.f;
-
-				if(dist > 1.2f)
-				{
-					// move towards player
-					move = MOVE_FORWARD;
-				}
-				else if(dist < 1.f)
-				{
-					// move away from player
-					move = MOVE_BACK;
-				}
-				else
-					move = MOVE_ROTATE;
+				action.move = MOVE_ROTATE;
 
-				if(!zombie->attacking && dist < 1.5f && zombie->timer <= 0 && zombie->GetAngleDiff(player->node->pos) < PI / 4)
-				{
-					// attack
-					zombie->attacking = true;
-					zombie->animation = ANI_ACTION;
-					zombie->timer = Random(1.5f, 2.5f);
-					zombie->attack_index = Rand() % 2 == 0 ? 0 : 1;
-					zombie->node->mesh_inst->Play(zombie->attack_index == 0 ? "atak1" : "atak2", PLAY_ONCE | PLAY_CLEAR_FRAME_END_INFO, 0);
-					if(Rand() % 4)
-						sound_mgr->PlaySound3d(sound_zombie_attack, zombie->GetSoundPos(), 2.f);
-				}
-			}
+			if(!zombie.attacking && dist < 1.5f && zombie.timer <= 0 && zombie.GetAngleDiff(player->node->pos) < PI / 4)
+				action.attack = true;
+		}
+	}
+	else
+	{
+		float dist = Vec3::Distance2d(zombie.node->pos, zombie.target_pos);
+		if(dist < 0.1f)
+		{
+			// target lost
+			action.go_idle = true;
 		}
 		else
+			action.move = MOVE_FORWARD;
+	}
+
+	// chase player using flow field instead of own path
+	if(use_flow_field && zombie.state == AI_COMBAT && action.move == MOVE_FORWARD)
+	{
+		dtPolyRef ref = navmesh->GetPolyRef(zombie.node->pos, ThreadPool::GetThreadIndex());
+		action.flow = flow_field->GetNextPoint(ref, zombie.node->pos, action.flow_point);
+	}
+}
+
+void Game::ApplyZombie(Zombie& zombie, ZombieAction& action, float dt)
+{
+	if(zombie.hp <= 0)
+	{
+		if(zombie.dying && zombie.node->mesh_inst->GetEndResult(0))
 		{
-			float dist = Vec3::Distance2d(zombie->node->pos, zombie->target_pos);
-			if(dist < 0.1f)
-			{
-				// target lost
-				zombie->ChangeState(AI_IDLE);
-			}
-			else
-				move = MOVE_FORWARD;
+			zombie.dying = false;
+			zombie.death_timer = 0;
+			level->SpawnBlood(zombie);
+			--level->alive_zombies;
 		}
+		return;
+	}
+
+	if(action.alert)
+	{
+		sound_mgr->PlaySound3d(sound_zombie_alert, zombie.GetSoundPos(), 2.f);
+		alert_pos.push_back({ zombie.node->pos, 1.f });
+	}
 
-		// calculate path
-		Vec3 move_pos = Vec3::Zero;
-		static const float PF_USED_TIMER = 0.25f;
-		static const float PF_NOT_GENERATED_TIMER = 0.5f;
-		if(move == MOVE_FORWARD)
+	if(action.go_idle)
+	{
+		// target is dead - skip this update like before
+		bool target_dead = (zombie.state == AI_COMBAT);
+		zombie.ChangeState(AI_IDLE);
+		if(target_dead)
+			return;
+	}
+
+	Animation animation = action.animation;
+	if(action.new_idle)
+	{
+		zombie.timer = Zombie::idle_timer.Random();
+		zombie.idle = (IdleAction)(Rand() % 4);
+		switch(zombie.idle)
 		{
-			zombie->pf_timer -= dt;
-
-			// calculate path if:
-			// + not used yet
-			// + generation failed and timer passed
-			// + is used and timer passed and target moved
-			if(zombie->pf_state == PF_NOT_USED
-				|| (zombie->pf_state == PF_NOT_GENERATED && zombie->pf_timer <= 0.f)
-				|| (zombie->pf_state == PF_USED && zombie->pf_timer <= 0.f && Vec3::Distance(zombie->target_pos, zombie->pf_target) > 0.1f))
+		case IDLE_NONE:
+			break;
+		case IDLE_ROTATE:
 			{
-				if(navmesh->FindPath(zombie->node->pos, zombie->target_pos, zombie->path))
-				{
-					zombie->pf_state = PF_USED;
-					zombie->pf_timer = PF_USED_TIMER;
-					zombie->pf_target = zombie->target_pos;
-					zombie->pf_index = 1;
-				}
-				else
-				{
-					zombie->pf_state = PF_NOT_GENERATED;
-					zombie->pf_timer = PF_NOT_GENERATED_TIMER;
-				}
+				float angle = Clip(zombie.node->rot.y + Random(PI / 2, PI * 3 / 2));
+				zombie.target_pos = zombie.node->pos + Vec3(cos(angle), 0, sin(angle));
 			}
-
-			if(zombie->pf_state == PF_USED)
-				move_pos = zombie->path[zombie->pf_index];
-			else
-				move_pos = zombie->target_pos;
+			break;
+		case IDLE_WALK:
+			{
+				float angle = Random(0.f, PI * 2);
+				float dist = Random(2.f, 5.f);
+				zombie.target_pos = zombie.node->pos + Vec3(cos(angle) * dist, 0, sin(angle) * dist);
+				zombie.start_pos = zombie.node->pos;
+			}
+			break;
+		case IDLE_ANIM:
+			animation = ANI_IDLE;
+			break;
 		}
+	}
+
+	if(action.attack)
+	{
+		zombie.attacking = true;
+		zombie.animation = ANI_ACTION;
+		zombie.timer = Random(1.5f, 2.5f);
+		zombie.attack_index = Rand() % 2 == 0 ? 0 : 1;
+		zombie.node->mesh_inst->Play(ani_attack[zombie.attack_index], PLAY_ONCE | PLAY_CLEAR_FRAME_END_INFO, 0);
+		if(Rand() % 4)
+			sound_mgr->PlaySound3d(sound_zombie_attack, zombie.GetSoundPos(), 2.f);
+	}
+
+	// calculate path
+	ZombieMove move = action.move;
+	Vec3 move_pos = Vec3::Zero;
+	if(move == MOVE_FORWARD && action.flow)
+	{
+		// drop queued request, its result would override this state
+		path_queue->Remove(zombie);
+		zombie.pf_state = PF_NOT_USED;
+		move_pos = action.flow_point;
+	}
+	else if(move == MOVE_FORWARD)
+	{
+		zombie.pf_timer -= dt;
+
+		// request path if not waiting for one and:
+		// + not used yet
+		// + generation failed and timer passed
+		// + is used and timer passed and target moved
+		// until it's ready, follow old path or go straight to target
+		if(!zombie.pf_waiting
+			&& (zombie.pf_state == PF_NOT_USED
+			|| (zombie.pf_state == PF_NOT_GENERATED && zombie.pf_timer <= 0.f)
+			|| (zombie.pf_state == PF_USED && zombie.pf_timer <= 0.f && Vec3::Distance(zombie.target_pos, zombie.pf_target) > 0.1f)))
+			path_queue->Add(zombie, zombie.target_pos);
+
+		if(zombie.pf_state == PF_USED)
+			move_pos = zombie.path[zombie.pf_index];
 		else
-		{
-			zombie->pf_state = PF_NOT_USED;
-			move_pos = zombie->target_pos;
-		}
+			move_pos = zombie.target_pos;
+	}
+	else
+	{
+		path_queue->Remove(zombie);
+		zombie.pf_state = PF_NOT_USED;
+		move_pos = zombie.target_pos;
+	}
 
-		if(move != MOVE_NO)
+	if(move != MOVE_NO)
+	{
+		// rotate towards target
+		float required_rot = Vec3::Angle2d(zombie.node->pos, move_pos);
+		int dir;
+		float dif = UnitRotateTo(zombie.node->rot.y, required_rot, dt * Zombie::rot_speed, &dir);
+		if(dir == 1)
+			animation = ANI_ROTATE_LEFT;
+		else if(dir == -1)
+			animation = ANI_ROTATE_RIGHT;
+
+		if(dif < PI / 4)
 		{
-			// rotate towards target
-			float required_rot = Vec3::Angle2d(zombie->node->pos, move_pos);
-			int dir;
-			float dif = UnitRotateTo(zombie->node->rot.y, required_rot, dt * Zombie::rot_speed, &dir);
-			if(dir == 1)
-				animation = ANI_ROTATE_LEFT;
-			else if(dir == -1)
-				animation = ANI_ROTATE_RIGHT;
-
-			if(dif < PI / 4)
+			float dist = Vec3::Distance2d(zombie.node->pos, move_pos);
+			if(move == MOVE_FORWARD)
 			{
-				float dist = Vec3::Distance2d(zombie->node->pos, move_pos);
-				if(move == MOVE_FORWARD)
+				// move forward
+				float travel_dist = Zombie::walk_speed * dt;
+				bool moved = false;
+				while(true)
 				{
-					// move forward
-					float travel_dist = Zombie::walk_speed * dt;
-					bool moved = false;
-					while(true)
+					if(travel_dist >= dist && CheckMovePos(zombie, move_pos))
 					{
-						if(travel_dist >= dist && CheckMovePos(*zombie, move_pos))
+						moved = true;
+						if(zombie.pf_state != PF_USED || zombie.pf_index + 1 >= (int)zombie.path.size())
 						{
-							moved = true;
-							if(zombie->pf_state != PF_USED || zombie->pf_index + 1 >= (int)zombie->path.size())
-							{
-								// reached end of path
-								zombie->pf_state = PF_NOT_USED; 
-								break;
-							}
-
-							// moving to next point
-							++zombie->pf_index;
-							move_pos = zombie->path[zombie->pf_index];
-							travel_dist -= dist;
-							required_rot = Vec3::Angle2d(zombie->node->pos, move_pos);
-							dif = AngleDiff(zombie->node->rot.y, required_rot);
-							if(dif < PI / 4)
-								dist = Vec3::Distance2d(zombie->node->pos, move_pos);
-							else
-								break;
+							// reached end of path
+							zombie.pf_state = PF_NOT_USED;
+							break;
 						}
+
+						// moving to next point
+						++zombie.pf_index;
+						move_pos = zombie.path[zombie.pf_index];
+						travel_dist -= dist;
+						required_rot = Vec3::Angle2d(zombie.node->pos, move_pos);
+						dif = AngleDiff(zombie.node->rot.y, required_rot);
+						if(dif < PI / 4)
+							dist = Vec3::Distance2d(zombie.node->pos, move_pos);
 						else
-						{
-							Vec3 move_dir = Vec3(cos(required_rot), 0, sin(required_rot)) * travel_dist;
-							if(CheckMove(*zombie, move_dir))
-								moved = true;
 							break;
-						}
 					}
-
-					if(moved)
+					else
 					{
-						zombie->node->pos.y = city_generator->GetY(zombie->node->pos);
-						animation = ANI_WALK;
+						Vec3 move_dir = Vec3(cos(required_rot), 0, sin(required_rot)) * travel_dist;
+						if(CheckMove(zombie, move_dir))
+							moved = true;
+						break;
 					}
 				}
-				else if(move == MOVE_BACK)
+
+				if(moved)
 				{
-					// move backward
-					Vec3 move_dir = Vec3(cos(required_rot), 0, sin(required_rot)) * Zombie::walk_speed * dt * -0.66f;
-					if(CheckMove(*zombie, move_dir))
-					{
-						zombie->node->pos.y = city_generator->GetY(zombie->node->pos);
-						animation = ANI_WALK_BACK;
-					}
+					zombie.node->pos.y = city_generator->GetY(zombie.node->pos);
+					animation = ANI_WALK;
+				}
+			}
+			else if(move == MOVE_BACK)
+			{
+				// move backward
+				Vec3 move_dir = Vec3(cos(required_rot), 0, sin(required_rot)) * Zombie::walk_speed * dt * -0.66f;
+				if(CheckMove(zombie, move_dir))
+				{
+					zombie.node->pos.y = city_generator->GetY(zombie.node->pos);
+					animation = ANI_WALK_BACK;
 				}
 			}
 		}
-
-		if(zombie->attacking && zombie->node->mesh_inst->GetEndResult(0))
-		{
-			// end of attack, check for hit
-			Mesh::Point* hitbox = zombie->node->mesh->GetPoint(Format("hitbox%d", zombie->attack_index + 1));
-			if(!hitbox)
-				hitbox = zombie->node->mesh->FindPoint("hitbox");
-			Vec3 hitpoint;
-			Unit* target;
-			if(CheckForHit(*zombie, *hitbox, nullptr, target, hitpoint))
-				HitUnit(*target, Random(10, 15), hitpoint);
-			zombie->attacking = false;
-		}
-
-		zombie->last_damage -= dt;
-		if(zombie->attacking)
-			animation = zombie->animation;
-		zombie->Update(animation);
 	}
 
-	LoopRemove(alert_pos, [dt](std::pair<Vec3, float>& alert)
+	if(zombie.attacking && zombie.node->mesh_inst->GetEndResult(0))
 	{
-		return (alert.second -= dt) <= 0.f;
-	});
+		// end of attack, check for hit
+		Mesh::Point* hitbox = zombie.node->mesh->GetPoint(point_hitbox[zombie.attack_index]);
+		if(!hitbox)
+			hitbox = zombie.node->mesh->FindPoint("hitbox");
+		Vec3 hitpoint;
+		Unit* target;
+		if(CheckForHit(zombie, *hitbox, nullptr, target, hitpoint))
+			HitUnit(*target, Random(10, 15), hitpoint);
+		zombie.attacking = false;
+	}
+
+	zombie.last_damage -= dt;
+	if(zombie.attacking)
+		animation = zombie.animation;
+	zombie.Update(animation);
 }
 
-void Game::SearchForTarget(Zombie* zombie)
+void Game::SearchForTarget(Zombie& zombie, ZombieAction& action)
 {
 	Player* player = level->player;
 	if(player->hp > 0.f)
 	{
-		float dist = Vec3::Distance2d(zombie->node->pos, player->node->pos);
+		float dist = Vec3::Distance2d(zombie.node->pos, player->node->pos);
 		if(dist <= 5.f)
 		{
-			float dif = zombie->GetAngleDiff(player->node->pos);
-			if((dist <= 2.5f || dif <= PI / 2) && CanSee(*zombie, player->node->pos))
+			float dif = zombie.GetAngleDiff(player->node->pos);
+			if((dist <= 2.5f || dif <= PI / 2) && CanSee(zombie, player->node->pos))
 			{
-				ZombieAlert(zombie);
-				zombie->target_pos = player->node->pos;
+				// same as ZombieAlert but sound & alert is queued
+				if(zombie.state != AI_FALLOW)
+					action.alert = true;
+				zombie.ChangeState(AI_COMBAT);
+				zombie.target_pos = player->node->pos;
 				return;
 			}
 		}
 
 		for(auto& alert : alert_pos)
 		{
-			dist = Vec3::Distance2d(zombie->node->pos, alert.first);
-			if(dist <= 5.f && CanSee(*zombie, alert.first))
+			dist = Vec3::Distance2d(zombie.node->pos, alert.first);
+			if(dist <= 5.f && CanSee(zombie, alert.first))
 			{
-				ZombieAlert(zombie, false);
-				zombie->target_pos = alert.first;
+				zombie.ChangeState(AI_COMBAT);
+				zombie.target_pos = alert.first;
 				return;
 			}
 		}
@@ -1216,21 +1321,26 @@ bool Game::CheckForHit(Unit& unit, MeshPoint& mhitbox, MeshPoint* mbone, Unit*&
 	if(!unit.is_zombie)
 	{
 		// try hit zombie
-		for(Zombie* zombie : level->zombies)
+		const float range = 5.f;
+		const Vec3& pos = unit.node->pos;
+		Unit* hit = nullptr;
+		level->GetUnitGrid().ForEach(Box2d(pos.x - range, pos.z - range, pos.x + range, pos.z + range), [&](Unit* other)
 		{
-			if(zombie->hp <= 0 || Vec3::Distance(unit.node->pos, zombie->node->pos) > 5.f)
-				continue;
+			if(hit || !other->is_zombie || other->hp <= 0 || Vec3::Distance(pos, other->node->pos) > range)
+				return;
 
-			Box box = zombie->GetBox();
+			Box box = other->GetBox();
 			b.c = box.Midpoint();
 			b.e = box.Size() / 2;
 
 			if(Oob::Collide(b, a))
-			{
-				hitpoint = a.c;
-				target = zombie;
-				return true;
-			}
+				hit = other;
+		});
+		if(hit)
+		{
+			hitpoint = a.c;
+			target = hit;
+			return true;
 		}
 	}
 	else
@@ -1310,7 +1420,7 @@ bool Game::CheckMove(Unit& unit, const Vec3& dir)
 	Vec3 pos = unit.node->pos + dir;
 	if(level->CheckCollision(unit, pos))
 	{
-		unit.node->pos = pos;
+		level->MoveUnit(unit, pos);
 		return true;
 	}
 
@@ -1318,7 +1428,7 @@ bool Game::CheckMove(Unit& unit, const Vec3& dir)
 	pos = unit.node->pos + Vec3(dir.x, 0, 0);
 	if(level->CheckCollision(unit, pos))
 	{
-		unit.node->pos = pos;
+		level->MoveUnit(unit, pos);
 		return true;
 	}
 
@@ -1326,7 +1436,7 @@ bool Game::CheckMove(Unit& unit, const Vec3& dir)
 	pos = unit.node->pos + Vec3(0, 0, dir.z);
 	if(level->CheckCollision(unit, pos))
 	{
-		unit.node->pos = pos;
+		level->MoveUnit(unit, pos);
 		return true;
 	}
 
@@ -1337,7 +1447,7 @@ bool Game::CheckMovePos(Unit& unit, const Vec3& pos)
 {
 	if(level->CheckCollision(unit, pos))
 	{
-		unit.node->pos = pos;
+		level->MoveUnit(unit, pos);
 		return true;
 	}
 	return false;
@@ -1393,6 +1503,8 @@ void Game::UpdateWorld(float dt)
 				zombie->node->pos.y -= 0.1f;
 				if(zombie->death_timer >= 15)
 				{
+					level->GetUnitGrid().Remove(zombie);
+					path_queue->Remove(*zombie);
 					scene->Remove(zombie->node);
 					delete zombie;
 					return true;
@@ -1419,7 +1531,7 @@ void Game::UpdateWorld(float dt)
 	});
 	
 	// spawn new zombies
-	if(level->alive_zombies < 25)
+	if(level->alive_zombies < max_zombies)
 	{
 		int chance;
 		if(game_state.hour <= 5.f || game_state.hour >= 19.f)
@@ -1495,6 +1607,7 @@ void Game::Save(FileWriter& f)
 
 void Game::LoadGame()
 {
+	res_mgr->WaitForAll();
 	try
 	{
 		FileReader f("save");
@@ -1590,8 +1703,107 @@ void Game::LoadConfig(cstring cmd_line)
 			else
 				Warn("Missing command line argument for '-config'.");
 		}
-		else if(str, "-qs")
+		else if(str == "-qs")
 			quickstart = true;
+		else if(str == "-bench")
+		{
+			benchmark = true;
+			bench_sim = true;
+			if(i + 1 < cmds.size() && cmds[i + 1][0] != '-')
+			{
+				++i;
+				if(!StringToUint(cmds[i].c_str(), bench_ticks) || bench_ticks == 0)
+				{
+					Warn("Invalid benchmark ticks count '%s'.", cmds[i].c_str());
+					bench_ticks = 3600;
+				}
+			}
+		}
+		else if(str == "-bench_scaling")
+		{
+			benchmark = true;
+			bench_sim = true;
+			bench_scaling = true;
+		}
+		else if(str == "-bench_pursuit")
+		{
+			benchmark = true;
+			bench_pursuit = true;
+		}
+		else if(str == "-bench_anim")
+		{
+			benchmark = true;
+			bench_anim = true;
+		}
+		else if(str == "-bench_render")
+		{
+			benchmark = true;
+			bench_render = true;
+		}
+		else if(str == "-bench_pipeline")
+		{
+			benchmark = true;
+			bench_pipeline = true;
+		}
+		else if(str == "-bench_jobs")
+		{
+			benchmark = true;
+			bench_jobs = true;
+		}
+		else if(str == "-bench_pool")
+		{
+			benchmark = true;
+			bench_pool = true;
+		}
+		else if(str == "-bench_file")
+		{
+			benchmark = true;
+			bench_file = true;
+		}
+		else if(str == "-bench_mesh")
+		{
+			benchmark = true;
+			bench_mesh = true;
+		}
+		else if(str == "-bench_load")
+		{
+			benchmark = true;
+			bench_load = true;
+		}
+		else if(str == "-bench_archive")
+		{
+			benchmark = true;
+			bench_archive = true;
+		}
+		else if(str == "-no_flow_field")
+			use_flow_field = false;
+		else if(str == "-no_navmesh_cache")
+			use_navmesh_cache = false;
+		else if(str == "-zombies")
+		{
+			if(i + 1 < cmds.size())
+			{
+				++i;
+				if(!StringToUint(cmds[i].c_str(), bench_zombies))
+				{
+					Warn("Invalid zombies count '%s'.", cmds[i].c_str());
+					bench_zombies = 25;
+				}
+			}
+			else
+				Warn("Missing command line argument for '-zombies'.");
+		}
+		else if(str == "-seed")
+		{
+			if(i + 1 < cmds.size())
+			{
+				++i;
+				if(!StringToUint(cmds[i].c_str(), bench_seed))
+					Warn("Invalid seed '%s'.", cmds[i].c_str());
+			}
+			else
+				Warn("Missing command line argument for '-seed'.");
+		}
 		else
 			Warn("Unknown command line switch '%s'.", str.c_str());
 	}
@@ -18,16 +18,19 @@ private:
 	void StartGame(bool load = false);
 	void ExitToMenu();
 	bool OnTick(float dt) override;
+	void OnUpdate(float dt) override;
 	void UpdateGame(float dt);
 	void UpdatePlayer(float dt);
 	void UpdateZombies(float dt);
+	void ThinkZombie(Zombie& zombie, ZombieAction& action, float dt);
+	void ApplyZombie(Zombie& zombie, ZombieAction& action, float dt);
 	float UnitRotateTo(float& rot, float expected_rot, float speed, int* dir = nullptr);
 	bool CheckForHit(Unit& unit, MeshPoint& hitbox, MeshPoint* bone, Unit*& target, Vec3& hitpoint);
 	void HitUnit(Unit& unit, int dmg, const Vec3& hitpoint);
 	bool CheckMove(Unit& uint, const Vec3& dir);
 	bool CheckMovePos(Unit& unit, const Vec3& pos);
 	void ZombieAlert(Zombie* zombie, bool first = true);
-	void SearchForTarget(Zombie* zombie);
+	void SearchForTarget(Zombie& zombie, ZombieAction& action);
 	bool CanSee(Unit& unit, const Vec3& pos);
 	void OnDebugDraw(DebugDrawer* debug_drawer);
 	void UpdateWorld(float dt);
@@ -37,6 +40,24 @@ private:
 	void Load(FileReader& f);
 	void ShowErrorMessage(cstring err);
 	void LoadConfig(cstring cmd_line);
+	int RunBenchmark();
+	bool InitBenchmarkLevel();
+	void GenerateBenchmarkCity(uint zombies);
+	void RunBenchmarkPass(uint zombies);
+	void RunPursuitBenchmark(uint agents);
+	bool RunAnimationBenchmark();
+	void RunRenderBenchmark();
+	bool RunPipelineBenchmark();
+	bool RunJobsBenchmark();
+	void RunPoolBenchmark();
+	bool RunFileBenchmark();
+	void RunMeshBenchmark();
+	void RunLoadBenchmark();
+	void RunArchiveBenchmark();
+	void UpdateBenchmark(float dt);
+	uint GetStateChecksum();
+
+	static const int level_size = 32;
 
 	unique_ptr<Engine> engine;
 	Scene* scene;
@@ -53,8 +74,18 @@ private:
 	unique_ptr<Level> level;
 	unique_ptr<CityGenerator> city_generator;
 	unique_ptr<Navmesh> navmesh;
+	unique_ptr<PathQueue> path_queue;
+	unique_ptr<FlowField> flow_field;
 	vector<std::pair<Vec3, float>> alert_pos;
-	bool in_game, allow_mouse, quickstart, draw_navmesh;
+	bool in_game, allow_mouse, quickstart, draw_navmesh, benchmark, bench_sim, bench_scaling, bench_pursuit, bench_anim, bench_render,
+		bench_pipeline, bench_jobs, bench_pool, bench_file, bench_mesh, bench_load, bench_archive, use_flow_field, use_navmesh_cache, update_game;
+	uint bench_ticks, bench_seed, bench_zombies, max_zombies;
+
+	// startup metrics, menu is ready when frame with all resources requested at init is drawn
+	Timer startup_timer;
+	float startup_time, time_to_first_frame, time_to_menu;
+	uint startup_frames;
+	bool startup_menu_loaded;
 
 	// debug pathfinding
 #ifdef _DEBUG
@@ -0,0 +1,910 @@
+#include "GameCore.h"
+#include "Game.h"
+#include <Engine.h>
+#include <Scene.h>
+#include <SceneNode.h>
+#include <Camera.h>
+#include <Mesh.h>
+#include <ParticleEmitter.h>
+#include <ResourceManager.h>
+#include "CityGenerator.h"
+#include "Level.h"
+#include "FlowField.h"
+#include "Navmesh.h"
+#include "PathQueue.h"
+#include "Player.h"
+#include "Zombie.h"
+#include <ThreadPool.h>
+#include <FramePipeline.h>
+#include <FrameArena.h>
+#include <Archive.h>
+
+const float bench_dt = 1.f / 60;
+
+// FNV-1a hash of data
+inline void HashData(uint& hash, const void* data, uint size)
+{
+	const byte* ptr = (const byte*)data;
+	for(uint i = 0; i < size; ++i)
+	{
+		hash ^= ptr[i];
+		hash *= 16777619u;
+	}
+}
+
+// run simulation of generated city without window, rendering & sound
+// usage: -bench [ticks] [-seed value] [-zombies count | -bench_scaling] [-no_flow_field] [-no_navmesh_cache]
+//        -bench_pursuit [-seed value]
+//        -bench_anim
+//        -bench_render [-seed value]
+//        -bench_pipeline [ticks] [-seed value] [-zombies count]
+//        -bench_jobs
+//        -bench_pool
+//        -bench_mesh
+//        -bench_load
+//        -bench_archive
+//        -bench_file [-seed value] [-zombies count]
+// options can be combined, requested benchmarks are run one after another in order: archive, jobs, pool, mesh, load, anim, pipeline,
+// file, render, pursuit & simulation (-bench or -bench_scaling)
+// heap allocation stats are gathered only in debug & Profile configuration (PROFILE define), otherwise they are reported as unavailable
+// returns 0 if ok, 1 if failed to initialize, 2 if benchmark results are invalid, 3 on fatal error
+int Game::RunBenchmark()
+{
+	Info("Benchmark: %u ticks, seed %u.", bench_ticks, bench_seed);
+
+	try
+	{
+		engine->InitHeadless();
+		scene = engine->GetScene();
+		input = nullptr;
+		res_mgr = engine->GetResourceManager();
+		sound_mgr = engine->GetSoundManager();
+	}
+	catch(cstring err)
+	{
+		engine->ShowError(Format("Failed to initialize benchmark: %s", err));
+		return 1;
+	}
+
+	// all requested benchmarks are run in this order
+	bool ok = true;
+	try
+	{
+		// before game resources are loaded so loose files read by it aren't in system cache yet
+		if(bench_archive)
+			RunArchiveBenchmark();
+
+		if(!(bench_sim || bench_jobs || bench_pool || bench_mesh || bench_load || bench_anim || bench_pipeline || bench_file || bench_render
+			|| bench_pursuit))
+			return 0;
+		if(!InitBenchmarkLevel())
+			return 1;
+
+		if(bench_jobs)
+			ok = RunJobsBenchmark() && ok;
+		if(bench_pool)
+			RunPoolBenchmark();
+		if(bench_mesh)
+			RunMeshBenchmark();
+		if(bench_load)
+			RunLoadBenchmark();
+		if(bench_anim)
+			ok = RunAnimationBenchmark() && ok;
+		if(bench_pipeline)
+			ok = RunPipelineBenchmark() && ok;
+		if(bench_file)
+		{
+			GenerateBenchmarkCity(bench_zombies);
+			ok = RunFileBenchmark() && ok;
+			city_generator->WaitForNavmeshThread();
+		}
+		if(bench_render)
+		{
+			GenerateBenchmarkCity(bench_zombies);
+			RunRenderBenchmark();
+			city_generator->WaitForNavmeshThread();
+		}
+		if(bench_pursuit)
+		{
+			GenerateBenchmarkCity(0);
+			for(uint count : { 100u, 1000u, 5000u })
+				RunPursuitBenchmark(count);
+			city_generator->WaitForNavmeshThread();
+		}
+		if(bench_sim)
+		{
+			if(bench_scaling)
+			{
+				for(uint count : { 25u, 100u, 500u, 1000u, 2500u, 5000u })
+					RunBenchmarkPass(count);
+			}
+			else
+				RunBenchmarkPass(bench_zombies);
+		}
+	}
+	catch(cstring err)
+	{
+		engine->ShowError(Format("Fatal error when running benchmark: %s", err));
+		return 3;
+	}
+
+	return ok ? 0 : 2;
+}
+
+// create level, navmesh & city generator and load game resources, returns false on failure
+bool Game::InitBenchmarkLevel()
+{
+	try
+	{
+		level.reset(new Level);
+		level->Init(scene, res_mgr, &game_state, CityGenerator::tile_size * level_size);
+		game_state.level = level.get();
+		game_state.engine = engine.get();
+		game_state.config = config;
+
+		navmesh.reset(new Navmesh);
+		if(use_navmesh_cache)
+			navmesh->LoadCache("navmesh.cache");
+		path_queue.reset(new PathQueue);
+		path_queue->Init(navmesh.get(), engine->GetThreadPool());
+		flow_field.reset(new FlowField);
+		flow_field->Init(navmesh.get());
+		LoadResources();
+		res_mgr->WaitForAll();
+
+		city_generator.reset(new CityGenerator);
+		city_generator->Init(scene, level.get(), res_mgr, engine->GetThreadPool(), level_size, 3, navmesh.get());
+	}
+	catch(cstring err)
+	{
+		engine->ShowError(Format("Failed to initialize benchmark: %s", err));
+		return false;
+	}
+	return true;
+}
+
+// generate same city for each benchmark, starting at 16:30
+void Game::GenerateBenchmarkCity(uint zombies)
+{
+	path_queue->Clear();
+	flow_field->Clear();
+	city_generator->Reset();
+	alert_pos.clear();
+	Srand(bench_seed);
+
+	Timer timer;
+	city_generator->Generate(zombies);
+	float generate_time = timer.Tick();
+	city_generator->FinishNavmeshGeneration();
+	float navmesh_time = timer.Tick();
+	Info("Benchmark: City generated in %g sec, navmesh in %g sec.", generate_time, navmesh_time);
+
+	max_zombies = zombies;
+	game_state.day = 0;
+	game_state.last_hour = 16;
+	game_state.hour = 16.50f;
+}
+
+void Game::RunBenchmarkPass(uint zombies)
+{
+	GenerateBenchmarkCity(zombies);
+
+	HeapStats start_stats = HeapStats::Get();
+	HeapStats::ResetPeak();
+
+	double total = 0.0;
+	float min_time = 1e9f, max_time = 0.f;
+	uint64 last_allocs = start_stats.allocs, max_allocs = 0;
+	Timer timer;
+	for(uint i = 0; i < bench_ticks; ++i)
+	{
+		UpdateBenchmark(bench_dt);
+		float t = timer.Tick();
+		total += t;
+		min_time = min(min_time, t);
+		max_time = max(max_time, t);
+
+		uint64 allocs = HeapStats::Get().allocs;
+		max_allocs = max(max_allocs, allocs - last_allocs);
+		last_allocs = allocs;
+		FrameArena::NextFrame();
+	}
+
+	HeapStats end_stats = HeapStats::Get();
+	uint64 allocs = end_stats.allocs - start_stats.allocs;
+	Info("Benchmark: %u zombies - %g ms/tick (min %g ms, max %g ms), total %g sec.", zombies, total * 1000 / bench_ticks, min_time * 1000,
+		max_time * 1000, total);
+	if(HeapStats::IsEnabled())
+		Info("Benchmark: %g allocations/tick (%I64u total, max %I64u in tick), peak heap %g MB, at end %g MB, frame arena peak %u KB.",
+			double(allocs) / bench_ticks, allocs, max_allocs, double(end_stats.peak_size) / (1024 * 1024), double(end_stats.size) / (1024 * 1024),
+			FrameArena::GetFramePeakSize() / 1024);
+	else
+		Info("Benchmark: allocations & heap stats unavailable (build with PROFILE define or use Profile configuration), frame arena peak %u KB.",
+			FrameArena::GetFramePeakSize() / 1024);
+	Info("Benchmark: %u zombies at end (%u alive), state checksum %08X.", level->zombies.size(), level->alive_zombies, GetStateChecksum());
+	const ObjectPoolStats& pe_stats = ParticleEmitter::GetPoolStats();
+	Info("Benchmark: particle emitters - %u live, %u peak, %u allocated in %u slabs, %I64u gets.", pe_stats.live, pe_stats.peak,
+		pe_stats.allocated, pe_stats.slabs, pe_stats.gets);
+
+	city_generator->WaitForNavmeshThread();
+}
+
+// compare finding path for each agent chasing player with single flow field
+void Game::RunPursuitBenchmark(uint agents)
+{
+	// random agents positions on navmesh around player
+	Vec3 target = level->player->node->pos;
+	vector<Vec3> positions;
+	positions.reserve(agents);
+	for(uint tries = 0; positions.size() < agents && tries < agents * 10; ++tries)
+	{
+		float angle = Random(0.f, PI * 2),
+			dist = Random(5.f, 50.f);
+		Vec3 pos = target + Vec3(cos(angle) * dist, 0, sin(angle) * dist);
+		pos.y = city_generator->GetY(pos);
+		if(navmesh->GetPolyRef(pos) != 0)
+			positions.push_back(pos);
+	}
+
+	// path search for each agent (old way)
+	Timer timer;
+	vector<Vec3> path;
+	uint paths = 0;
+	for(const Vec3& pos : positions)
+	{
+		if(navmesh->FindPath(pos, target, path))
+			++paths;
+	}
+	float path_time = timer.Tick();
+
+	// build flow field once, all agents sample it
+	flow_field->Clear();
+	flow_field->Update(target);
+	float build_time = timer.Tick();
+	vector<Vec3> points(positions.size());
+	vector<byte> ok(positions.size());
+	engine->GetThreadPool()->ParallelFor(positions.size(), [&](uint index)
+	{
+		const Vec3& pos = positions[index];
+		dtPolyRef ref = navmesh->GetPolyRef(pos, ThreadPool::GetThreadIndex());
+		ok[index] = flow_field->GetNextPoint(ref, pos, points[index]) ? 1 : 0;
+	});
+	float sample_time = timer.Tick();
+	uint reached = std::count(ok.begin(), ok.end(), 1);
+
+	Info("Pursuit benchmark: %u agents - paths %g ms (%u found), flow field %g ms build + %g ms sample (%u reached, %u polygons).",
+		positions.size(), path_time * 1000, paths, build_time * 1000, sample_time * 1000, reached, flow_field->GetReachedCount());
+}
+
+// compare scalar calculation of bones matrices (as in MeshInstance::SetupBones before) with vectorized one
+// returns false when vectorized results don't match scalar ones
+bool Game::RunAnimationBenchmark()
+{
+	const uint samples = 20000;
+	Matrix mats[33], mats2[33];
+	bool ok = true;
+	for(cstring name : { "units/zombie.qmsh", "units/human.qmsh" })
+	{
+		Mesh* mesh = res_mgr->GetMesh(name);
+		const uint n_bones = mesh->head.n_bones;
+		uint64 bones = 0;
+		float checksum = 0.f, checksum2 = 0.f;
+
+		// scalar
+		Timer timer;
+		Mesh::KeyframeBone tmp_keyf;
+		for(Mesh::Animation& anim : mesh->anims)
+		{
+			for(uint i = 0; i < samples; ++i)
+			{
+				const float time = anim.length * i / samples;
+				bool hit;
+				const int index = anim.GetFrameIndex(time, hit);
+				if(hit)
+				{
+					for(uint b = 1; b < n_bones; ++b)
+						anim.GetFrameBones(index)[b - 1].Mix(mats[b], mesh->bones[b].mat);
+				}
+				else
+				{
+					const float t = (time - anim.frames[index].time) / (anim.frames[index + 1].time - anim.frames[index].time);
+					for(uint b = 1; b < n_bones; ++b)
+					{
+						Mesh::KeyframeBone::Interpolate(tmp_keyf, anim.GetFrameBones(index)[b - 1], anim.GetFrameBones(index + 1)[b - 1], t);
+						tmp_keyf.Mix(mats[b], mesh->bones[b].mat);
+					}
+				}
+				checksum += mats[n_bones - 1]._41;
+			}
+			bones += samples * (n_bones - 1);
+		}
+		float scalar_time = timer.Tick();
+
+		// vectorized
+		for(Mesh::Animation& anim : mesh->anims)
+		{
+			for(uint i = 0; i < samples; ++i)
+			{
+				mesh->GetAnimationMatrices(anim, anim.length * i / samples, mats2);
+				checksum2 += mats2[n_bones - 1]._41;
+			}
+		}
+		float vector_time = timer.Tick();
+
+		// verify results
+		float max_diff = 0.f;
+		for(Mesh::Animation& anim : mesh->anims)
+		{
+			for(uint i = 0; i < samples; i += 97)
+			{
+				const float time = anim.length * i / samples;
+				mesh->GetAnimationMatrices(anim, time, mats2);
+				for(uint b = 1; b < n_bones; ++b)
+				{
+					anim.GetKeyframeData(b, time, tmp_keyf);
+					tmp_keyf.Mix(mats[b], mesh->bones[b].mat);
+					for(int j = 0; j < 16; ++j)
+						max_diff = max(max_diff, abs(mats[b].m[j / 4][j % 4] - mats2[b].m[j / 4][j % 4]));
+				}
+			}
+		}
+
+		Info("Animation benchmark: %s (%u bones, %u animations) - scalar %g Mbones/sec, vectorized %g Mbones/sec, max difference %g "
+			"(checksum %g/%g).", name, n_bones - 1, mesh->anims.size(), bones / (scalar_time * 1000000), bones / (vector_time * 1000000),
+			max_diff, checksum, checksum2);
+		if(max_diff > 0.001f)
+		{
+			Error("Animation benchmark: %s vectorized bones matrices don't match scalar ones.", name);
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+// compare draw calls & state changes of sorted render queue with drawing nodes one by one, camera is rotated around player
+void Game::RunRenderBenchmark()
+{
+	const uint frames = 360;
+	Camera* cam = scene->GetCamera();
+	cam->zfar = 50.f;
+	const Vec3 target = level->player->node->pos + Vec3(0, 1.7f, 0);
+
+	uint64 nodes = 0, batches = 0, draw_calls = 0, state_changes = 0, unsorted_draw_calls = 0, unsorted_state_changes = 0;
+	Timer timer;
+	for(uint i = 0; i < frames; ++i)
+	{
+		const float angle = PI * 2 * i / frames;
+		cam->to = target;
+		cam->from = target + Vec3(cos(angle) * 4, 1.5f, sin(angle) * 4);
+		scene->Update(bench_dt);
+		scene->Prepare();
+
+		const RenderQueue::Stats stats = scene->GetRenderStats();
+		nodes += stats.nodes;
+		batches += stats.batches;
+		draw_calls += stats.draw_calls;
+		state_changes += stats.state_changes;
+		unsorted_draw_calls += stats.unsorted_draw_calls;
+		unsorted_state_changes += stats.unsorted_state_changes;
+	}
+	float time = timer.Tick();
+
+	Info("Render benchmark: %g ms/frame, %g visible nodes in %g batches.", time * 1000 / frames, double(nodes) / frames, double(batches) / frames);
+	Info("Render benchmark: draw calls %g -> %g, state changes %g -> %g per frame.", double(unsorted_draw_calls) / frames,
+		double(draw_calls) / frames, double(unsorted_state_changes) / frames, double(state_changes) / frames);
+}
+
+// run same simulation serially & with render snapshot consumed while next tick is simulated on pipeline thread,
+// snapshots & final state must be identical, returns false if they aren't
+bool Game::RunPipelineBenchmark()
+{
+	FramePipeline* pipeline = engine->GetFramePipeline();
+	Camera* cam = scene->GetCamera();
+	cam->zfar = 50.f;
+	uint snapshot_hash[2], state_hash[2];
+	float times[2];
+
+	for(int pass = 0; pass < 2; ++pass)
+	{
+		const bool parallel = (pass == 1);
+		GenerateBenchmarkCity(bench_zombies);
+
+		// main thread only reads snapshot (instead of drawing it)
+		uint hash = 2166136261u;
+		auto consume = [&]
+		{
+			for(int i = 0; i < 2; ++i)
+			{
+				const RenderQueue& queue = scene->GetRenderQueue(i == 1);
+				for(const RenderQueue::Batch& batch : queue.GetBatches())
+					HashData(hash, &batch.count, sizeof(uint));
+				if(!queue.GetMatrices().empty())
+					HashData(hash, queue.GetMatrices().data(), sizeof(Matrix) * queue.GetMatrices().size());
+				if(!queue.GetBones().empty())
+					HashData(hash, queue.GetBones().data(), sizeof(Matrix) * queue.GetBones().size());
+			}
+		};
+
+		Timer timer;
+		for(uint i = 0; i < bench_ticks; ++i)
+		{
+			const Vec3 pos = level->player->node->pos;
+			cam->to = pos + Vec3(0, 1.7f, 0);
+			cam->from = pos + Vec3(cos(i * 0.01f) * 4, 3.2f, sin(i * 0.01f) * 4);
+			scene->Prepare();
+			if(parallel)
+			{
+				pipeline->Start([this] { UpdateBenchmark(bench_dt); });
+				consume();
+				pipeline->Wait();
+			}
+			else
+			{
+				consume();
+				UpdateBenchmark(bench_dt);
+			}
+			FrameArena::NextFrame();
+		}
+		times[pass] = timer.Tick();
+		snapshot_hash[pass] = hash;
+		state_hash[pass] = GetStateChecksum();
+		city_generator->WaitForNavmeshThread();
+
+		Info("Pipeline benchmark: %s - %g ms/tick, snapshots checksum %08X, state checksum %08X.", parallel ? "parallel" : "serial",
+			times[pass] * 1000 / bench_ticks, snapshot_hash[pass], state_hash[pass]);
+	}
+
+	if(!pipeline->IsParallel())
+		Warn("Pipeline benchmark: Pipeline thread not started, both passes were serial.");
+	if(snapshot_hash[0] != snapshot_hash[1] || state_hash[0] != state_hash[1])
+	{
+		Error("Pipeline benchmark: Parallel pipeline results don't match serial ones.");
+		return false;
+	}
+	Info("Pipeline benchmark: Results match, speedup %g.", times[0] / times[1]);
+	return true;
+}
+
+// job system microbenchmarks - empty job overhead, parallel for scaling, stealing of uneven jobs & dependencies,
+// returns false if parallel results are wrong
+bool Game::RunJobsBenchmark()
+{
+	ThreadPool* thread_pool = engine->GetThreadPool();
+	const uint max_threads = thread_pool->GetThreadsCount();
+	bool ok = true;
+
+	// overhead of submitting & executing empty job
+	{
+		const uint jobs = 200000;
+		ThreadPool::Counter counter;
+		thread_pool->ResetStats();
+		Timer timer;
+		for(uint i = 0; i < jobs; ++i)
+			thread_pool->Submit([] {}, &counter);
+		thread_pool->Wait(counter);
+		float time = timer.Tick();
+		ThreadPool::Stats stats = thread_pool->GetStats();
+		Info("Jobs benchmark: %u empty jobs - %g ns/job (%I64u stolen).", jobs, time * 1000000000 / jobs, stats.stolen);
+	}
+
+	// parallel for scaling, separate pool for each threads count
+	{
+		const uint count = 1000000;
+		vector<float> data(count);
+		auto work = [&data](uint index)
+		{
+			float x = float(index);
+			for(int i = 0; i < 64; ++i)
+				x = sqrt(x * 1.0001f + 1.f);
+			data[index] = x;
+		};
+
+		Timer timer;
+		for(uint i = 0; i < count; ++i)
+			work(i);
+		const float serial_time = timer.Tick();
+		const float expected = data[count - 1];
+		Info("Jobs benchmark: parallel for %u items - serial %g ms.", count, serial_time * 1000);
+
+		for(uint threads = 2; threads <= max_threads; threads *= 2)
+		{
+			ThreadPool pool;
+			pool.Init(threads - 1);
+			data.assign(count, 0.f);
+			timer.Tick();
+			pool.ParallelFor(count, work);
+			float time = timer.Tick();
+			Info("Jobs benchmark: parallel for %u items - %u threads %g ms, speedup %g.", count, threads, time * 1000, serial_time / time);
+			if(data[count - 1] != expected)
+			{
+				Error("Jobs benchmark: Parallel for results don't match serial ones.");
+				ok = false;
+			}
+		}
+	}
+
+	// jobs of uneven size are submitted from main thread, workers must steal them
+	{
+		const uint jobs = 2000;
+		std::atomic<uint64> total(0);
+		ThreadPool::Counter counter;
+		thread_pool->ResetStats();
+		Timer timer;
+		for(uint i = 0; i < jobs; ++i)
+		{
+			const uint size = (i % 16 == 0) ? 100000 : 1000;
+			thread_pool->Submit([&total, size]
+			{
+				uint64 sum = 0;
+				for(uint j = 0; j < size; ++j)
+					sum += j ^ (sum >> 3);
+				total += sum;
+			}, &counter);
+		}
+		thread_pool->Wait(counter);
+		float time = timer.Tick();
+		ThreadPool::Stats stats = thread_pool->GetStats();
+		Info("Jobs benchmark: %u uneven jobs - %g ms, %I64u of %I64u stolen (%g%%), %u threads (checksum %I64u).", jobs, time * 1000,
+			stats.stolen, stats.jobs, stats.jobs ? 100. * stats.stolen / stats.jobs : 0., max_threads, total.load());
+	}
+
+	// dependencies, each stage must see all jobs of previous stage done
+	{
+		const uint stages = 100, jobs_per_stage = 64;
+		std::atomic<uint> done(0), errors(0);
+		ThreadPool::Counter* prev = nullptr;
+		Timer timer;
+		for(uint stage = 0; stage < stages; ++stage)
+		{
+			ThreadPool::Counter* counter = thread_pool->GetFrameCounter();
+			thread_pool->SubmitFor(jobs_per_stage, [&done, &errors, stage](uint)
+			{
+				if(done / jobs_per_stage != stage)
+					++errors;
+			}, counter, prev, 1);
+			ThreadPool::Counter* stage_done = thread_pool->GetFrameCounter();
+			thread_pool->Submit([&done] { done += jobs_per_stage; }, stage_done, counter);
+			prev = stage_done;
+		}
+		thread_pool->EndFrame();
+		float time = timer.Tick();
+		Info("Jobs benchmark: %u dependent stages of %u jobs - %g ms.", stages, jobs_per_stage, time * 1000);
+		if(errors != 0)
+		{
+			Error("Jobs benchmark: %u jobs started before dependency was done.", errors.load());
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+// compare object pool guarded by mutex with thread safe pool, each thread takes & frees batches of strings,
+// every second batch is freed by next thread so magazines must go through depot
+void Game::RunPoolBenchmark()
+{
+	const uint batches = 20000, batch_size = 48;
+
+	for(uint threads_count : { 1u, 2u, 4u, 8u, 16u })
+	{
+		float times[2];
+		ConcurrentObjectPool<string>::Stats stats;
+		for(int pass = 0; pass < 2; ++pass)
+		{
+			ObjectPool<string> locked_pool;
+			std::mutex mutex;
+			ConcurrentObjectPool<string> pool;
+			vector<vector<string*>> handoff(threads_count);
+			vector<std::mutex> handoff_mutex(threads_count);
+
+			auto work = [&](uint index)
+			{
+				vector<string*> items, received;
+				for(uint i = 0; i < batches; ++i)
+				{
+					for(uint j = 0; j < batch_size; ++j)
+					{
+						if(pass == 0)
+						{
+							std::lock_guard<std::mutex> lock(mutex);
+							items.push_back(locked_pool.Get());
+						}
+						else
+							items.push_back(pool.Get());
+						items.back()->assign(1, char(j));
+					}
+					if(i % 2 == 1)
+					{
+						// give batch to next thread & free one received from previous
+						uint next = (index + 1) % threads_count;
+						{
+							std::lock_guard<std::mutex> lock(handoff_mutex[next]);
+							handoff[next].insert(handoff[next].end(), items.begin(), items.end());
+						}
+						items.clear();
+						std::lock_guard<std::mutex> lock(handoff_mutex[index]);
+						received.swap(handoff[index]);
+					}
+					vector<string*>& to_free = received.empty() ? items : received;
+					if(pass == 0)
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						locked_pool.Free(to_free);
+					}
+					else
+						pool.Free(to_free);
+				}
+				if(pass == 0)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					locked_pool.Free(items);
+				}
+				else
+					pool.Free(items);
+			};
+
+			Timer timer;
+			vector<std::thread> threads;
+			for(uint i = 1; i < threads_count; ++i)
+				threads.push_back(std::thread(work, i));
+			work(0);
+			for(std::thread& thread : threads)
+				thread.join();
+			times[pass] = timer.Tick();
+
+			// free strings left in handoff lists
+			for(vector<string*>& items : handoff)
+			{
+				if(pass == 0)
+					locked_pool.Free(items);
+				else
+					pool.Free(items);
+			}
+			if(pass == 1)
+				stats = pool.GetStats();
+		}
+
+		const double ops = 2.0 * batches * batch_size * threads_count;
+		Info("Pool benchmark: %u threads - mutex %g Mops/sec, concurrent %g Mops/sec (speedup %g), allocated %u, depot %u gets/%u puts, "
+			"%u retries.", threads_count, ops / (times[0] * 1000000), ops / (times[1] * 1000000), times[0] / times[1], stats.allocated,
+			stats.depot_gets, stats.depot_puts, stats.retries);
+	}
+}
+
+// save & load level with each file mode, measure throughput & number of system calls, returns false if loaded state don't match
+bool Game::RunFileBenchmark()
+{
+	const uint passes = 10;
+	cstring filename = "bench.sav";
+	const uint checksum = GetStateChecksum();
+	uint file_size = 0;
+	bool ok = true;
+
+	for(FileWriter::Mode mode : { FileWriter::UNBUFFERED, FileWriter::BUFFERED })
+	{
+		uint64 syscalls = io::GetSyscallsCount();
+		Timer timer;
+		for(uint i = 0; i < passes; ++i)
+		{
+			FileWriter f(filename, mode);
+			if(!f)
+				throw Format("Failed to open file '%s'.", filename);
+			level->Save(f);
+			city_generator->Save(f);
+			file_size = f.GetSize();
+		}
+		float time = timer.Tick();
+		syscalls = io::GetSyscallsCount() - syscalls;
+		Info("File benchmark: save %s - %g MB/s, %I64u syscalls/save (%u KB).", mode == FileWriter::BUFFERED ? "buffered" : "unbuffered",
+			double(file_size) * passes / (time * 1024 * 1024), syscalls / passes, file_size / 1024);
+	}
+
+	cstring mode_names[] = { "unbuffered", "buffered", "mapped" };
+	for(FileReader::Mode mode : { FileReader::UNBUFFERED, FileReader::BUFFERED, FileReader::MAPPED })
+	{
+		float time = 0.f;
+		uint64 syscalls = 0;
+		for(uint i = 0; i < passes; ++i)
+		{
+			city_generator->Reset();
+			uint64 start_syscalls = io::GetSyscallsCount();
+			Timer timer;
+			{
+				FileReader f(filename, mode);
+				if(!f)
+					throw Format("Failed to open file '%s'.", filename);
+				level->Load(f);
+				city_generator->Load(f);
+				if(!f)
+					throw "Broken file.";
+			}
+			time += timer.Tick();
+			syscalls += io::GetSyscallsCount() - start_syscalls;
+			city_generator->FinishNavmeshGeneration();
+		}
+		const uint new_checksum = GetStateChecksum();
+		Info("File benchmark: load %s - %g MB/s, %I64u syscalls/load, state checksum %s.", mode_names[mode],
+			double(file_size) * passes / (time * 1024 * 1024), syscalls / passes, new_checksum == checksum ? "match" : "MISMATCH");
+		if(new_checksum != checksum)
+		{
+			Error("File benchmark: State loaded in %s mode don't match saved one.", mode_names[mode]);
+			ok = false;
+		}
+	}
+
+	io::DeleteFile(filename);
+	return ok;
+}
+
+// load all meshes from Data without caching (raw mode, works headless)
+void Game::RunMeshBenchmark()
+{
+	const uint passes = 10;
+	vector<string> files;
+	io::FindFiles("Data", "qmsh", files);
+	if(files.empty())
+		throw "No meshes found in 'Data'.";
+
+	uint64 total_size = 0;
+	for(const string& file : files)
+	{
+		FileReader f(Format("Data/%s", file.c_str()));
+		total_size += f.GetSize();
+	}
+
+	cstring mode_names[] = { "unbuffered", "buffered", "mapped" };
+	for(FileReader::Mode mode : { FileReader::UNBUFFERED, FileReader::BUFFERED, FileReader::MAPPED })
+	{
+		uint64 syscalls = io::GetSyscallsCount();
+		uint64 allocs = HeapStats::Get().allocs;
+		Timer timer;
+		for(uint i = 0; i < passes; ++i)
+		{
+			for(const string& file : files)
+			{
+				Mesh* mesh = res_mgr->LoadMeshRaw(file, mode);
+				delete mesh;
+			}
+		}
+		float time = timer.Tick();
+		syscalls = io::GetSyscallsCount() - syscalls;
+		allocs = HeapStats::Get().allocs - allocs;
+		const uint loads = passes * files.size();
+		Info("Mesh benchmark: %s - %g ms/pass, %g MB/s, %I64u syscalls/mesh, %s allocations/mesh (%u meshes, %u KB).", mode_names[mode],
+			time * 1000 / passes, double(total_size) * passes / (time * 1024 * 1024), syscalls / loads,
+			HeapStats::IsEnabled() ? Format("%I64u", allocs / loads) : "n/a", files.size(), uint(total_size / 1024));
+	}
+}
+
+// load all meshes from Data with new resource manager, synchronously & streamed by worker threads
+// in headless mode meshes are fully decoded, textures requested by meshes are only read in async mode
+void Game::RunLoadBenchmark()
+{
+	vector<string> files;
+	io::FindFiles("Data", "qmsh", files);
+	if(files.empty())
+		throw "No meshes found in 'Data'.";
+
+	for(int async = 0; async < 2; ++async)
+	{
+		ResourceManager res;
+		res.Init(nullptr, nullptr, engine->GetThreadPool());
+		Timer timer;
+		for(uint i = 0, count = files.size(); i < count; ++i)
+		{
+			// first meshes are needed first
+			ResourceManager::Priority priority = (i < count / 4 ? ResourceManager::Priority::High : ResourceManager::Priority::Normal);
+			if(async)
+				res.GetMeshAsync(files[i], priority);
+			else
+				res.GetMesh(files[i]);
+		}
+		float blocked = timer.Tick();
+		res.WaitForAll();
+		float total = blocked + timer.Tick();
+		Info("Load benchmark: %s - %u meshes, caller blocked for %g ms, all ready after %g ms.", async ? "async" : "sync", files.size(),
+			blocked * 1000, total * 1000);
+	}
+}
+
+// load all meshes (with textures) from loose files & from archive (stored & compressed), first pass is closest to cold start
+// loose files are measured first, before game resources are loaded; archives should be prebuilt by packer (bench.pak &
+// -compress bench_compressed.pak), missing ones are packed outside of timing but then their first pass is done with warm cache
+// for true cold start numbers flush system cache & run benchmark in separate process for each source
+void Game::RunArchiveBenchmark()
+{
+	const uint passes = 5;
+	vector<string> files, meshes;
+	io::FindFiles("Data", "qmsh", meshes);
+	if(meshes.empty())
+		throw "No meshes found in 'Data'.";
+
+	cstring archives[2] = { "bench.pak", "bench_compressed.pak" };
+	bool packed[2] = {};
+	cstring sources[3] = { "loose files", "archive", "compressed archive" };
+	for(int source = 0; source < 3; ++source)
+	{
+		const int archive = source - 1;
+		if(source != 0 && !io::FileExists(archives[archive]))
+		{
+			if(files.empty())
+				io::FindFiles("Data", "", files);
+			Timer timer;
+			Archive::Stats stats;
+			Archive::Create(archives[archive], "Data", files, archive == 1, &stats);
+			Info("Archive benchmark: packed %u files (%u compressed), %u KB -> %u KB in %g ms.", stats.files, stats.compressed,
+				stats.size / 1024, stats.packed_size / 1024, timer.Tick() * 1000);
+			packed[archive] = true;
+		}
+
+		float first = 0, total = 0;
+		uint64 first_syscalls = 0;
+		for(uint pass = 0; pass < passes; ++pass)
+		{
+			const uint64 syscalls = io::GetSyscallsCount();
+			Timer timer;
+			{
+				ResourceManager res;
+				res.Init(nullptr, nullptr, engine->GetThreadPool());
+				if(source != 0)
+					res.Mount(archives[archive]);
+				for(const string& mesh : meshes)
+					res.GetMeshAsync(mesh);
+				res.WaitForAll();
+			}
+			const float time = timer.Tick() * 1000;
+			if(pass == 0)
+			{
+				first = time;
+				first_syscalls = io::GetSyscallsCount() - syscalls;
+			}
+			else
+				total += time;
+		}
+		Info("Archive benchmark: %s - %u meshes, first load %g ms%s (%I64u syscalls), next loads %g ms.", sources[source], meshes.size(), first,
+			source != 0 && packed[archive] ? " with warm cache" : "", first_syscalls, total / (passes - 1));
+	}
+
+	for(int i = 0; i < 2; ++i)
+	{
+		if(packed[i])
+			io::DeleteFile(archives[i]);
+	}
+}
+
+// same as UpdateGame without player input, camera & sky
+void Game::UpdateBenchmark(float dt)
+{
+	city_generator->CheckNavmeshGeneration();
+	UpdateZombies(dt);
+	level->Update(dt);
+	UpdateWorld(dt);
+
+	game_state.hour += dt / 60;
+	if(game_state.hour >= 24.f)
+	{
+		game_state.hour -= 24.f;
+		++game_state.day;
+	}
+
+	scene->Update(dt);
+}
+
+// hash of units state, used to verify that simulation is deterministic
+uint Game::GetStateChecksum()
+{
+	uint hash = 2166136261u;
+	auto add = [&hash](const void* data, uint size) { HashData(hash, data, size); };
+
+	Player* player = level->player;
+	add(&player->node->pos, sizeof(Vec3));
+	add(&player->hp, sizeof(int));
+	for(Zombie* zombie : level->zombies)
+	{
+		add(&zombie->node->pos, sizeof(Vec3));
+		add(&zombie->node->rot.y, sizeof(float));
+		add(&zombie->hp, sizeof(int));
+		add(&zombie->state, sizeof(AiState));
+	}
+	return hash;
+}
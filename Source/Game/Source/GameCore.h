@@ -1,9 +1,13 @@
 #pragma once
 
 #include "EngineCore.h"
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
 #include <thread>
 
 class CityGenerator;
+class FlowField;
 class Game;
 class GameGui;
 class GameState;
@@ -12,6 +16,7 @@ class Level;
 class MainMenu;
 class Navmesh;
 class Options;
+class PathQueue;
 class PickPerkDialog;
 class StatsPanel;
 
@@ -22,6 +27,7 @@ struct Player;
 struct ThirdPersonCamera;
 struct Unit;
 struct Zombie;
+struct ZombieAction;
 
 enum class PerkId;
 
@@ -32,6 +38,7 @@ class dtNavMeshQuery;
 class dtQueryFilter;
 struct dtMeshTile;
 struct rcCompactHeightfield;
+struct rcConfig;
 struct rcContourSet;
 struct rcHeightfield;
 struct rcPolyMesh;
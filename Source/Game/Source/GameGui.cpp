@@ -6,7 +6,10 @@
 #include <GuiControls.h>
 #include <ResourceManager.h>
 #include <Input.h>
+#include <Scene.h>
 #include <SceneNode.h>
+#include <MeshInstance.h>
+#include <FrameArena.h>
 #include "GroundItem.h"
 #include "Item.h"
 #include "Inventory.h"
@@ -259,6 +262,15 @@ void GameGui::Update(float dt)
 #else
 		label_fps->text = Format("Fps: %g", FLT10(engine->GetFps()));
 #endif
+		const Scene::AnimationStats& anim_stats = engine->GetScene()->GetAnimationStats();
+		label_fps->text += Format("\nBones: %u/%u/%u updated, %u skipped", anim_stats.updated[ANIM_LOD_FULL], anim_stats.updated[ANIM_LOD_HALF],
+			anim_stats.updated[ANIM_LOD_QUARTER], anim_stats.skipped);
+		// allocations are counted only in debug & profile build
+		if(HeapStats::IsEnabled())
+			label_fps->text += Format("\nAllocations: %u/frame, arena peak %u KB", engine->GetFrameAllocs(),
+				FrameArena::GetFramePeakSize() / 1024);
+		else
+			label_fps->text += Format("\nAllocations: n/a, arena peak %u KB", FrameArena::GetFramePeakSize() / 1024);
 		label_fps->size = label_fps->CalculateSize();
 		Int2 panel_size = label_fps->size + Int2(2 * panel_fps->layout.corners.x, 2 * panel_fps->layout.corners.x);
 		if(panel_size > panel_fps->size)
@@ -16,9 +16,10 @@ Item* Item::Get(Cstring id)
 {
 	if(id[0] == 0)
 		return nullptr;
+	const NameId id_name = NameTable::Find(id);
 	for(Item& item : items)
 	{
-		if(item.id == id)
+		if(item.id_name == id_name)
 			return &item;
 	}
 	throw Format("Missing item '%s'.", id);
@@ -30,16 +31,19 @@ void Item::LoadData(ResourceManager* res_mgr)
 	{
 		if(item.mesh_id)
 		{
-			item.mesh = res_mgr->GetMesh(item.mesh_id);
-			Mesh::Point* point = item.mesh->FindPoint("ground");
-			if(point)
+			item.mesh = res_mgr->GetMeshAsync(item.mesh_id);
+			res_mgr->OnLoaded(item.mesh, [&item](Resource*)
 			{
-				item.ground_offset = Vec3::TransformZero(point->mat);
-				item.ground_rot = point->rot;
-				item.ground_rot.y = -item.ground_rot.y;
-			}
+				Mesh::Point* point = item.mesh->FindPoint("ground");
+				if(point)
+				{
+					item.ground_offset = Vec3::TransformZero(point->mat);
+					item.ground_rot = point->rot;
+					item.ground_rot.y = -item.ground_rot.y;
+				}
+			});
 		}
 		if(item.icon_id)
-			item.icon = res_mgr->GetTexture(item.icon_id);
+			item.icon = res_mgr->GetTextureAsync(item.icon_id, ResourceManager::Priority::Low);
 	}
 }
@@ -11,6 +11,9 @@
 #include "GameState.h"
 #include <DebugDrawer.h>
 
+const float unit_grid_cell_size = 2.f;
+static const NameId point_center = NameTable::Add("centrum");
+
 Level::Level() : player(nullptr)
 {
 }
@@ -30,6 +33,7 @@ void Level::Init(Scene* scene, ResourceManager* res_mgr, GameState* game_state,
 	tile_size = level_size / grids;
 
 	colliders.resize(grids * grids);
+	unit_grid.Init(level_size, unit_grid_cell_size);
 	alive_zombies = 0;
 }
 
@@ -44,18 +48,19 @@ void Level::Reset()
 		cols.clear();
 	barriers.clear();
 	active_bloods.clear();
+	unit_grid.Clear();
 	bloods.clear();
 	alive_zombies = 0;
 }
 
 void Level::LoadResources()
 {
-	mesh_human = res_mgr->GetMesh("units/human.qmsh");
-	mesh_zombie = res_mgr->GetMesh("units/zombie.qmsh");
-	mesh_hair = res_mgr->GetMesh("units/hair.qmsh");
-	mesh_clothes = res_mgr->GetMesh("items/clothes.qmsh");
-	mesh_blood_pool = res_mgr->GetMesh("particles/blood_pool.qmsh");
-	mesh_zombie_blood_pool = res_mgr->GetMesh("particles/zombie_blood_pool.qmsh");
+	mesh_human = res_mgr->GetMeshAsync("units/human.qmsh");
+	mesh_zombie = res_mgr->GetMeshAsync("units/zombie.qmsh");
+	mesh_hair = res_mgr->GetMeshAsync("units/hair.qmsh");
+	mesh_clothes = res_mgr->GetMeshAsync("items/clothes.qmsh");
+	mesh_blood_pool = res_mgr->GetMeshAsync("particles/blood_pool.qmsh");
+	mesh_zombie_blood_pool = res_mgr->GetMeshAsync("particles/zombie_blood_pool.qmsh");
 }
 
 void Level::SpawnItem(const Vec3& pos, Item* item)
@@ -88,6 +93,7 @@ void Level::SpawnZombie(const Vec3& pos)
 	zombie->node->mesh_inst->Play("stoi", 0, 0);
 	zombie->node->mesh_inst->SetToEnd();
 	zombies.push_back(zombie);
+	unit_grid.Add(zombie);
 
 	scene->Add(zombie->node);
 	++alive_zombies;
@@ -105,6 +111,7 @@ void Level::SpawnPlayer(const Vec3& pos)
 	player->node->rot = Vec3(0, PI / 2, 0); // north
 	CLEAR_BIT(player->node->subs, 1 << 0); // don't draw body under clothes
 	scene->Add(player->node);
+	unit_grid.Add(player);
 
 	SceneNode* weapon = new SceneNode;
 	if(player->melee_weapon)
@@ -147,23 +154,25 @@ void Level::RemoveItem(GroundItem* item)
 	}
 }
 
-bool Level::CheckCollision(Unit* unit, const Vec2& pos)
+void Level::MoveUnit(Unit& unit, const Vec3& pos)
 {
-	// player
-	if(unit != player && player->hp > 0)
-	{
-		if(Distance(pos.x, pos.y, player->node->pos.x, player->node->pos.z) <= Unit::radius * 2)
-			return false;
-	}
+	unit.node->pos = pos;
+	unit_grid.Update(&unit);
+}
 
-	// zombies
-	for(Zombie* zombie : zombies)
+bool Level::CheckCollision(Unit* unit, const Vec2& pos)
+{
+	// units
+	const float range = Unit::radius * 2;
+	bool collide = false;
+	unit_grid.ForEach(Box2d(pos.x - range, pos.y - range, pos.x + range, pos.y + range), [&](Unit* other)
 	{
-		if(zombie == unit || zombie->hp <= 0)
-			continue;
-		if(Distance(pos.x, pos.y, zombie->node->pos.x, zombie->node->pos.z) <= Unit::radius * 2)
-			return false;
-	}
+		if(!collide && other != unit && other->hp > 0
+			&& Distance(pos.x, pos.y, other->node->pos.x, other->node->pos.z) <= range)
+			collide = true;
+	});
+	if(collide)
+		return false;
 
 	// barriers
 	for(Collider& c : barriers)
@@ -258,27 +267,17 @@ bool Level::RayTest(const Vec3& pos, const Vec3& ray, float& out_t, int flags, U
 	if(IS_SET(flags, COLLIDE_UNITS))
 	{
 		Vec3 to = pos + ray;
-
-		if(excluded != player && player->hp > 0)
+		unit_grid.ForEachAlongRay(pos.XZ(), to.XZ(), [&](Unit* unit)
 		{
-			if(RayToCylinder(pos, to, player->node->pos, player->node->pos.ModY(Unit::height), Unit::radius, t) && t > 0.f && t < min_t)
+			if(excluded != unit && unit->hp > 0)
 			{
-				min_t = t;
-				hit = player;
-			}
-		}
-
-		for(Zombie* zombie : zombies)
-		{
-			if(excluded != zombie && zombie->hp > 0)
-			{
-				if(RayToCylinder(pos, to, zombie->node->pos, zombie->node->pos.ModY(Unit::height), Unit::radius, t) && t > 0.f && t < min_t)
+				if(RayToCylinder(pos, to, unit->node->pos, unit->node->pos.ModY(Unit::height), Unit::radius, t) && t > 0.f && t < min_t)
 				{
 					min_t = t;
-					hit = zombie;
+					hit = unit;
 				}
 			}
-		}
+		});
 	}
 
 	if(target)
@@ -300,7 +299,7 @@ void Level::SpawnBlood(Unit& unit)
 	unit.node->mesh_inst->SetupBones();
 
 	Vec3 center;
-	Mesh::Point* point = unit.node->mesh->GetPoint("centrum");
+	Mesh::Point* point = unit.node->mesh->GetPoint(point_center);
 	if(!point)
 		center = unit.node->pos.ModY(0.05f);
 	else
@@ -338,7 +337,7 @@ void Level::Update(float dt)
 	});
 }
 
-void Level::GatherColliders(vector<Collider>& results, const Box2d& box)
+void Level::GatherColliders(ArenaVector<Collider>& results, const Box2d& box)
 {
 	Rect rect(PosToPt(box.v1), PosToPt(box.v2));
 	if(rect.p1.x >= (int)grids || rect.p1.y >= (int)grids || rect.p2.x < 0 || rect.p2.y < 0)
@@ -405,6 +404,7 @@ void Level::Load(FileReader& f)
 	// player
 	SpawnPlayer(Vec3::Zero);
 	player->Load(f);
+	unit_grid.Update(player);
 
 	// zombies
 	uint count;
@@ -418,6 +418,7 @@ void Level::Load(FileReader& f)
 		zombie->node->mesh_inst = new MeshInstance(mesh_zombie);
 		zombie->Load(f);
 		zombies.push_back(zombie);
+		unit_grid.Add(zombie);
 		scene->Add(zombie->node);
 	}
 	f >> alive_zombies;
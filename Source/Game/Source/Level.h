@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Collider.h"
+#include "UnitGrid.h"
+#include <FrameArena.h>
 
 struct Blood
 {
@@ -29,6 +31,7 @@ public:
 	void SpawnZombie(const Vec3& pos);
 	void SpawnPlayer(const Vec3& pos);
 	void RemoveItem(GroundItem* item);
+	void MoveUnit(Unit& unit, const Vec3& pos);
 	bool CheckCollision(Unit* unit, const Vec2& pos);
 	bool CheckCollision(Unit& unit, const Vec3& pos)
 	{
@@ -39,11 +42,12 @@ public:
 	bool RayTest(const Vec3& pos, const Vec3& ray, float& t, int flags, Unit* excluded, Unit** target);
 	void SpawnBlood(Unit& unit);
 	void Update(float dt);
-	void GatherColliders(vector<Collider>& results, const Box2d& box);
+	void GatherColliders(ArenaVector<Collider>& results, const Box2d& box);
 	void Save(FileWriter& f);
 	void Load(FileReader& f);
 	void DrawColliders(DebugDrawer* debug_drawer);
 	vector<vector<Collider>>& GetColliders() { return colliders; }
+	UnitGrid& GetUnitGrid() { return unit_grid; }
 
 	Scene* scene;
 	Player* player;
@@ -65,6 +69,7 @@ private:
 	vector<vector<Collider>> colliders;
 	vector<Collider> barriers;
 	vector<SceneNode*> active_bloods;
+	UnitGrid unit_grid;
 	float level_size, tile_size;
 
 	static const uint grids = 8;
@@ -2,6 +2,7 @@
 #include "Navmesh.h"
 #include <DebugDrawer.h>
 #include <Recast.h>
+#include <DetourCommon.h>
 #include <DetourNavMesh.h>
 #include <DetourNavMeshQuery.h>
 #include <DetourNavMeshBuilder.h>
@@ -13,6 +14,9 @@ const float AGENT_RADIUS = Unit::radius;
 const float AGENT_HEIGHT = Unit::height;
 const float AGENT_CLIMB = 0.25f;
 const int NAV_QUERY_MAX_NODES = 2048;
+const int NAVMESH_CACHE_VERSION = 1;
+const uint NAVMESH_CACHE_MAX_TILES = 4096;
+const uint NAVMESH_CACHE_MAX_AGE = 8; // remove tiles not used in last saves
 
 enum PolyArea
 {
@@ -52,11 +56,40 @@ struct BuildContext : rcContext
 		Logger::Get()->Log(level, msg);
 	}
 };
-static BuildContext ctx;
+// scratch data used when building tile
+struct Navmesh::BuildData
+{
+	BuildData() : solid(nullptr), chf(nullptr), cset(nullptr), pmesh(nullptr), dmesh(nullptr) {}
+	~BuildData() { Cleanup(); }
+	void Cleanup();
+
+	BuildContext ctx;
+	rcHeightfield* solid;
+	rcCompactHeightfield* chf;
+	rcContourSet* cset;
+	rcPolyMesh* pmesh;
+	rcPolyMeshDetail* dmesh;
+	vector<byte> triareas;
+};
 
-Navmesh::Navmesh() : solid(nullptr), chf(nullptr), cset(nullptr), pmesh(nullptr), dmesh(nullptr), navmesh(nullptr)
+void Navmesh::BuildData::Cleanup()
+{
+	rcFreeHeightField(solid);
+	solid = nullptr;
+	rcFreeCompactHeightfield(chf);
+	chf = nullptr;
+	rcFreeContourSet(cset);
+	cset = nullptr;
+	rcFreePolyMesh(pmesh);
+	pmesh = nullptr;
+	rcFreePolyMeshDetail(dmesh);
+	dmesh = nullptr;
+}
+
+Navmesh::Navmesh() : navmesh(nullptr), tiles_version(0), cache_hits(0), cache_misses(0), cache_enabled(false), cache_changed(false)
 {
 	nav_query = dtAllocNavMeshQuery();
+	builders.push_back(new BuildData);
 
 	filter = new dtQueryFilter;
 	filter->setIncludeFlags(POLYFLAGS_WALK);
@@ -69,6 +102,9 @@ Navmesh::~Navmesh()
 {
 	Reset();
 	dtFreeNavMeshQuery(nav_query);
+	for(dtNavMeshQuery* query : thread_queries)
+		dtFreeNavMeshQuery(query);
+	DeleteElements(builders);
 	delete filter;
 }
 
@@ -79,20 +115,13 @@ void Navmesh::Reset()
 	Cleanup();
 	dtFreeNavMesh(navmesh);
 	navmesh = nullptr;
+	++tiles_version;
 }
 
 void Navmesh::Cleanup()
 {
-	rcFreeHeightField(solid);
-	solid = nullptr;
-	rcFreeCompactHeightfield(chf);
-	chf = nullptr;
-	rcFreeContourSet(cset);
-	cset = nullptr;
-	rcFreePolyMesh(pmesh);
-	pmesh = nullptr;
-	rcFreePolyMeshDetail(dmesh);
-	dmesh = nullptr;
+	for(BuildData* build : builders)
+		build->Cleanup();
 }
 
 bool Navmesh::PrepareTiles(float tile_size, uint tiles)
@@ -118,8 +147,7 @@ bool Navmesh::PrepareTiles(float tile_size, uint tiles)
 		return false;
 	}
 
-	status = nav_query->init(navmesh, NAV_QUERY_MAX_NODES);
-	if(dtStatusFailed(status))
+	if(!InitQueries())
 	{
 		Error("Failed to init tiled navmesh query.");
 		return false;
@@ -137,9 +165,10 @@ bool Navmesh::Build(const NavmeshGeometry& geom)
 	Reset();
 	is_tiled = false;
 
+	BuildContext& ctx = builders[0]->ctx;
 	byte* navData;
 	int navDataSize;
-	if(!BuildTileMesh(Int2(0, 0), geom, navData, navDataSize))
+	if(!BuildTileMesh(*builders[0], Int2(0, 0), geom, navData, navDataSize))
 		return false;
 
 	navmesh = dtAllocNavMesh();
@@ -151,8 +180,7 @@ bool Navmesh::Build(const NavmeshGeometry& geom)
 		return false;
 	}
 
-	status = nav_query->init(navmesh, NAV_QUERY_MAX_NODES);
-	if(dtStatusFailed(status))
+	if(!InitQueries())
 	{
 		ctx.log(RC_LOG_ERROR, "Could not init Detour navmesh query");
 		return false;
@@ -161,37 +189,131 @@ bool Navmesh::Build(const NavmeshGeometry& geom)
 	return true;
 }
 
-bool Navmesh::BuildTile(const Int2& tile, const NavmeshGeometry& geom)
+bool Navmesh::InitQueries()
 {
-	assert(navmesh && is_tiled);
+	dtStatus status = nav_query->init(navmesh, NAV_QUERY_MAX_NODES);
+	if(dtStatusFailed(status))
+		return false;
+	for(dtNavMeshQuery* query : thread_queries)
+	{
+		status = query->init(navmesh, NAV_QUERY_MAX_NODES);
+		if(dtStatusFailed(status))
+			return false;
+	}
+	return true;
+}
+
+// dtNavMeshQuery isn't thread safe, each thread that use query methods must pass own query index
+void Navmesh::SetQueriesCount(uint count)
+{
+	assert(count >= 1u);
+	for(uint i = count - 1; i < thread_queries.size(); ++i)
+		dtFreeNavMeshQuery(thread_queries[i]);
+	uint prev_count = thread_queries.size();
+	thread_queries.resize(count - 1);
+	for(uint i = prev_count; i < thread_queries.size(); ++i)
+	{
+		dtNavMeshQuery* query = dtAllocNavMeshQuery();
+		if(navmesh)
+			query->init(navmesh, NAV_QUERY_MAX_NODES);
+		thread_queries[i] = query;
+	}
+}
+
+dtNavMeshQuery* Navmesh::GetQuery(uint query_index)
+{
+	if(query_index == 0)
+		return nav_query;
+	assert(query_index <= thread_queries.size());
+	return thread_queries[query_index - 1];
+}
+
+// number of threads that can call BuildTile at the same time
+void Navmesh::SetBuildersCount(uint count)
+{
+	assert(count >= 1u);
+	while(builders.size() > count)
+	{
+		delete builders.back();
+		builders.pop_back();
+	}
+	while(builders.size() < count)
+		builders.push_back(new BuildData);
+}
+
+bool Navmesh::BuildTile(const Int2& tile, const NavmeshGeometry& geom, uint builder_index)
+{
+	assert(navmesh && is_tiled && builder_index < builders.size());
 
 	byte* data;
 	int data_size;
 
-	if(!BuildTileMesh(tile, geom, data, data_size))
-		return false;
+	// tiles with same geometry (relative to tile) can be reused
+	uint64 hash = 0, check = 0;
+	bool cached = false;
+	Vec3 origin(tile_size * tile.x, 0, tile_size * tile.y);
+	if(cache_enabled)
+	{
+		hash = CalculateTileHash(geom, origin, check);
+		std::lock_guard<std::mutex> lock(cache_mutex);
+		auto it = cache.find(hash);
+		if(it != cache.end())
+		{
+			CacheEntry& entry = it->second;
+			if(entry.check == check && entry.vert_count == geom.vert_count && entry.tri_count == geom.tri_count)
+			{
+				data_size = entry.data.size();
+				data = (byte*)dtAlloc(data_size, DT_ALLOC_PERM);
+				memcpy(data, entry.data.data(), data_size);
+				entry.age = 0;
+				cached = true;
+			}
+		}
+	}
 
+	if(cached)
+	{
+		MoveTileData(data, tile, origin);
+		++cache_hits;
+	}
+	else
+	{
+		if(!BuildTileMesh(*builders[builder_index], tile, geom, data, data_size))
+			return false;
+
+		if(cache_enabled)
+		{
+			CacheEntry entry;
+			entry.check = check;
+			entry.vert_count = geom.vert_count;
+			entry.tri_count = geom.tri_count;
+			entry.age = 0;
+			entry.data.assign(data, data + data_size);
+			MoveTileData(entry.data.data(), Int2(0, 0), -origin);
+			std::lock_guard<std::mutex> lock(cache_mutex);
+			cache[hash] = std::move(entry);
+			cache_changed = true;
+			++cache_misses;
+		}
+	}
+
+	std::unique_lock<std::shared_mutex> lock(tiles_mutex);
 	dtStatus status = navmesh->addTile(data, data_size, DT_TILE_FREE_DATA, 0, nullptr);
 	if(dtStatusFailed(status))
 	{
 		dtFree(data);
 		return false;
 	}
+	++tiles_version;
 
 	return true;
 }
 
-bool Navmesh::BuildTileMesh(const Int2& tile, const NavmeshGeometry& geom, byte*& data, int& data_size)
+// build config without bounds, used to build tile & as part of tile cache key
+void Navmesh::InitConfig(rcConfig& cfg) const
 {
-	Cleanup();
-
-	//
-	// Step 1. Initialize build config.
-	//
-
-	// Init configuration
 	const float detailSampleDist = 6.f;
-	rcConfig cfg = {};
+	cfg = {};
 	cfg.cs = CELL_SIZE;
 	cfg.ch = CELL_HEIGHT;
 	cfg.walkableSlopeAngle = 45.f;
@@ -205,8 +327,6 @@ bool Navmesh::BuildTileMesh(const Int2& tile, const NavmeshGeometry& geom, byte*
 	cfg.maxVertsPerPoly = 6;
 	cfg.detailSampleDist = detailSampleDist < 0.9f ? 0 : cfg.cs * detailSampleDist;
 	cfg.detailSampleMaxError = cfg.ch * 1.f;
-	rcVcopy(cfg.bmin, geom.bounds.v1);
-	rcVcopy(cfg.bmax, geom.bounds.v2);
 	if(is_tiled)
 	{
 		cfg.tileSize = (int)(tile_size / cfg.cs);
@@ -214,7 +334,21 @@ bool Navmesh::BuildTileMesh(const Int2& tile, const NavmeshGeometry& geom, byte*
 		cfg.width = cfg.tileSize + cfg.borderSize * 2;
 		cfg.height = cfg.width;
 	}
-	else
+}
+
+bool Navmesh::BuildTileMesh(BuildData& build, const Int2& tile, const NavmeshGeometry& geom, byte*& data, int& data_size)
+{
+	build.Cleanup();
+
+	//
+	// Step 1. Initialize build config.
+	//
+
+	rcConfig cfg;
+	InitConfig(cfg);
+	rcVcopy(cfg.bmin, geom.bounds.v1);
+	rcVcopy(cfg.bmax, geom.bounds.v2);
+	if(!is_tiled)
 		rcCalcGridSize(cfg.bmin, cfg.bmax, cfg.cs, &cfg.width, &cfg.height);
 
 	//
@@ -222,26 +356,26 @@ bool Navmesh::BuildTileMesh(const Int2& tile, const NavmeshGeometry& geom, byte*
 	//
 
 	// Allocate voxel heightfield where we rasterize our input data to.
-	solid = rcAllocHeightfield();
-	if(!rcCreateHeightfield(&ctx, *solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch))
+	build.solid = rcAllocHeightfield();
+	if(!rcCreateHeightfield(&build.ctx, *build.solid, cfg.width, cfg.height, cfg.bmin, cfg.bmax, cfg.cs, cfg.ch))
 	{
-		ctx.log(RC_LOG_ERROR, "Could not create solid heightfield.");
+		build.ctx.log(RC_LOG_ERROR, "Could not create solid heightfield.");
 		return false;
 	}
 
 	// Allocate array that can hold triangle area types.
 	// If you have multiple meshes you need to process, allocate
 	// and array which can hold the max number of triangles you need to process.
-	triareas.resize(geom.tri_count);
+	build.triareas.resize(geom.tri_count);
 
 	// Find triangles which are walkable based on their slope and rasterize them.
 	// If your input data is multiple meshes, you can transform them here, calculate
 	// the are type for each of the meshes and rasterize them.
-	memset(triareas.data(), 0, geom.tri_count * sizeof(byte));
-	rcMarkWalkableTriangles(&ctx, cfg.walkableSlopeAngle, (float*)geom.verts, geom.vert_count, geom.tris, geom.tri_count, triareas.data());
-	if(!rcRasterizeTriangles(&ctx, (float*)geom.verts, geom.vert_count, geom.tris, triareas.data(), geom.tri_count, *solid, cfg.walkableClimb))
+	memset(build.triareas.data(), 0, geom.tri_count * sizeof(byte));
+	rcMarkWalkableTriangles(&build.ctx, cfg.walkableSlopeAngle, (float*)geom.verts, geom.vert_count, geom.tris, geom.tri_count, build.triareas.data());
+	if(!rcRasterizeTriangles(&build.ctx, (float*)geom.verts, geom.vert_count, geom.tris, build.triareas.data(), geom.tri_count, *build.solid, cfg.walkableClimb))
 	{
-		ctx.log(RC_LOG_ERROR, "Could not rasterize triangles.");
+		build.ctx.log(RC_LOG_ERROR, "Could not rasterize triangles.");
 		return false;
 	}
 
@@ -256,11 +390,11 @@ bool Navmesh::BuildTileMesh(const Int2& tile, const NavmeshGeometry& geom, byte*
 	const bool m_filterLedgeSpans = true;
 	const bool m_filterWalkableLowHeightSpans = true;
 	if(m_filterLowHangingObstacles)
-		rcFilterLowHangingWalkableObstacles(&ctx, cfg.walkableClimb, *solid);
+		rcFilterLowHangingWalkableObstacles(&build.ctx, cfg.walkableClimb, *build.solid);
 	if(m_filterLedgeSpans)
-		rcFilterLedgeSpans(&ctx, cfg.walkableHeight, cfg.walkableClimb, *solid);
+		rcFilterLedgeSpans(&build.ctx, cfg.walkableHeight, cfg.walkableClimb, *build.solid);
 	if(m_filterWalkableLowHeightSpans)
-		rcFilterWalkableLowHeightSpans(&ctx, cfg.walkableHeight, *solid);
+		rcFilterWalkableLowHeightSpans(&build.ctx, cfg.walkableHeight, *build.solid);
 
 	//
 	// Step 4. Partition walkable surface to simple regions.
@@ -269,20 +403,20 @@ bool Navmesh::BuildTileMesh(const Int2& tile, const NavmeshGeometry& geom, byte*
 	// Compact the heightfield so that it is faster to handle from now on.
 	// This will result more cache coherent data as well as the neighbours
 	// between walkable cells will be calculated.
-	chf = rcAllocCompactHeightfield();
-	if(!rcBuildCompactHeightfield(&ctx, cfg.walkableHeight, cfg.walkableClimb, *solid, *chf))
+	build.chf = rcAllocCompactHeightfield();
+	if(!rcBuildCompactHeightfield(&build.ctx, cfg.walkableHeight, cfg.walkableClimb, *build.solid, *build.chf))
 	{
-		ctx.log(RC_LOG_ERROR, "Could not build compact data.");
+		build.ctx.log(RC_LOG_ERROR, "Could not build compact data.");
 		return false;
 	}
 
-	rcFreeHeightField(solid);
-	solid = nullptr;
+	rcFreeHeightField(build.solid);
+	build.solid = nullptr;
 
 	// Erode the walkable area by agent radius.
-	if(!rcErodeWalkableArea(&ctx, cfg.walkableRadius, *chf))
+	if(!rcErodeWalkableArea(&build.ctx, cfg.walkableRadius, *build.chf))
 	{
-		ctx.log(RC_LOG_ERROR, "Could not erode.");
+		build.ctx.log(RC_LOG_ERROR, "Could not erode.");
 		return false;
 	}
 
@@ -296,16 +430,16 @@ bool Navmesh::BuildTileMesh(const Int2& tile, const NavmeshGeometry& geom, byte*
 	// Using Watershed partitioning
 
 	// Prepare for region partitioning, by calculating distance field along the walkable surface.
-	if(!rcBuildDistanceField(&ctx, *chf))
+	if(!rcBuildDistanceField(&build.ctx, *build.chf))
 	{
-		ctx.log(RC_LOG_ERROR, "Could not build distance field.");
+		build.ctx.log(RC_LOG_ERROR, "Could not build distance field.");
 		return false;
 	}
 
 	// Partition the walkable surface into simple regions without holes.
-	if(!rcBuildRegions(&ctx, *chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
+	if(!rcBuildRegions(&build.ctx, *build.chf, cfg.borderSize, cfg.minRegionArea, cfg.mergeRegionArea))
 	{
-		ctx.log(RC_LOG_ERROR, "Could not build watershed regions.");
+		build.ctx.log(RC_LOG_ERROR, "Could not build watershed regions.");
 		return false;
 	}
 
@@ -314,14 +448,14 @@ bool Navmesh::BuildTileMesh(const Int2& tile, const NavmeshGeometry& geom, byte*
 	//
 
 	// Create contours.
-	cset = rcAllocContourSet();
-	if(!rcBuildContours(&ctx, *chf, cfg.maxSimplificationError, cfg.maxEdgeLen, *cset))
+	build.cset = rcAllocContourSet();
+	if(!rcBuildContours(&build.ctx, *build.chf, cfg.maxSimplificationError, cfg.maxEdgeLen, *build.cset))
 	{
-		ctx.log(RC_LOG_ERROR, "Could not create contours.");
+		build.ctx.log(RC_LOG_ERROR, "Could not create contours.");
 		return false;
 	}
 
-	if(cset->nconts == 0)
+	if(build.cset->nconts == 0)
 		return false;
 
 	//
@@ -329,10 +463,10 @@ bool Navmesh::BuildTileMesh(const Int2& tile, const NavmeshGeometry& geom, byte*
 	//
 
 	// Build polygon navmesh from the contours.
-	pmesh = rcAllocPolyMesh();
-	if(!rcBuildPolyMesh(&ctx, *cset, cfg.maxVertsPerPoly, *pmesh))
+	build.pmesh = rcAllocPolyMesh();
+	if(!rcBuildPolyMesh(&build.ctx, *build.cset, cfg.maxVertsPerPoly, *build.pmesh))
 	{
-		ctx.log(RC_LOG_ERROR, "buildNavigation: Could not triangulate contours.");
+		build.ctx.log(RC_LOG_ERROR, "buildNavigation: Could not triangulate contours.");
 		return false;
 	}
 
@@ -340,17 +474,17 @@ bool Navmesh::BuildTileMesh(const Int2& tile, const NavmeshGeometry& geom, byte*
 	// Step 7. Create detail mesh which allows to access approximate height on each polygon.
 	//
 
-	dmesh = rcAllocPolyMeshDetail();
-	if(!rcBuildPolyMeshDetail(&ctx, *pmesh, *chf, cfg.detailSampleDist, cfg.detailSampleMaxError, *dmesh))
+	build.dmesh = rcAllocPolyMeshDetail();
+	if(!rcBuildPolyMeshDetail(&build.ctx, *build.pmesh, *build.chf, cfg.detailSampleDist, cfg.detailSampleMaxError, *build.dmesh))
 	{
-		ctx.log(RC_LOG_ERROR, "buildNavigation: Could not build detail mesh.");
+		build.ctx.log(RC_LOG_ERROR, "buildNavigation: Could not build detail mesh.");
 		return false;
 	}
 
-	rcFreeCompactHeightfield(chf);
-	chf = nullptr;
-	rcFreeContourSet(cset);
-	cset = nullptr;
+	rcFreeCompactHeightfield(build.chf);
+	build.chf = nullptr;
+	rcFreeContourSet(build.cset);
+	build.cset = nullptr;
 
 	// At this point the navigation mesh data is ready, you can access it from pmesh.
 	// See duDebugDrawPolyMesh or dtCreateNavMeshData as examples how to access the data.
@@ -363,33 +497,33 @@ bool Navmesh::BuildTileMesh(const Int2& tile, const NavmeshGeometry& geom, byte*
 	int navDataSize = 0;
 
 	// Update poly flags from areas.
-	for(int i = 0; i < pmesh->npolys; ++i)
+	for(int i = 0; i < build.pmesh->npolys; ++i)
 	{
-		if(pmesh->areas[i] == RC_WALKABLE_AREA)
+		if(build.pmesh->areas[i] == RC_WALKABLE_AREA)
 		{
-			pmesh->areas[i] = POLYAREA_GROUND;
-			pmesh->flags[i] = POLYFLAGS_WALK;
+			build.pmesh->areas[i] = POLYAREA_GROUND;
+			build.pmesh->flags[i] = POLYFLAGS_WALK;
 		}
 	}
 
 	dtNavMeshCreateParams params = {};
-	params.verts = pmesh->verts;
-	params.vertCount = pmesh->nverts;
-	params.polys = pmesh->polys;
-	params.polyAreas = pmesh->areas;
-	params.polyFlags = pmesh->flags;
-	params.polyCount = pmesh->npolys;
-	params.nvp = pmesh->nvp;
-	params.detailMeshes = dmesh->meshes;
-	params.detailVerts = dmesh->verts;
-	params.detailVertsCount = dmesh->nverts;
-	params.detailTris = dmesh->tris;
-	params.detailTriCount = dmesh->ntris;
+	params.verts = build.pmesh->verts;
+	params.vertCount = build.pmesh->nverts;
+	params.polys = build.pmesh->polys;
+	params.polyAreas = build.pmesh->areas;
+	params.polyFlags = build.pmesh->flags;
+	params.polyCount = build.pmesh->npolys;
+	params.nvp = build.pmesh->nvp;
+	params.detailMeshes = build.dmesh->meshes;
+	params.detailVerts = build.dmesh->verts;
+	params.detailVertsCount = build.dmesh->nverts;
+	params.detailTris = build.dmesh->tris;
+	params.detailTriCount = build.dmesh->ntris;
 	params.walkableHeight = AGENT_HEIGHT;
 	params.walkableRadius = AGENT_RADIUS;
 	params.walkableClimb = AGENT_CLIMB;
-	rcVcopy(params.bmin, pmesh->bmin);
-	rcVcopy(params.bmax, pmesh->bmax);
+	rcVcopy(params.bmin, build.pmesh->bmin);
+	rcVcopy(params.bmax, build.pmesh->bmax);
 	params.cs = cfg.cs;
 	params.ch = cfg.ch;
 	params.buildBvTree = true;
@@ -401,7 +535,7 @@ bool Navmesh::BuildTileMesh(const Int2& tile, const NavmeshGeometry& geom, byte*
 
 	if(!dtCreateNavMeshData(&params, &navData, &navDataSize))
 	{
-		ctx.log(RC_LOG_ERROR, "Could not build Detour navmesh.");
+		build.ctx.log(RC_LOG_ERROR, "Could not build Detour navmesh.");
 		return false;
 	}
 
@@ -410,6 +544,173 @@ bool Navmesh::BuildTileMesh(const Int2& tile, const NavmeshGeometry& geom, byte*
 	return true;
 }
 
+// FNV-1a of build config & tile geometry, check is second independent hash (multiply-rotate) of same data
+uint64 Navmesh::CalculateTileHash(const NavmeshGeometry& geom, const Vec3& origin, uint64& check) const
+{
+	uint64 hash = 14695981039346656037ull;
+	check = 0x9E3779B97F4A7C15ull;
+	auto add = [&hash, &check](const void* data, uint size)
+	{
+		const byte* ptr = (const byte*)data;
+		for(uint i = 0; i < size; ++i)
+		{
+			hash ^= ptr[i];
+			hash *= 1099511628211ull;
+			check = (check + ptr[i]) * 0xC2B2AE3D27D4EB4Full;
+			check = (check << 31) | (check >> 33);
+		}
+	};
+
+	rcConfig cfg;
+	InitConfig(cfg);
+	add(&NAVMESH_CACHE_VERSION, sizeof(NAVMESH_CACHE_VERSION));
+	add(&cfg, sizeof(cfg));
+	add(&AGENT_RADIUS, sizeof(AGENT_RADIUS));
+	add(&AGENT_HEIGHT, sizeof(AGENT_HEIGHT));
+	add(&AGENT_CLIMB, sizeof(AGENT_CLIMB));
+	add(&geom.vert_count, sizeof(geom.vert_count));
+	add(&geom.tri_count, sizeof(geom.tri_count));
+	for(uint i = 0; i < geom.vert_count; ++i)
+	{
+		Vec3 pos = geom.verts[i] - origin;
+		add(&pos, sizeof(pos));
+	}
+	add(geom.tris, sizeof(int) * 3 * geom.tri_count);
+	Box bounds(geom.bounds.v1 - origin, geom.bounds.v2 - origin);
+	add(&bounds, sizeof(bounds));
+	return hash;
+}
+
+// change tile position in detour tile data
+void Navmesh::MoveTileData(byte* data, const Int2& tile, const Vec3& offset)
+{
+	dtMeshHeader* header = (dtMeshHeader*)data;
+	assert(header->magic == DT_NAVMESH_MAGIC && header->offMeshConCount == 0);
+	header->x = tile.x;
+	header->y = tile.y;
+	dtVadd(header->bmin, header->bmin, offset);
+	dtVadd(header->bmax, header->bmax, offset);
+
+	const int header_size = dtAlign4(sizeof(dtMeshHeader));
+	const int verts_size = dtAlign4(sizeof(float) * 3 * header->vertCount);
+	const int polys_size = dtAlign4(sizeof(dtPoly) * header->polyCount);
+	const int links_size = dtAlign4(sizeof(dtLink) * header->maxLinkCount);
+	const int detail_meshes_size = dtAlign4(sizeof(dtPolyDetail) * header->detailMeshCount);
+	Vec3* verts = (Vec3*)(data + header_size);
+	for(int i = 0; i < header->vertCount; ++i)
+		verts[i] += offset;
+	Vec3* detail_verts = (Vec3*)(data + header_size + verts_size + polys_size + links_size + detail_meshes_size);
+	for(int i = 0; i < header->detailVertCount; ++i)
+		detail_verts[i] += offset;
+}
+
+void Navmesh::LoadCache(cstring filename)
+{
+	assert(filename);
+	cache_filename = filename;
+	cache_enabled = true;
+	cache_changed = false;
+	cache.clear();
+
+	FileReader f(filename);
+	if(!f.IsOpen())
+		return;
+
+	byte sign[] = { 'R','S','N','C' };
+	byte sign2[4];
+	int version;
+	uint count;
+	f >> sign2;
+	f >> version;
+	f >> count;
+	if(!f || memcmp(sign, sign2, sizeof(sign)) != 0 || version != NAVMESH_CACHE_VERSION)
+	{
+		Warn("Navmesh cache '%s' is invalid or outdated.", filename);
+		return;
+	}
+
+	for(uint i = 0; i < count; ++i)
+	{
+		uint64 hash;
+		f >> hash;
+		CacheEntry& entry = cache[hash];
+		f >> entry.check;
+		f >> entry.vert_count;
+		f >> entry.tri_count;
+		f >> entry.age;
+		f.ReadVector4(entry.data);
+		if(!f)
+		{
+			Warn("Navmesh cache '%s' is corrupted.", filename);
+			cache.clear();
+			return;
+		}
+	}
+
+	Info("Loaded navmesh cache, %u tiles.", cache.size());
+}
+
+void Navmesh::SaveCache()
+{
+	std::lock_guard<std::mutex> lock(cache_mutex);
+	if(!cache_enabled || !cache_changed)
+		return;
+
+	FileWriter f(cache_filename.c_str());
+	if(!f)
+	{
+		Warn("Failed to save navmesh cache '%s'.", cache_filename.c_str());
+		return;
+	}
+
+	// keep recently used tiles, drop ones that wasn't used for long time
+	vector<std::pair<const uint64, CacheEntry>*> entries;
+	entries.reserve(cache.size());
+	for(auto& e : cache)
+	{
+		if(e.second.age < NAVMESH_CACHE_MAX_AGE)
+			entries.push_back(&e);
+	}
+	if(entries.size() > NAVMESH_CACHE_MAX_TILES)
+	{
+		std::nth_element(entries.begin(), entries.begin() + NAVMESH_CACHE_MAX_TILES, entries.end(),
+			[](std::pair<const uint64, CacheEntry>* e1, std::pair<const uint64, CacheEntry>* e2) { return e1->second.age < e2->second.age; });
+		entries.resize(NAVMESH_CACHE_MAX_TILES);
+	}
+
+	byte sign[] = { 'R','S','N','C' };
+	f << sign;
+	f << NAVMESH_CACHE_VERSION;
+	f << (uint)entries.size();
+	for(auto* e : entries)
+	{
+		const CacheEntry& entry = e->second;
+		f << e->first;
+		f << entry.check;
+		f << entry.vert_count;
+		f << entry.tri_count;
+		f << (entry.age + 1);
+		f << (uint)entry.data.size();
+		f.Write(entry.data.data(), entry.data.size());
+	}
+	cache_changed = false;
+}
+
+void Navmesh::LogCacheStats()
+{
+	if(!cache_enabled)
+		return;
+	Info("Navmesh cache: %u tiles reused, %u built.", cache_hits.load(), cache_misses.load());
+	cache_hits = 0;
+	cache_misses = 0;
+}
+
+bool Navmesh::HaveTile(const Int2& tile)
+{
+	std::shared_lock<std::shared_mutex> lock(tiles_mutex);
+	return navmesh->getTileAt(tile.x, tile.y, 0) != nullptr;
+}
+
 Box2d Navmesh::GetBoxForTile(const Int2& tile)
 {
 	assert(tile.x >= 0 && tile.y >= 0 && tile.x < (int)tiles && tile.y < (int)tiles);
@@ -420,11 +721,12 @@ Box2d Navmesh::GetBoxForTile(const Int2& tile)
 		tile_size * (tile.x + 1) + border, tile_size * (tile.y + 1) + border);
 }
 
-dtPolyRef Navmesh::GetPolyRef(const Vec3& pos)
+dtPolyRef Navmesh::GetPolyRef(const Vec3& pos, uint query_index)
 {
 	static const float ext[] = { 2.f, 4.f, 2.f };
 	dtPolyRef ref;
-	nav_query->findNearestPoly(pos, ext, filter, &ref, nullptr);
+	std::shared_lock<std::shared_mutex> lock(tiles_mutex);
+	GetQuery(query_index)->findNearestPoly(pos, ext, filter, &ref, nullptr);
 	return ref;
 }
 
@@ -433,6 +735,7 @@ bool Navmesh::FindPath(const Vec3& from, const Vec3& to, vector<Vec3>& out_path)
 	const float ext[] = { 2.f, 4.f, 2.f };
 
 	dtPolyRef start_ref, end_ref;
+	std::shared_lock<std::shared_mutex> lock(tiles_mutex);
 	nav_query->findNearestPoly(from, ext, filter, &start_ref, nullptr);
 	nav_query->findNearestPoly(to, ext, filter, &end_ref, nullptr);
 
@@ -443,10 +746,20 @@ bool Navmesh::FindPath(const Vec3& from, const Vec3& to, vector<Vec3>& out_path)
 	if(tmp_path_length == 0)
 		return false;
 
-	FindStraightPath(end_ref, from, to, out_path);
+	FindStraightPathUnlocked(tmp_path, tmp_path_length, end_ref, from, to, out_path, 0);
 	return true;
 }
 
+// find polygons corridor from start to end, returns length (0 if failed)
+int Navmesh::FindCorridor(dtPolyRef start_ref, dtPolyRef end_ref, const Vec3& from, const Vec3& to, dtPolyRef* corridor, uint query_index)
+{
+	assert(start_ref && end_ref && corridor);
+	int length = 0;
+	std::shared_lock<std::shared_mutex> lock(tiles_mutex);
+	GetQuery(query_index)->findPath(start_ref, end_ref, from, to, filter, corridor, &length, MAX_POLYS);
+	return length;
+}
+
 bool Navmesh::FindTestPath(const Vec3& from, const Vec3& to, bool smooth)
 {
 	test_path.ok = false;
@@ -455,6 +768,7 @@ bool Navmesh::FindTestPath(const Vec3& from, const Vec3& to, bool smooth)
 	test_path.end_pos = to;
 
 	const float ext[] = { 2.f, 4.f, 2.f };
+	std::shared_lock<std::shared_mutex> lock(tiles_mutex);
 
 	nav_query->findNearestPoly(from, ext, filter, &test_path.start_ref, nullptr);
 	nav_query->findNearestPoly(to, ext, filter, &test_path.end_ref, nullptr);
@@ -469,7 +783,7 @@ bool Navmesh::FindTestPath(const Vec3& from, const Vec3& to, bool smooth)
 	test_path.ok = true;
 	if(!smooth)
 	{
-		FindStraightPath(test_path.end_ref, from, test_path.end_pos, test_path.path);
+		FindStraightPathUnlocked(tmp_path, tmp_path_length, test_path.end_ref, from, test_path.end_pos, test_path.path, 0);
 		Info("Path found, length:%d, straight:%d", tmp_path_length, test_path.path.size());
 	}
 	else
@@ -481,21 +795,33 @@ bool Navmesh::FindTestPath(const Vec3& from, const Vec3& to, bool smooth)
 	return true;
 }
 
-void Navmesh::FindStraightPath(dtPolyRef end_ref, const Vec3& start_pos, const Vec3& end_pos, vector<Vec3>& out_path)
+void Navmesh::FindStraightPath(const dtPolyRef* corridor, int corridor_length, dtPolyRef end_ref, const Vec3& start_pos, const Vec3& end_pos,
+	vector<Vec3>& out_path, uint query_index)
 {
+	std::shared_lock<std::shared_mutex> lock(tiles_mutex);
+	FindStraightPathUnlocked(corridor, corridor_length, end_ref, start_pos, end_pos, out_path, query_index);
+}
+
+void Navmesh::FindStraightPathUnlocked(const dtPolyRef* corridor, int corridor_length, dtPolyRef end_ref, const Vec3& start_pos,
+	const Vec3& end_pos, vector<Vec3>& out_path, uint query_index)
+{
+	assert(corridor && corridor_length > 0);
+	dtNavMeshQuery* query = GetQuery(query_index);
+
 	// In case of partial path, make sure the end point is clamped to the last polygon.
 	Vec3 epos = end_pos;
-	if(tmp_path[tmp_path_length - 1] != end_ref)
-		nav_query->closestPointOnPoly(tmp_path[tmp_path_length - 1], end_pos, epos, nullptr);
+	if(corridor[corridor_length - 1] != end_ref)
+		query->closestPointOnPoly(corridor[corridor_length - 1], end_pos, epos, nullptr);
 
+	Vec3 straight_path[MAX_POLYS];
 	int length = 0;
-	nav_query->findStraightPath(start_pos, epos, tmp_path, tmp_path_length, (float*)tmp_straight_path, nullptr,
+	query->findStraightPath(start_pos, epos, corridor, corridor_length, (float*)straight_path, nullptr,
 		nullptr, &length, MAX_POLYS, 0);
 
 	if(length >= 2)
 	{
 		out_path.resize(length);
-		memcpy(out_path.data(), tmp_straight_path, sizeof(Vec3) * length);
+		memcpy(out_path.data(), straight_path, sizeof(Vec3) * length);
 	}
 	else
 	{
@@ -771,7 +1097,10 @@ void Navmesh::Draw(DebugDrawer* debug_drawer)
 		return;
 
 	debug_drawer->BeginBatch();
-	DrawNavmesh(debug_drawer, *navmesh);
+	{
+		std::shared_lock<std::shared_mutex> lock(tiles_mutex);
+		DrawNavmesh(debug_drawer, *navmesh);
+	}
 	debug_drawer->EndBatch();
 
 	if(test_path.ok)
@@ -981,6 +1310,7 @@ void Navmesh::DrawPoly(DebugDrawer* debug_drawer, const dtNavMesh& mesh, dtPolyR
 
 void Navmesh::Save(FileWriter& f)
 {
+	std::shared_lock<std::shared_mutex> lock(tiles_mutex);
 	const dtNavMesh& mesh = *navmesh;
 
 	const int count = mesh.getMaxTiles();
@@ -1022,6 +1352,7 @@ void Navmesh::Load(FileReader& f)
 		byte* data = (byte*)dtAlloc(data_size, DT_ALLOC_PERM);
 		f.Read(data, data_size);
 
+		std::unique_lock<std::shared_mutex> lock(tiles_mutex);
 		dtStatus status = navmesh->addTile(data, data_size, DT_TILE_FREE_DATA, tile_ref, nullptr);
 		if(dtStatusFailed(status))
 		{
@@ -1029,4 +1360,5 @@ void Navmesh::Load(FileReader& f)
 			throw Format("Failed to load navmesh for tile %d.", i);
 		}
 	}
+	++tiles_version;
 }
@@ -11,14 +11,29 @@ struct NavmeshGeometry
 class Navmesh
 {
 public:
+	static const int MAX_POLYS = 256;
+
 	Navmesh();
 	~Navmesh();
 	bool PrepareTiles(float tile_size, uint tiles);
 	bool Build(const NavmeshGeometry& geom);
-	bool BuildTile(const Int2& tile, const NavmeshGeometry& geom);
+	void SetBuildersCount(uint count);
+	bool BuildTile(const Int2& tile, const NavmeshGeometry& geom, uint builder_index = 0);
+	bool HaveTile(const Int2& tile);
+	void LoadCache(cstring filename);
+	void SaveCache();
+	void LogCacheStats();
 	Box2d GetBoxForTile(const Int2& tile);
-	dtPolyRef GetPolyRef(const Vec3& pos);
+	const dtNavMesh* GetDetourNavmesh() const { return navmesh; }
+	uint GetTilesVersion() const { return tiles_version; }
+	// lock shared when reading detour navmesh directly, tiles are added by builder threads
+	std::shared_mutex& GetTilesMutex() { return tiles_mutex; }
+	void SetQueriesCount(uint count);
+	dtPolyRef GetPolyRef(const Vec3& pos, uint query_index = 0);
 	bool FindPath(const Vec3& from, const Vec3& to, vector<Vec3>& out_path);
+	int FindCorridor(dtPolyRef start_ref, dtPolyRef end_ref, const Vec3& from, const Vec3& to, dtPolyRef* corridor, uint query_index);
+	void FindStraightPath(const dtPolyRef* corridor, int corridor_length, dtPolyRef end_ref, const Vec3& start_pos, const Vec3& end_pos,
+		vector<Vec3>& out_path, uint query_index);
 	bool FindTestPath(const Vec3& from, const Vec3& to, bool smooth);
 	void Draw(DebugDrawer* debug_drawer);
 	void DrawPath(DebugDrawer* debug_drawer, const vector<Vec3>& path, bool smooth);
@@ -26,6 +41,15 @@ public:
 	void Load(FileReader& f);
 
 private:
+	struct BuildData;
+
+	struct CacheEntry
+	{
+		uint64 check; // second hash of tile geometry, checked to detect hash collision
+		uint vert_count, tri_count, age; // age - number of saves since tile was last used
+		vector<byte> data;
+	};
+
 	struct TestPath
 	{
 		vector<Vec3> path;
@@ -36,8 +60,14 @@ private:
 
 	void Cleanup();
 	void Reset();
-	bool BuildTileMesh(const Int2& tile, const NavmeshGeometry& geom, byte*& data, int& data_size);
-	void FindStraightPath(dtPolyRef end_ref, const Vec3& start_pos, const Vec3& end_pos, vector<Vec3>& out_path);
+	bool InitQueries();
+	dtNavMeshQuery* GetQuery(uint query_index);
+	void InitConfig(rcConfig& cfg) const;
+	uint64 CalculateTileHash(const NavmeshGeometry& geom, const Vec3& origin, uint64& check) const;
+	static void MoveTileData(byte* data, const Int2& tile, const Vec3& offset);
+	bool BuildTileMesh(BuildData& build, const Int2& tile, const NavmeshGeometry& geom, byte*& data, int& data_size);
+	void FindStraightPathUnlocked(const dtPolyRef* corridor, int corridor_length, dtPolyRef end_ref, const Vec3& start_pos, const Vec3& end_pos,
+		vector<Vec3>& out_path, uint query_index);
 	void SmoothPath(dtPolyRef start_ref, const Vec3& start_pos, const Vec3& end_pos, vector<Vec3>& out_path);
 	void DrawNavmesh(DebugDrawer* debug_drawer, const dtNavMesh& mesh);
 	void DrawMeshTile(DebugDrawer* debug_drawer, const dtNavMesh& mesh, const dtMeshTile* tile);
@@ -47,13 +77,18 @@ private:
 	void DrawSmoothPath(DebugDrawer* debug_drawer, const dtNavMesh& mesh, const vector<Vec3>& path);
 	void DrawPoly(DebugDrawer* debug_drawer, const dtNavMesh& mesh, dtPolyRef ref, Color col);
 
-	rcHeightfield* solid;
-	rcCompactHeightfield* chf;
-	rcContourSet* cset;
-	rcPolyMesh* pmesh;
-	rcPolyMeshDetail* dmesh;
-	vector<byte> triareas;
+	vector<BuildData*> builders;
+	std::shared_mutex tiles_mutex; // exclusive when adding tiles, shared when reading navmesh
+	std::atomic<uint> tiles_version; // changed when tile is added or navmesh is recreated
+
+	// tiles cache, key is hash of build config & tile geometry relative to tile origin, data is moved to tile (0,0)
+	unordered_map<uint64, CacheEntry> cache;
+	std::mutex cache_mutex;
+	string cache_filename;
+	std::atomic<uint> cache_hits, cache_misses;
+	bool cache_enabled, cache_changed;
 	dtNavMeshQuery* nav_query;
+	vector<dtNavMeshQuery*> thread_queries; // additional queries for worker threads
 	dtNavMesh* navmesh;
 	dtQueryFilter* filter;
 	float tile_size;
@@ -61,10 +96,8 @@ private:
 	bool is_tiled;
 
 	// intermediate results
-	static const int MAX_POLYS = 256;
 	static const int MAX_SMOOTH = 2048;
 	dtPolyRef tmp_path[MAX_POLYS];
-	Vec3 tmp_straight_path[MAX_POLYS];
 	int tmp_path_length;
 
 	// test data
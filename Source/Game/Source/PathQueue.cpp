@@ -0,0 +1,149 @@
+#include "GameCore.h"
+#include "PathQueue.h"
+#include <SceneNode.h>
+#include <ThreadPool.h>
+#include <FrameArena.h>
+#include "Zombie.h"
+
+static const float PF_USED_TIMER = 0.25f;
+static const float PF_NOT_GENERATED_TIMER = 0.5f;
+
+PathQueue::PathQueue() : navmesh(nullptr), thread_pool(nullptr)
+{
+}
+
+void PathQueue::Init(Navmesh* navmesh, ThreadPool* thread_pool)
+{
+	assert(navmesh && thread_pool);
+	this->navmesh = navmesh;
+	this->thread_pool = thread_pool;
+	navmesh->SetQueriesCount(thread_pool->GetThreadsCount());
+}
+
+void PathQueue::Add(Zombie& zombie, const Vec3& target)
+{
+	assert(!zombie.pf_waiting);
+	zombie.pf_waiting = true;
+
+	Request request;
+	request.zombie = &zombie;
+	request.from = zombie.node->pos;
+	request.to = target;
+	requests.push_back(request);
+}
+
+void PathQueue::Remove(Zombie& zombie)
+{
+	if(!zombie.pf_waiting)
+		return;
+	zombie.pf_waiting = false;
+	LoopRemove(requests, [&zombie](Request& request)
+	{
+		return request.zombie == &zombie;
+	});
+}
+
+void PathQueue::Clear()
+{
+	for(Request& request : requests)
+		request.zombie->pf_waiting = false;
+	requests.clear();
+}
+
+void PathQueue::Update()
+{
+	if(requests.empty())
+		return;
+
+	uint count = requests.size();
+	if(count > MAX_REQUESTS_PER_UPDATE)
+		count = MAX_REQUESTS_PER_UPDATE;
+	// batch & corridors are valid only during this update, paths are kept because they are swapped with zombies paths
+	ArenaVector<Request> batch(requests.begin(), requests.begin() + count);
+	ArenaVector<Corridor> corridors;
+	corridors.reserve(count);
+	requests.erase(requests.begin(), requests.begin() + count);
+	if(paths.size() < count)
+		paths.resize(count);
+
+	// find start & end polygons
+	thread_pool->ParallelFor(count, [&](uint index)
+	{
+		Request& request = batch[index];
+		uint query_index = ThreadPool::GetThreadIndex();
+		request.start_ref = navmesh->GetPolyRef(request.from, query_index);
+		request.end_ref = navmesh->GetPolyRef(request.to, query_index);
+		request.ok = false;
+	});
+
+	// group requests with same polygons (many zombies near each other chasing player)
+	uint corridors_count = 0;
+	for(uint i = 0; i < count; ++i)
+	{
+		Request& request = batch[i];
+		request.corridor = -1;
+		if(request.start_ref == 0 || request.end_ref == 0)
+			continue;
+		for(uint j = 0; j < corridors_count; ++j)
+		{
+			if(corridors[j].start_ref == request.start_ref && corridors[j].end_ref == request.end_ref)
+			{
+				request.corridor = j;
+				break;
+			}
+		}
+		if(request.corridor == -1)
+		{
+			corridors.resize(corridors_count + 1);
+			Corridor& corridor = corridors[corridors_count];
+			corridor.start_ref = request.start_ref;
+			corridor.end_ref = request.end_ref;
+			corridor.request = i;
+			request.corridor = corridors_count++;
+		}
+	}
+
+	// find corridors
+	thread_pool->ParallelFor(corridors_count, [&](uint index)
+	{
+		Corridor& corridor = corridors[index];
+		Request& request = batch[corridor.request];
+		corridor.length = navmesh->FindCorridor(corridor.start_ref, corridor.end_ref, request.from, request.to, corridor.polys,
+			ThreadPool::GetThreadIndex());
+	});
+
+	// find path for each request
+	thread_pool->ParallelFor(count, [&](uint index)
+	{
+		Request& request = batch[index];
+		if(request.corridor == -1)
+			return;
+		Corridor& corridor = corridors[request.corridor];
+		if(corridor.length == 0)
+			return;
+		navmesh->FindStraightPath(corridor.polys, corridor.length, request.end_ref, request.from, request.to, paths[index],
+			ThreadPool::GetThreadIndex());
+		request.ok = true;
+	});
+
+	// deliver results
+	for(uint i = 0; i < count; ++i)
+	{
+		Request& request = batch[i];
+		Zombie& zombie = *request.zombie;
+		zombie.pf_waiting = false;
+		if(request.ok)
+		{
+			zombie.path.swap(paths[i]);
+			zombie.pf_state = PF_USED;
+			zombie.pf_timer = PF_USED_TIMER;
+			zombie.pf_target = request.to;
+			zombie.pf_index = 1;
+		}
+		else
+		{
+			zombie.pf_state = PF_NOT_GENERATED;
+			zombie.pf_timer = PF_NOT_GENERATED_TIMER;
+		}
+	}
+}
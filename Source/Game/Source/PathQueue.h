@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Navmesh.h"
+
+// Queue of zombies pathfinding requests, processed in batches on all threads (limited count per update).
+// Requests with same start & end polygon share single corridor search. Result is written to zombie in one of next updates.
+class PathQueue
+{
+public:
+	PathQueue();
+	void Init(Navmesh* navmesh, ThreadPool* thread_pool);
+	void Add(Zombie& zombie, const Vec3& target);
+	void Remove(Zombie& zombie);
+	void Clear();
+	void Update();
+
+	uint GetCount() const { return requests.size(); }
+
+	static const uint MAX_REQUESTS_PER_UPDATE = 64;
+
+private:
+	struct Request
+	{
+		Zombie* zombie;
+		Vec3 from, to;
+		dtPolyRef start_ref, end_ref;
+		int corridor;
+		bool ok;
+	};
+
+	struct Corridor
+	{
+		dtPolyRef start_ref, end_ref, polys[Navmesh::MAX_POLYS];
+		uint request;
+		int length;
+	};
+
+	Navmesh* navmesh;
+	ThreadPool* thread_pool;
+	vector<Request> requests;
+	vector<vector<Vec3>> paths;
+};
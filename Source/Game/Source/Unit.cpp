@@ -6,6 +6,15 @@
 const float Unit::radius = 0.3f;
 const float Unit::height = 1.73f;
 
+// animation names are interned once, mesh compares only ids
+static const NameId ani_stand = NameTable::Add("stoi"),
+	ani_rotate_left = NameTable::Add("w_lewo"),
+	ani_rotate_right = NameTable::Add("w_prawo"),
+	ani_walk = NameTable::Add("idzie"),
+	ani_run = NameTable::Add("biegnie"),
+	ani_idle_zombie = NameTable::Add("idle"),
+	ani_idle_human = NameTable::Add("drapie");
+
 void Unit::Update(Animation new_animation)
 {
 	if(new_animation == animation)
@@ -14,25 +23,25 @@ void Unit::Update(Animation new_animation)
 	switch(new_animation)
 	{
 	case ANI_STAND:
-		node->mesh_inst->Play("stoi", 0, 0);
+		node->mesh_inst->Play(ani_stand, 0, 0);
 		break;
 	case ANI_ROTATE_LEFT:
-		node->mesh_inst->Play("w_lewo", 0, 0);
+		node->mesh_inst->Play(ani_rotate_left, 0, 0);
 		break;
 	case ANI_ROTATE_RIGHT:
-		node->mesh_inst->Play("w_prawo", 0, 0);
+		node->mesh_inst->Play(ani_rotate_right, 0, 0);
 		break;
 	case ANI_WALK:
-		node->mesh_inst->Play("idzie", 0, 0);
+		node->mesh_inst->Play(ani_walk, 0, 0);
 		break;
 	case ANI_WALK_BACK:
-		node->mesh_inst->Play("idzie", PLAY_BACK, 0);
+		node->mesh_inst->Play(ani_walk, PLAY_BACK, 0);
 		break;
 	case ANI_RUN:
-		node->mesh_inst->Play("biegnie", 0, 0);
+		node->mesh_inst->Play(ani_run, 0, 0);
 		break;
 	case ANI_IDLE:
-		node->mesh_inst->Play(is_zombie ? "idle" : "drapie", PLAY_ONCE | PLAY_CLEAR_FRAME_END_INFO, 0);
+		node->mesh_inst->Play(is_zombie ? ani_idle_zombie : ani_idle_human, PLAY_ONCE | PLAY_CLEAR_FRAME_END_INFO, 0);
 		break;
 	}
 	animation = new_animation;
@@ -15,7 +15,7 @@ enum Animation
 
 struct Unit
 {
-	explicit Unit(bool is_zombie) : hp(100), maxhp(100), animation(ANI_STAND), is_zombie(is_zombie), last_damage(0), dying(false) {}
+	explicit Unit(bool is_zombie) : hp(100), maxhp(100), animation(ANI_STAND), is_zombie(is_zombie), last_damage(0), dying(false), grid_cell(-1) {}
 	virtual ~Unit() {}
 	void Update(Animation new_animation);
 	float GetHpp() const { return float(hp) / maxhp; }
@@ -27,7 +27,7 @@ struct Unit
 	void Load(FileReader& f);
 
 	SceneNode* node;
-	int hp, maxhp;
+	int hp, maxhp, grid_cell;
 	float last_damage;
 	Animation animation;
 	bool is_zombie, dying;
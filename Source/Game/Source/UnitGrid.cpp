@@ -0,0 +1,49 @@
+#include "GameCore.h"
+#include "UnitGrid.h"
+#include <SceneNode.h>
+
+UnitGrid::UnitGrid() : cell_size(1.f), cell_size_inv(1.f), size(0)
+{
+}
+
+void UnitGrid::Init(float level_size, float cell_size)
+{
+	assert(level_size > 0 && cell_size >= Unit::radius * 2);
+	this->cell_size = cell_size;
+	cell_size_inv = 1.f / cell_size;
+	size = (int)ceil(level_size / cell_size);
+	cells.clear();
+	cells.resize(size * size);
+}
+
+void UnitGrid::Clear()
+{
+	for(vector<Unit*>& cell : cells)
+		cell.clear();
+}
+
+void UnitGrid::Add(Unit* unit)
+{
+	assert(unit && unit->grid_cell == -1);
+	unit->grid_cell = PosToIndex(unit->node->pos);
+	cells[unit->grid_cell].push_back(unit);
+}
+
+void UnitGrid::Remove(Unit* unit)
+{
+	assert(unit && unit->grid_cell != -1);
+	RemoveElement(cells[unit->grid_cell], unit);
+	unit->grid_cell = -1;
+}
+
+void UnitGrid::Update(Unit* unit)
+{
+	assert(unit && unit->grid_cell != -1);
+	int index = PosToIndex(unit->node->pos);
+	if(index != unit->grid_cell)
+	{
+		RemoveElement(cells[unit->grid_cell], unit);
+		unit->grid_cell = index;
+		cells[index].push_back(unit);
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Unit.h"
+
+// Uniform grid of units (by node position), used to find units near point/box/ray without checking all of them.
+// Unit must be updated after changing position.
+class UnitGrid
+{
+public:
+	UnitGrid();
+	void Init(float level_size, float cell_size);
+	void Clear();
+	void Add(Unit* unit);
+	void Remove(Unit* unit);
+	void Update(Unit* unit);
+
+	// call action for each unit with position inside box
+	template<typename Action>
+	void ForEach(const Box2d& box, Action action) const
+	{
+		Int2 pt1 = PosToPt(box.v1),
+			pt2 = PosToPt(box.v2);
+		for(int y = pt1.y; y <= pt2.y; ++y)
+		{
+			for(int x = pt1.x; x <= pt2.x; ++x)
+			{
+				for(Unit* unit : cells[x + y * size])
+					action(unit);
+			}
+		}
+	}
+
+	// call action for each unit that is close enough to segment to touch it (may be called more then once for single unit)
+	template<typename Action>
+	void ForEachAlongRay(const Vec2& from, const Vec2& to, Action action) const
+	{
+		Vec2 dir = to - from;
+		float length = dir.Length();
+		int steps = int(length / cell_size) + 1;
+		Vec2 step = dir / float(steps);
+		Int2 prev_pt(-1, -1);
+		for(int i = 0; i <= steps; ++i)
+		{
+			Int2 pt = PosToPt(from + step * float(i));
+			if(pt == prev_pt)
+				continue;
+			prev_pt = pt;
+			int minx = max(0, pt.x - 1),
+				miny = max(0, pt.y - 1),
+				maxx = min(size - 1, pt.x + 1),
+				maxy = min(size - 1, pt.y + 1);
+			for(int y = miny; y <= maxy; ++y)
+			{
+				for(int x = minx; x <= maxx; ++x)
+				{
+					for(Unit* unit : cells[x + y * size])
+						action(unit);
+				}
+			}
+		}
+	}
+
+	float GetCellSize() const { return cell_size; }
+
+private:
+	Int2 PosToPt(const Vec2& pos) const
+	{
+		return Int2(Clamp(int(pos.x * cell_size_inv), 0, size - 1), Clamp(int(pos.y * cell_size_inv), 0, size - 1));
+	}
+	int PosToIndex(const Vec3& pos) const
+	{
+		Int2 pt = PosToPt(pos.XZ());
+		return pt.x + pt.y * size;
+	}
+
+	vector<vector<Unit*>> cells;
+	float cell_size, cell_size_inv;
+	int size;
+};
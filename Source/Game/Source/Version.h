@@ -1,7 +1,7 @@
 #pragma once
 
 #define VERSION_MAJOR 0
-#define VERSION_MINOR 2
+#define VERSION_MINOR 3
 #define VERSION_PATCH 0
 
 #ifndef STRING
@@ -9,7 +9,7 @@
 #	define STRING(str) _STRING(str)
 #endif
 
-#define VERSION ((VERSION_MAJOR << 16) | (VERSION_MINOR << 8) | VERSION_MINOR)
+#define VERSION ((VERSION_MAJOR << 16) | (VERSION_MINOR << 8) | VERSION_PATCH)
 #if VERSION_PATCH == 0
 #	define VERSION_STR STRING(VERSION_MAJOR) "." STRING(VERSION_MINOR)
 #else
@@ -24,9 +24,31 @@ enum PathfindingState
 	PF_USED
 };
 
+enum ZombieMove
+{
+	MOVE_NO,
+	MOVE_ROTATE,
+	MOVE_FORWARD,
+	MOVE_BACK // no pf
+};
+
+// result of zombie think phase, applied later in serial
+struct ZombieAction
+{
+	Animation animation;
+	ZombieMove move;
+	bool go_idle, // change state to idle (random timer)
+		new_idle, // pick new idle action
+		alert, // play alert sound & alert nearby zombies
+		attack, // start attack
+		flow; // move toward flow_point
+	Vec3 flow_point;
+};
+
 struct Zombie : Unit
 {
-	Zombie() : Unit(true), state(AI_IDLE), idle(IDLE_NONE), timer(idle_timer.Random()), attacking(false), pf_timer(0), pf_state(PF_NOT_USED) {}
+	Zombie() : Unit(true), state(AI_IDLE), idle(IDLE_NONE), timer(idle_timer.Random()), attacking(false), pf_timer(0), pf_state(PF_NOT_USED),
+		pf_waiting(false) {}
 	void ChangeState(AiState new_state);
 	void Save(FileWriter& f);
 	void Load(FileReader& f);
@@ -38,7 +60,7 @@ struct Zombie : Unit
 	Vec3 target_pos, start_pos, pf_target;
 	float timer, timer2, pf_timer;
 	int attack_index, death_timer, pf_index;
-	bool attacking;
+	bool attacking, pf_waiting;
 
 	static const float walk_speed;
 	static const float rot_speed;
@@ -0,0 +1,54 @@
+#include "Core.h"
+#include "Archive.h"
+#include <cstdio>
+
+// pack all files from data directory into archive mounted by ResourceManager
+int main(int argc, char** argv)
+{
+	bool compress = false;
+	cstring dir = nullptr, output = nullptr;
+	for(int i = 1; i < argc; ++i)
+	{
+		cstring arg = argv[i];
+		if(strcmp(arg, "-compress") == 0)
+			compress = true;
+		else if(!dir)
+			dir = arg;
+		else if(!output)
+			output = arg;
+		else
+		{
+			printf("Unknown parameter '%s'.\n", arg);
+			return 1;
+		}
+	}
+	if(!dir || !output)
+	{
+		printf("Usage: packer [-compress] <data dir> <output file>\n"
+			"Example: packer -compress Data Data.pak\n");
+		return 1;
+	}
+
+	vector<string> files;
+	io::FindFiles(dir, "", files);
+	if(files.empty())
+	{
+		printf("No files found in '%s'.\n", dir);
+		return 1;
+	}
+
+	try
+	{
+		Timer timer;
+		Archive::Stats stats;
+		Archive::Create(output, dir, files, compress, &stats);
+		printf("Packed %u files to '%s' (%u compressed), %u KB -> %u KB in %g s.\n", stats.files, output, stats.compressed, stats.size / 1024,
+			stats.packed_size / 1024, timer.Tick());
+	}
+	catch(cstring err)
+	{
+		printf("Failed to create archive: %s\n", err);
+		return 1;
+	}
+	return 0;
+}